@@ -0,0 +1,63 @@
+#include "bulk_mem.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include <stdlib.h>
+
+#define BULK_CAPS_INTERNAL (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#ifdef CONFIG_BULK_MEM_PSRAM
+#define BULK_CAPS_PSRAM (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define BULK_CAPS_PSRAM BULK_CAPS_INTERNAL  // Everything internal (A/B measurements)
+#endif
+
+static uint32_t s_bulk_psram;
+static uint32_t s_bulk_internal;
+static portMUX_TYPE s_mem_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void *bulk_count(void *ptr) {
+    if (ptr) {
+        portENTER_CRITICAL(&s_mem_lock);
+        if (esp_ptr_external_ram(ptr)) {
+            s_bulk_psram++;
+        } else {
+            s_bulk_internal++;
+        }
+        portEXIT_CRITICAL(&s_mem_lock);
+    }
+    return ptr;
+}
+
+void *bulk_alloc(size_t size) {
+    if (size < BULK_MEM_MIN_SIZE) {
+        return malloc(size);
+    }
+    return bulk_count(heap_caps_malloc_prefer(size, 2, BULK_CAPS_PSRAM, BULK_CAPS_INTERNAL));
+}
+
+void *bulk_realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return bulk_alloc(size);
+    }
+    // Blocks that started small (and internal) move out once they grow
+    void *result = heap_caps_realloc_prefer(ptr, size, 2, BULK_CAPS_PSRAM, BULK_CAPS_INTERNAL);
+    if (result && esp_ptr_external_ram(result) != esp_ptr_external_ram(ptr)) {
+        bulk_count(result);
+    }
+    return result;
+}
+
+void bulk_mem_get_stats(bulk_mem_stats_t *stats_out) {
+    if (!stats_out) {
+        return;
+    }
+    stats_out->internal_free = heap_caps_get_free_size(BULK_CAPS_INTERNAL);
+    stats_out->internal_min_free = heap_caps_get_minimum_free_size(BULK_CAPS_INTERNAL);
+    stats_out->internal_largest = heap_caps_get_largest_free_block(BULK_CAPS_INTERNAL);
+    stats_out->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    stats_out->psram_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+    portENTER_CRITICAL(&s_mem_lock);
+    stats_out->bulk_psram = s_bulk_psram;
+    stats_out->bulk_internal = s_bulk_internal;
+    portEXIT_CRITICAL(&s_mem_lock);
+}
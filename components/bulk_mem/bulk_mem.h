@@ -0,0 +1,66 @@
+#ifndef BULK_MEM_H
+#define BULK_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Placement of large transient buffers, shared by http_transport, the
+// wallet, RPC and x402 components.
+//
+// Bulk data that is filled and read front to back (response bodies, encoded
+// headers and transactions, cache entries) goes to PSRAM when the board has
+// it (CONFIG_SPIRAM, with CONFIG_SPIRAM_USE_CAPS_ALLOC so plain malloc stays
+// internal) and CONFIG_BULK_MEM_PSRAM is set. That leaves internal DRAM to
+// WiFi, lwIP and TLS. Crypto scratch, inflate state, structs and small
+// buffers keep using malloc: they are accessed at random or in tight loops,
+// where the PSRAM cache would cost more than it saves. Free either kind with
+// free().
+
+#define BULK_MEM_MIN_SIZE 512               // Smaller buffers stay internal
+
+/**
+ * @brief Heap headroom and bulk placement counters
+ */
+typedef struct {
+    size_t internal_free;               // Internal DRAM free now
+    size_t internal_min_free;           // Internal DRAM low-water mark since boot
+    size_t internal_largest;            // Largest internal block that can be allocated
+    size_t psram_free;                  // PSRAM free now (0 without PSRAM)
+    size_t psram_min_free;              // PSRAM low-water mark since boot
+    uint32_t bulk_psram;                // Bulk buffers placed in PSRAM
+    uint32_t bulk_internal;             // Bulk buffers that fell back to (or chose) internal RAM
+} bulk_mem_stats_t;
+
+/**
+ * @brief Allocate a bulk buffer, in PSRAM when available
+ *
+ * @param size Bytes to allocate
+ * @return Buffer (free with free()), or NULL if out of memory
+ */
+void *bulk_alloc(size_t size);
+
+/**
+ * @brief Grow or shrink a bulk buffer, in PSRAM when available
+ *
+ * @param ptr Buffer from bulk_alloc / _realloc, or NULL
+ * @param size New size in bytes
+ * @return Buffer (free with free()), or NULL if out of memory (ptr is kept)
+ */
+void *bulk_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Get heap headroom and bulk placement counters
+ *
+ * @param stats_out Output: counters
+ */
+void bulk_mem_get_stats(bulk_mem_stats_t *stats_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BULK_MEM_H
@@ -0,0 +1,825 @@
+#include "http_transport.h"
+#include "http_transport_dns.h"
+#include "http_transport_h2.h"
+#include "http_transport_body.h"
+#include "http_transport_capture.h"
+#include "bulk_mem.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static const char *TAG = "http_transport";
+
+/**
+ * @brief Pooled connection for one origin
+ */
+typedef struct {
+    char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    char host[HTTP_TRANSPORT_DNS_MAX_HOST_LEN];    // TLS name while connecting by address
+    esp_http_client_handle_t client;
+    bool tls;
+    bool busy;              // Owned by a request
+    bool connected;         // Socket believed open
+    bool has_session;       // TLS session cached in the handle (offered on reconnect)
+    int64_t last_used_us;
+    http_transport_stats_t stats;
+} origin_slot_t;
+
+/**
+ * @brief State for one request, passed to the event handler
+ */
+typedef struct {
+    http_transport_body_t body;
+    esp_err_t body_err;     // First failure while receiving the body
+    char *headers;
+    size_t headers_len;
+    bool connected;         // HTTP_EVENT_ON_CONNECTED fired
+    bool sent;              // Request headers written (HTTP_EVENT_HEADERS_SENT)
+    bool disconnected;      // Connection closed after the response
+    int64_t start_us;
+    uint32_t connect_us;
+} request_ctx_t;
+
+static origin_slot_t s_slots[HTTP_TRANSPORT_MAX_ORIGINS];
+static http_transport_stats_t s_total;
+static char s_warming[HTTP_TRANSPORT_MAX_ORIGINS][HTTP_TRANSPORT_MAX_ORIGIN_LEN];  // Prewarms in flight
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Copy "scheme://host[:port]" of url into origin_out
+ */
+static bool url_origin(const char *url, char *origin_out, size_t max_len) {
+    const char *host = strstr(url, "://");
+    if (!host) {
+        return false;
+    }
+    host += 3;
+    size_t len = (host - url) + strcspn(host, "/?#");
+    if (len >= max_len) {
+        return false;
+    }
+    memcpy(origin_out, url, len);
+    origin_out[len] = '\0';
+    return true;
+}
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
+    request_ctx_t *ctx = (request_ctx_t *)evt->user_data;
+    if (!ctx) {
+        return ESP_OK;
+    }
+
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            ctx->connected = true;
+            ctx->disconnected = false;
+            ctx->connect_us = (uint32_t)(esp_timer_get_time() - ctx->start_us);
+            break;
+
+        case HTTP_EVENT_HEADERS_SENT:
+            ctx->sent = true;
+            break;
+
+        case HTTP_EVENT_DISCONNECTED:
+            ctx->disconnected = true;
+            break;
+
+        case HTTP_EVENT_ON_HEADER: {
+            if (strcasecmp(evt->header_key, "Content-Encoding") == 0) {
+                http_transport_body_set_encoding(&ctx->body, evt->header_value, strlen(evt->header_value));
+            }
+            size_t key_len = strlen(evt->header_key);
+            size_t value_len = strlen(evt->header_value);
+            if (ctx->headers_len + key_len + value_len + 5 > HTTP_TRANSPORT_MAX_HEADERS_LEN) {
+                ESP_LOGW(TAG, "Dropping response header %s (header buffer full)", evt->header_key);
+                break;
+            }
+            size_t cap = HTTP_TRANSPORT_MAX_HEADERS_LEN;
+            if (!ctx->headers) {
+                ctx->headers = bulk_alloc(cap);
+                if (!ctx->headers) {
+                    break;
+                }
+            }
+            ctx->headers_len += snprintf(ctx->headers + ctx->headers_len, cap - ctx->headers_len,
+                                         "%s: %s\r\n", evt->header_key, evt->header_value);
+            break;
+        }
+
+        case HTTP_EVENT_ON_DATA:
+            if (ctx->body_err == ESP_OK) {
+                ctx->body_err = http_transport_body_write(&ctx->body, evt->data, evt->data_len);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return ESP_OK;
+}
+
+static void ctx_reset(request_ctx_t *ctx) {
+    size_t max_body = ctx->body.max_len;
+    bool decode = ctx->body.decode;
+    http_transport_body_free(&ctx->body);
+    free(ctx->headers);
+    memset(ctx, 0, sizeof(*ctx));
+    http_transport_body_init(&ctx->body, max_body, decode);
+}
+
+/**
+ * @brief Claim the pooled slot for origin, or NULL to use a one-shot client
+ *
+ * An unused or idle least-recently-used slot is taken over for a new origin.
+ */
+static origin_slot_t *slot_acquire(const char *origin) {
+    origin_slot_t *free_slot = NULL;
+    origin_slot_t *lru = NULL;
+    origin_slot_t *result = NULL;
+    esp_http_client_handle_t evicted = NULL;
+
+    portENTER_CRITICAL(&s_pool_lock);
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        origin_slot_t *s = &s_slots[i];
+        if (strcmp(s->origin, origin) == 0) {
+            if (!s->busy) {
+                s->busy = true;
+                result = s;
+            }
+            portEXIT_CRITICAL(&s_pool_lock);
+            return result;
+        }
+        if (!s->origin[0] && !free_slot) {
+            free_slot = s;
+        } else if (s->origin[0] && !s->busy && (!lru || s->last_used_us < lru->last_used_us)) {
+            lru = s;
+        }
+    }
+    result = free_slot ? free_slot : lru;
+    if (result) {
+        // Re-key it before unlocking, so a concurrent request for the same
+        // origin finds it busy instead of claiming a second slot
+        evicted = result->client;
+        memset(result, 0, sizeof(*result));
+        result->busy = true;
+        strcpy(result->origin, origin);
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (evicted) {
+        ESP_LOGD(TAG, "Evicting an idle connection for %s", origin);
+        esp_http_client_cleanup(evicted);
+    }
+    return result;
+}
+
+static void slot_release(origin_slot_t *slot) {
+    portENTER_CRITICAL(&s_pool_lock);
+    slot->last_used_us = esp_timer_get_time();
+    slot->busy = false;
+    portEXIT_CRITICAL(&s_pool_lock);
+}
+
+/**
+ * @brief Replace the host in url with its cached address
+ *
+ * The TLS name (SNI and certificate check) and the Host header still use the
+ * real host name, so servers behind virtual hosting keep working.
+ *
+ * @param host_out Output: host name to pass as common_name ("" if unchanged)
+ * @param connect_url Output: allocated URL to connect to, or NULL to use url
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if the host does not resolve
+ */
+static esp_err_t connect_target(const char *url, const char *origin,
+                                char *host_out, char **connect_url) {
+    const char *hostport = strstr(origin, "://") + 3;
+    size_t host_len = strcspn(hostport, ":");
+    host_out[0] = '\0';
+    *connect_url = NULL;
+    if (hostport[0] == '[' || host_len >= HTTP_TRANSPORT_DNS_MAX_HOST_LEN) {
+        return ESP_OK;  // IPv6 literal or uncacheable name
+    }
+    memcpy(host_out, hostport, host_len);
+    host_out[host_len] = '\0';
+
+    char addr[HTTP_TRANSPORT_DNS_ADDR_LEN];
+    esp_err_t err = http_transport_dns_resolve(host_out, addr, sizeof(addr));
+    if (err == ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+    if (err != ESP_OK) {
+        host_out[0] = '\0';
+        return ESP_OK;  // Literal address, connect as is
+    }
+
+    bool v6 = strchr(addr, ':') != NULL;
+    if (asprintf(connect_url, "%.*s%s%s%s%s", (int)(hostport - origin), origin,
+                 v6 ? "[" : "", addr, v6 ? "]" : "", url + (hostport - origin) + host_len) < 0) {
+        *connect_url = NULL;
+        host_out[0] = '\0';
+    }
+    return ESP_OK;
+}
+
+static esp_http_client_handle_t client_create(const http_transport_request_t *request,
+                                              const char *url, const char *common_name, bool tls) {
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = request->method,
+        .timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : HTTP_TRANSPORT_TIMEOUT_MS,
+        .event_handler = http_event_handler,
+        .buffer_size = HTTP_TRANSPORT_BUFFER_SIZE,
+        .buffer_size_tx = HTTP_TRANSPORT_BUFFER_SIZE,
+        .keep_alive_enable = true,
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true,
+#endif
+    };
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+    if (tls) {
+        config.crt_bundle_attach = esp_crt_bundle_attach;
+    }
+#endif
+    if (tls && common_name && common_name[0]) {
+        config.common_name = common_name;
+    }
+    return esp_http_client_init(&config);
+}
+
+/**
+ * @brief Set (or delete, when value is not wanted) each "Name: value" line
+ */
+static void headers_for_each(esp_http_client_handle_t client, const char *headers, bool set) {
+    if (!headers || !headers[0]) {
+        return;
+    }
+    char *copy = strdup(headers);
+    if (!copy) {
+        ESP_LOGE(TAG, "Failed to copy request headers");
+        return;
+    }
+    char *save = NULL;
+    for (char *line = strtok_r(copy, "\r\n", &save); line; line = strtok_r(NULL, "\r\n", &save)) {
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            continue;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ') value++; // Skip spaces
+        if (set) {
+            esp_http_client_set_header(client, line, value);
+        } else {
+            // Pooled handles outlive the request; drop its headers
+            esp_http_client_delete_header(client, line);
+        }
+    }
+    free(copy);
+}
+
+static esp_err_t write_all(esp_http_client_handle_t client, const char *data, size_t len) {
+    while (len > 0) {
+        int n = esp_http_client_write(client, data, (int)len);
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Send a body_reader request with open/write, then read the response
+ *
+ * The response still goes through http_event_handler (ON_HEADER, ON_DATA),
+ * so the body ends up in the request context as with esp_http_client_perform.
+ */
+static esp_err_t perform_streamed(esp_http_client_handle_t client, const http_transport_request_t *request) {
+    bool chunked = request->body_len == 0;
+    esp_err_t err = esp_http_client_open(client, chunked ? -1 : (int)request->body_len);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Room for a chunk header ("1000\r\n") before the data and "\r\n" after it
+    const size_t head = 8;
+    char *buf = bulk_alloc(head + HTTP_TRANSPORT_BUFFER_SIZE + 2);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t offset = 0;
+    while (err == ESP_OK) {
+        size_t want = HTTP_TRANSPORT_BUFFER_SIZE;
+        if (!chunked && request->body_len - offset < want) {
+            want = request->body_len - offset;
+            if (want == 0) {
+                break;
+            }
+        }
+        int n = request->body_reader(request->body_reader_ctx, offset, (uint8_t *)buf + head, want);
+        if (n < 0 || (n == 0 && !chunked)) {
+            ESP_LOGE(TAG, "Body reader failed at offset %zu", offset);
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        if (n == 0) {
+            err = write_all(client, "0\r\n\r\n", 5);
+            break;
+        }
+        if (chunked) {
+            char size[12];
+            int size_len = snprintf(size, sizeof(size), "%x\r\n", n);
+            memcpy(buf + head - size_len, size, size_len);
+            memcpy(buf + head + n, "\r\n", 2);
+            err = write_all(client, buf + head - size_len, size_len + n + 2);
+        } else {
+            err = write_all(client, buf + head, n);
+        }
+        offset += n;
+    }
+
+    if (err == ESP_OK && esp_http_client_fetch_headers(client) < 0) {
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK) {
+        int n;
+        while ((n = esp_http_client_read(client, buf, HTTP_TRANSPORT_BUFFER_SIZE)) > 0) {
+        }
+        if (n < 0) {
+            err = ESP_FAIL;
+        }
+    }
+    free(buf);
+    return err;
+}
+
+bool http_transport_method_idempotent(esp_http_client_method_t method) {
+    switch (method) {
+        case HTTP_METHOD_GET:
+        case HTTP_METHOD_HEAD:
+        case HTTP_METHOD_PUT:
+        case HTTP_METHOD_DELETE:
+        case HTTP_METHOD_OPTIONS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void http_transport_stats_add(http_transport_stats_t *s, const http_transport_response_t *response,
+                              esp_err_t err) {
+    s->requests++;
+    if (err != ESP_OK && err != ESP_ERR_INVALID_SIZE) {
+        s->errors++;
+        return;
+    }
+    if (response->http2) {
+        s->http2_streams++;
+    }
+    s->wire_bytes += response->wire_len;
+    s->body_bytes += response->body_len;
+    switch (response->conn) {
+        case HTTP_TRANSPORT_CONN_REUSED:
+            s->reused++;
+            break;
+        case HTTP_TRANSPORT_CONN_PLAIN:
+            s->plain_connects++;
+            break;
+        case HTTP_TRANSPORT_CONN_TLS_FULL:
+            s->tls_full++;
+            s->last_full_us = response->connect_us;
+            break;
+        case HTTP_TRANSPORT_CONN_TLS_RESUMED:
+            s->tls_resumed++;
+            s->last_resumed_us = response->connect_us;
+            break;
+        case HTTP_TRANSPORT_CONN_TLS_OFFERED:
+            s->tls_offered++;
+            break;
+    }
+}
+
+static esp_err_t perform(const http_transport_request_t *request,
+                         http_transport_response_t *response) {
+    if (!response) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(response, 0, sizeof(http_transport_response_t));
+    if (!request || !request->url) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    if (!url_origin(request->url, origin, sizeof(origin))) {
+        ESP_LOGE(TAG, "Invalid URL: %s", request->url);
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool tls = strncasecmp(origin, "https:", 6) == 0;
+
+#ifdef HTTP_TRANSPORT_HTTP2
+    if (tls && !request->body_reader) {
+        esp_err_t h2_err = http_transport_h2_perform(request, origin, response);
+        if (h2_err != ESP_ERR_NOT_SUPPORTED) {
+            portENTER_CRITICAL(&s_pool_lock);
+            http_transport_stats_add(&s_total, response, h2_err);
+            portEXIT_CRITICAL(&s_pool_lock);
+            return h2_err;
+        }
+        memset(response, 0, sizeof(http_transport_response_t));
+    }
+#endif
+
+    // Resolve before taking a slot; after warm-up this never blocks
+    char host[HTTP_TRANSPORT_DNS_MAX_HOST_LEN];
+    char *connect_url = NULL;
+    if (connect_target(request->url, origin, host, &connect_url) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot resolve %s", origin);
+        portENTER_CRITICAL(&s_pool_lock);
+        s_total.requests++;
+        s_total.errors++;
+        portEXIT_CRITICAL(&s_pool_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const char *url = connect_url ? connect_url : request->url;
+
+    origin_slot_t *slot = slot_acquire(origin);
+    esp_http_client_handle_t client = slot ? slot->client : NULL;
+    bool fresh_handle = false;
+
+    if (client) {
+        esp_http_client_set_url(client, url);
+        esp_http_client_set_method(client, request->method);
+        esp_http_client_set_timeout_ms(client,
+            request->timeout_ms > 0 ? request->timeout_ms : HTTP_TRANSPORT_TIMEOUT_MS);
+        if (slot->connected &&
+            esp_timer_get_time() - slot->last_used_us > HTTP_TRANSPORT_IDLE_TIMEOUT_MS * 1000LL) {
+            // The server has most likely dropped it; reconnect up front
+            esp_http_client_close(client);
+            slot->connected = false;
+        }
+    } else {
+        // common_name is kept by pointer, so it must outlive the handle
+        if (slot) {
+            strcpy(slot->host, host);
+        }
+        client = client_create(request, url, slot ? slot->host : host, tls);
+        if (!client) {
+            ESP_LOGE(TAG, "Failed to initialize HTTP client");
+            if (slot) slot_release(slot);
+            free(connect_url);
+            return ESP_FAIL;
+        }
+        fresh_handle = true;
+        if (slot) {
+            slot->client = client;
+            slot->tls = tls;
+        }
+    }
+
+    if (connect_url) {
+        // set_url derived Host from the address
+        esp_http_client_set_header(client, "Host", strstr(origin, "://") + 3);
+    }
+    if (request->accept_encoding) {
+        esp_http_client_set_header(client, "Accept-Encoding", HTTP_TRANSPORT_ACCEPT_ENCODING);
+    }
+    headers_for_each(client, request->headers, true);
+    esp_http_client_set_post_field(client, request->body, request->body ? (int)request->body_len : 0);
+
+    request_ctx_t ctx = { 0 };
+    http_transport_body_init(&ctx.body, request->max_response, request->accept_encoding);
+    esp_http_client_set_user_data(client, &ctx);
+
+    bool was_connected = slot && slot->connected;
+    ctx.start_us = esp_timer_get_time();
+    esp_err_t err = request->body_reader ? perform_streamed(client, request)
+                                         : esp_http_client_perform(client);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE && was_connected && !ctx.connected &&
+        (!ctx.sent || http_transport_method_idempotent(request->method))) {
+        // Stale keep-alive socket: retry once, unless the server may have
+        // acted on a non-idempotent request before the socket failed
+        ESP_LOGD(TAG, "Reused connection to %s failed, reconnecting", origin);
+        esp_http_client_close(client);
+        ctx_reset(&ctx);
+        ctx.start_us = esp_timer_get_time();
+        err = request->body_reader ? perform_streamed(client, request)
+                                   : esp_http_client_perform(client);
+    }
+    if (request->body_reader && err == ESP_OK) {
+        // Left mid-state by open/read; start clean next time
+        esp_http_client_close(client);
+        ctx.disconnected = true;
+    }
+
+    if (err == ESP_OK) {
+        response->status_code = esp_http_client_get_status_code(client);
+        err = ctx.body_err != ESP_OK ? ctx.body_err : http_transport_body_finish(&ctx.body);
+    } else {
+        ESP_LOGE(TAG, "HTTP request to %s failed: %s", origin, esp_err_to_name(err));
+        esp_http_client_close(client);
+        ctx.disconnected = true;
+    }
+
+    if (!ctx.connected) {
+        response->conn = HTTP_TRANSPORT_CONN_REUSED;
+    } else if (!tls) {
+        response->conn = HTTP_TRANSPORT_CONN_PLAIN;
+    } else if (slot && slot->has_session) {
+        // esp_http_client keeps its TLS context to itself, so whether the
+        // server accepted the session cannot be told from here
+        response->conn = HTTP_TRANSPORT_CONN_TLS_OFFERED;
+    } else {
+        response->conn = HTTP_TRANSPORT_CONN_TLS_FULL;
+    }
+    response->connect_us = ctx.connected ? ctx.connect_us : 0;
+    response->sent = ctx.sent;
+
+    if (err == ESP_OK) {
+        response->headers = ctx.headers;
+        response->body = ctx.body.data;
+        response->body_len = ctx.body.len;
+        response->wire_len = ctx.body.wire_len;
+        ctx.headers = NULL;
+        ctx.body.data = NULL;
+    }
+    http_transport_body_free(&ctx.body);
+    free(ctx.headers);
+
+    esp_http_client_set_user_data(client, NULL);
+    esp_http_client_set_post_field(client, NULL, 0);
+    headers_for_each(client, request->headers, false);
+    if (request->body_reader && request->body_len == 0) {
+        esp_http_client_delete_header(client, "Transfer-Encoding");
+    }
+    if (request->accept_encoding) {
+        esp_http_client_delete_header(client, "Accept-Encoding");
+    }
+
+    ESP_LOGD(TAG, "%s -> %d (%zu bytes, conn %d, connect %lu us)", request->url,
+             response->status_code, response->body_len, response->conn,
+             (unsigned long)response->connect_us);
+
+    portENTER_CRITICAL(&s_pool_lock);
+    http_transport_stats_add(&s_total, response, err);
+    if (slot) {
+        http_transport_stats_add(&slot->stats, response, err);
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (slot) {
+        slot->connected = !ctx.disconnected;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (tls && ctx.connected && err == ESP_OK) {
+            slot->has_session = true;
+        }
+#endif
+        slot_release(slot);
+    } else if (fresh_handle) {
+        esp_http_client_cleanup(client);
+    }
+    free(connect_url);
+
+    return err;
+}
+
+/**
+ * @brief Whether origin has an open pooled socket that is not about to be dropped
+ */
+static bool origin_warm(const char *origin) {
+    bool warm = false;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_pool_lock);
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        origin_slot_t *s = &s_slots[i];
+        if (strcmp(s->origin, origin) == 0) {
+            warm = s->connected && now - s->last_used_us < HTTP_TRANSPORT_IDLE_TIMEOUT_MS * 1000LL;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+    return warm;
+}
+
+static bool origin_warming(const char *origin) {
+    bool warming = false;
+    portENTER_CRITICAL(&s_pool_lock);
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS && !warming; i++) {
+        warming = strcmp(s_warming[i], origin) == 0;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+    return warming;
+}
+
+/**
+ * @brief Let a prewarm of the request's origin finish, so the request gets
+ *        its pooled connection instead of a one-shot one
+ */
+static void prewarm_wait(const http_transport_request_t *request) {
+    char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    if (!request || !request->url || !url_origin(request->url, origin, sizeof(origin))) {
+        return;
+    }
+    int timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : HTTP_TRANSPORT_TIMEOUT_MS;
+    int64_t deadline_us = esp_timer_get_time() + timeout_ms * 1000LL;
+    while (origin_warming(origin) && esp_timer_get_time() < deadline_us) {
+        vTaskDelay(pdMS_TO_TICKS(HTTP_TRANSPORT_PREWARM_POLL_MS));
+    }
+}
+
+/**
+ * @brief Open one origin's connection with a HEAD / and exit
+ */
+static void prewarm_task(void *arg) {
+    int index = (int)(intptr_t)arg;
+    char url[HTTP_TRANSPORT_MAX_ORIGIN_LEN + 1];
+    portENTER_CRITICAL(&s_pool_lock);
+    strcpy(url, s_warming[index]);
+    portEXIT_CRITICAL(&s_pool_lock);
+    strcat(url, "/");
+
+    http_transport_request_t request = {
+        .url = url,
+        .method = HTTP_METHOD_HEAD,
+    };
+    http_transport_response_t response;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = perform(&request, &response);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Prewarmed %s in %lu ms (conn %d)", url,
+                 (unsigned long)((esp_timer_get_time() - start_us) / 1000), response.conn);
+    } else {
+        ESP_LOGW(TAG, "Prewarming %s failed: %s", url, esp_err_to_name(err));
+    }
+    http_transport_response_free(&response);
+
+    portENTER_CRITICAL(&s_pool_lock);
+    s_warming[index][0] = '\0';
+    portEXIT_CRITICAL(&s_pool_lock);
+    vTaskDelete(NULL);
+}
+
+esp_err_t http_transport_perform(const http_transport_request_t *request,
+                                 http_transport_response_t *response) {
+#ifdef HTTP_TRANSPORT_CAPTURE
+    esp_err_t err;
+    if (http_transport_replay_perform(request, response, &err)) {
+        return err;
+    }
+    int64_t start_us = esp_timer_get_time();
+    prewarm_wait(request);
+    err = perform(request, response);
+    http_transport_capture_record(request, response, err, (uint32_t)(esp_timer_get_time() - start_us));
+    return err;
+#else
+    prewarm_wait(request);
+    return perform(request, response);
+#endif
+}
+
+void http_transport_response_free(http_transport_response_t *response) {
+    if (!response) {
+        return;
+    }
+    free(response->headers);
+    free(response->body);
+    memset(response, 0, sizeof(http_transport_response_t));
+}
+
+esp_err_t http_transport_get_stats(const char *url, http_transport_stats_t *stats_out) {
+    if (!stats_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    if (url && !url_origin(url, origin, sizeof(origin))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_pool_lock);
+    if (!url) {
+        *stats_out = s_total;
+        err = ESP_OK;
+    } else {
+        for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+            if (strcmp(s_slots[i].origin, origin) == 0) {
+                *stats_out = s_slots[i].stats;
+                err = ESP_OK;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+#ifdef HTTP_TRANSPORT_HTTP2
+    if (err == ESP_ERR_NOT_FOUND) {
+        err = http_transport_h2_get_stats(origin, stats_out);
+    }
+#endif
+    return err;
+}
+
+esp_err_t http_transport_prewarm(const char *const *urls, size_t count) {
+    char origins[HTTP_TRANSPORT_MAX_ORIGINS][HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    size_t n = 0;
+
+    if (!urls) {
+        // Origins the pool already knows, e.g. after http_transport_suspend()
+        portENTER_CRITICAL(&s_pool_lock);
+        for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+            if (s_slots[i].origin[0]) {
+                strcpy(origins[n++], s_slots[i].origin);
+            }
+        }
+        portEXIT_CRITICAL(&s_pool_lock);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+            if (!urls[i] || !url_origin(urls[i], origin, sizeof(origin))) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            bool seen = false;
+            for (size_t j = 0; j < n && !seen; j++) {
+                seen = strcmp(origins[j], origin) == 0;
+            }
+            if (seen) {
+                continue;
+            }
+            if (n == HTTP_TRANSPORT_MAX_ORIGINS) {
+                ESP_LOGW(TAG, "Only %d origins are pooled, not prewarming %s",
+                         HTTP_TRANSPORT_MAX_ORIGINS, origin);
+                continue;
+            }
+            strcpy(origins[n++], origin);
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < n; i++) {
+        if (origin_warm(origins[i])) {
+            continue;
+        }
+
+        // Claim a warming entry; requests to the origin wait for it
+        int index = -1;
+        bool warming = false;
+        portENTER_CRITICAL(&s_pool_lock);
+        for (int j = 0; j < HTTP_TRANSPORT_MAX_ORIGINS; j++) {
+            if (strcmp(s_warming[j], origins[i]) == 0) {
+                warming = true;
+                break;
+            }
+            if (!s_warming[j][0] && index < 0) {
+                index = j;
+            }
+        }
+        if (!warming && index >= 0) {
+            strcpy(s_warming[index], origins[i]);
+        }
+        portEXIT_CRITICAL(&s_pool_lock);
+        if (warming || index < 0) {
+            continue;
+        }
+
+        if (xTaskCreate(prewarm_task, "http_warm", HTTP_TRANSPORT_PREWARM_STACK_SIZE,
+                        (void *)(intptr_t)index, tskIDLE_PRIORITY + 2, NULL) != pdPASS) {
+            ESP_LOGW(TAG, "No memory for a prewarm task for %s", origins[i]);
+            portENTER_CRITICAL(&s_pool_lock);
+            s_warming[index][0] = '\0';
+            portEXIT_CRITICAL(&s_pool_lock);
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+    return err;
+}
+
+void http_transport_suspend(void) {
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        origin_slot_t *slot = &s_slots[i];
+
+        portENTER_CRITICAL(&s_pool_lock);
+        bool idle = slot->client && !slot->busy && slot->connected;
+        if (idle) {
+            slot->busy = true;
+        }
+        portEXIT_CRITICAL(&s_pool_lock);
+
+        if (idle) {
+            esp_http_client_close(slot->client);
+            slot->connected = false;
+            portENTER_CRITICAL(&s_pool_lock);
+            slot->busy = false;
+            portEXIT_CRITICAL(&s_pool_lock);
+        }
+    }
+#ifdef HTTP_TRANSPORT_HTTP2
+    http_transport_h2_suspend();
+#endif
+}
@@ -0,0 +1,197 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_TRANSPORT_MAX_ORIGINS 4            // Pooled connections (one per origin)
+#define HTTP_TRANSPORT_MAX_ORIGIN_LEN 128       // "https://host:port"
+#define HTTP_TRANSPORT_TIMEOUT_MS 10000         // Default request timeout
+#define HTTP_TRANSPORT_IDLE_TIMEOUT_MS 30000    // Close pooled sockets idle longer than this
+#define HTTP_TRANSPORT_MAX_HEADERS_LEN 4096     // Captured response headers
+#define HTTP_TRANSPORT_BUFFER_SIZE 4096         // esp_http_client rx/tx buffer
+#define HTTP_TRANSPORT_ACCEPT_ENCODING "gzip, deflate"  // Sent when accept_encoding is set
+#define HTTP_TRANSPORT_PREWARM_STACK_SIZE 8192  // Per-origin prewarm task (does TLS)
+#define HTTP_TRANSPORT_PREWARM_POLL_MS 10       // Request waiting for its origin's prewarm
+
+/**
+ * @brief How a request reached the server
+ */
+typedef enum {
+    HTTP_TRANSPORT_CONN_REUSED = 0,     // Sent on an already open connection
+    HTTP_TRANSPORT_CONN_PLAIN,          // New plain TCP connection
+    HTTP_TRANSPORT_CONN_TLS_FULL,       // New TLS connection, full handshake
+    HTTP_TRANSPORT_CONN_TLS_RESUMED,    // New TLS connection, server resumed the cached session
+    HTTP_TRANSPORT_CONN_TLS_OFFERED,    // New TLS connection offering a cached session, outcome not visible
+} http_transport_conn_t;
+
+/**
+ * @brief Pull callback for a streamed request body
+ *
+ * Called with increasing offsets; a retry (stale connection, caller resend)
+ * starts again from offset 0. Sources that cannot rewind return an error.
+ *
+ * @param ctx body_reader_ctx from the request
+ * @param offset Position in the body of the first byte wanted
+ * @param buf Output buffer
+ * @param max_len Size of buf
+ * @return Bytes written (may block until available), 0 at end of body, -1 on error
+ */
+typedef int (*http_transport_body_reader_t)(void *ctx, size_t offset, uint8_t *buf, size_t max_len);
+
+/**
+ * @brief Request description
+ */
+typedef struct {
+    const char *url;                    // Absolute http:// or https:// URL
+    esp_http_client_method_t method;    // HTTP method
+    const char *headers;                // Optional "Name: value" lines separated by \r\n
+    const char *body;                   // Optional request body
+    size_t body_len;                    // Length of body (or of the streamed body, 0 = unknown)
+    http_transport_body_reader_t body_reader;   // Streams the body instead of body (NULL = unused)
+    void *body_reader_ctx;              // Passed to body_reader
+    int timeout_ms;                     // 0 = HTTP_TRANSPORT_TIMEOUT_MS
+    size_t max_response;                // Body limit in bytes (decoded), 0 = unlimited
+    bool accept_encoding;               // Ask for gzip/deflate and inflate the body
+} http_transport_request_t;
+
+/**
+ * @brief Response (free with http_transport_response_free)
+ */
+typedef struct {
+    int status_code;                    // HTTP status code
+    char *headers;                      // Response headers as "Name: value\r\n" lines
+    char *body;                         // NUL-terminated body (NULL if empty)
+    size_t body_len;                    // Length of body
+    size_t wire_len;                    // Body bytes received (compressed size if inflated)
+    http_transport_conn_t conn;         // Connection type used
+    uint32_t connect_us;                // Connect + handshake time (0 if reused)
+    bool http2;                         // Sent as an HTTP/2 stream
+    bool sent;                          // Request written, even on an error (false = never left the device)
+} http_transport_response_t;
+
+/**
+ * @brief Per-origin (or aggregate) counters
+ */
+typedef struct {
+    uint32_t requests;                  // Requests performed
+    uint32_t errors;                    // Transport-level failures
+    uint32_t reused;                    // Requests on an already open connection
+    uint32_t plain_connects;            // New plain TCP connections
+    uint32_t tls_full;                  // Full TLS handshakes
+    uint32_t tls_resumed;               // Handshakes that resumed a cached session
+    uint32_t tls_offered;               // Handshakes offering a cached session, outcome not visible
+    uint32_t http2_streams;             // Requests sent as HTTP/2 streams
+    uint32_t wire_bytes;                // Response body bytes received
+    uint32_t body_bytes;                // Response body bytes after inflating
+    uint32_t last_full_us;              // Last full handshake duration
+    uint32_t last_resumed_us;           // Last resumed handshake duration
+} http_transport_stats_t;
+
+/**
+ * @brief Perform an HTTP request over the shared connection pool
+ *
+ * Requests to the same origin reuse one persistent esp_http_client handle.
+ * The TCP/TLS connection stays open between requests, and the TLS session is
+ * cached in the handle (CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS). A reconnect
+ * after the server closed the socket then does an abbreviated handshake. If
+ * the pooled handle is busy, a one-shot connection is used instead. A request
+ * that fails on a reused connection is retried once on a fresh one if it was
+ * not written yet or its method is idempotent (GET, HEAD, PUT, DELETE,
+ * OPTIONS); a POST that may have reached the server returns the error.
+ *
+ * Host names are resolved through the cache in http_transport_dns.h, and the
+ * connection is made to the cached address. The host name is still used for
+ * TLS (SNI and certificate check) and the Host header.
+ *
+ * When built with -DHTTP_TRANSPORT_HTTP2=ON, https origins that select "h2"
+ * via ALPN get a single HTTP/2 connection instead. Requests from different
+ * tasks then run as concurrent streams on it. Other origins keep using the
+ * HTTP/1.1 pool.
+ *
+ * With request->accept_encoding set, the server may gzip or deflate the body.
+ * It is inflated as it arrives, so response->body is always plain while
+ * response->headers still show the Content-Encoding that was used.
+ *
+ * With request->body_reader set, the body is pulled in
+ * HTTP_TRANSPORT_BUFFER_SIZE pieces and written as it is read, so it never has
+ * to be contiguous in RAM. It is sent with Content-Length when body_len is
+ * known, chunked otherwise. Streamed requests always use HTTP/1.1, so a
+ * blocking reader cannot stall other HTTP/2 streams, and the connection is
+ * closed afterwards (the TLS session is still resumed).
+ *
+ * @param request Request description
+ * @param response Output: response (always initialized)
+ * @return ESP_OK if an HTTP response was received (any status),
+ *         ESP_ERR_INVALID_SIZE if the body exceeded max_response,
+ *         ESP_ERR_INVALID_RESPONSE if a compressed body is corrupt or truncated,
+ *         ESP_ERR_INVALID_STATE if body_reader failed or ended before body_len,
+ *         ESP_ERR_NOT_FOUND if the host does not resolve
+ */
+esp_err_t http_transport_perform(const http_transport_request_t *request,
+                                 http_transport_response_t *response);
+
+/**
+ * @brief Free response buffers
+ *
+ * @param response Response to free
+ */
+void http_transport_response_free(http_transport_response_t *response);
+
+/**
+ * @brief Whether sending the request twice has the same effect as once (RFC 9110)
+ */
+bool http_transport_method_idempotent(esp_http_client_method_t method);
+
+/**
+ * @brief Get connection statistics
+ *
+ * @param url Any URL of the origin, or NULL for all origins since boot
+ * @param stats_out Output: counters
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the origin is not pooled
+ */
+esp_err_t http_transport_get_stats(const char *url, http_transport_stats_t *stats_out);
+
+/**
+ * @brief Open connections to origins in the background
+ *
+ * Each origin that has no open pooled socket gets a short-lived task that
+ * resolves it, connects, completes the TLS handshake and sends "HEAD /", so
+ * the connection is pooled with its TLS session. Origins are warmed in
+ * parallel while the caller goes on initializing; the first real request to
+ * each then finds an open socket (or, if the server has closed it, a cached
+ * session to resume). A request made while its origin is still being warmed
+ * waits for the prewarm (up to its timeout) and then uses that connection.
+ *
+ * Call it at boot with the configured RPC, API and facilitator URLs, or
+ * with urls NULL after waking from light sleep to reopen every origin the
+ * pool already knows.
+ *
+ * @param urls Any URL of each origin (duplicates are merged), or NULL for
+ *             the pooled origins
+ * @param count Number of urls
+ * @return ESP_OK if every prewarm was started, ESP_ERR_INVALID_ARG for a
+ *         malformed URL, ESP_ERR_NO_MEM if a task could not be created
+ */
+esp_err_t http_transport_prewarm(const char *const *urls, size_t count);
+
+/**
+ * @brief Close idle pooled sockets but keep cached TLS sessions
+ *
+ * Call before light sleep or when WiFi drops. RAM is retained, so the first
+ * request after wake resumes the session instead of doing a full handshake.
+ */
+void http_transport_suspend(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_TRANSPORT_H
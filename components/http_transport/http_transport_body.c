@@ -0,0 +1,362 @@
+#include "http_transport_body.h"
+#include "bulk_mem.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "miniz.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "http_body";
+
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+#define GZIP_RESERVED 0xE0
+
+typedef enum {
+    GZIP_FIXED = 0,     // ID1 ID2 CM FLG MTIME(4) XFL OS
+    GZIP_XLEN,          // FEXTRA length
+    GZIP_SKIP,          // FEXTRA payload or FHCRC
+    GZIP_STRING,        // FNAME or FCOMMENT, NUL-terminated
+    GZIP_DATA,
+} gzip_stage_t;
+
+typedef enum {
+    PHASE_HEADER = 0,   // gzip member header
+    PHASE_DATA,         // deflate stream (tinfl checks the zlib header and Adler-32)
+    PHASE_DONE,
+} inflate_phase_t;
+
+/**
+ * @brief Decoder for one encoded body (~11 KB, only while it streams)
+ */
+struct http_transport_inflate_t {
+    tinfl_decompressor tinfl;   // miniz in ROM
+    inflate_phase_t phase;
+    uint32_t flags;             // TINFL_FLAG_* for this stream
+    bool flags_known;           // deflate: zlib or raw is decided on the first byte
+    gzip_stage_t stage;
+    uint8_t gzip_flags;         // FLG bits still to skip
+    uint8_t fixed[10];
+    size_t count;
+    size_t skip;
+    uint32_t crc;               // CRC-32 of the decoded gzip data
+    uint8_t tail[8];            // Last wire bytes: the gzip CRC-32 and ISIZE trailer
+    size_t tail_len;
+};
+
+void http_transport_body_init(http_transport_body_t *body, size_t max_len, bool decode) {
+    memset(body, 0, sizeof(*body));
+    body->max_len = max_len;
+    body->decode = decode;
+}
+
+void http_transport_body_set_encoding(http_transport_body_t *body, const char *value, size_t value_len) {
+    if (!body->decode || body->wire_len) {
+        return;
+    }
+    while (value_len && (*value == ' ' || *value == '\t')) {
+        value++;
+        value_len--;
+    }
+    while (value_len && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) {
+        value_len--;
+    }
+
+    if ((value_len == 4 && strncasecmp(value, "gzip", 4) == 0) ||
+        (value_len == 6 && strncasecmp(value, "x-gzip", 6) == 0)) {
+        body->encoding = HTTP_TRANSPORT_ENCODING_GZIP;
+    } else if (value_len == 7 && strncasecmp(value, "deflate", 7) == 0) {
+        body->encoding = HTTP_TRANSPORT_ENCODING_DEFLATE;
+    } else if (!(value_len == 8 && strncasecmp(value, "identity", 8) == 0)) {
+        // Stacked or unknown codings are passed through untouched
+        ESP_LOGW(TAG, "Not decoding Content-Encoding: %.*s", (int)value_len, value);
+    }
+}
+
+/**
+ * @brief Make room for at least extra more bytes plus the terminator
+ *
+ * Never grows past max_len + 1 when there is a limit.
+ */
+static bool reserve(http_transport_body_t *body, size_t extra) {
+    size_t need = body->len + extra + 1;
+    if (need <= body->cap) {
+        return true;
+    }
+    size_t new_cap = body->cap ? body->cap * 2 : 1024;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    if (body->max_len && new_cap > body->max_len + 1) {
+        new_cap = body->max_len + 1;
+    }
+    if (new_cap < need) {
+        return false;
+    }
+    char *new_data = bulk_realloc(body->data, new_cap);
+    if (!new_data) {
+        return false;
+    }
+    body->data = new_data;
+    body->cap = new_cap;
+    return true;
+}
+
+static void tail_update(http_transport_inflate_t *d, const uint8_t *data, size_t len) {
+    if (len >= sizeof(d->tail)) {
+        memcpy(d->tail, data + len - sizeof(d->tail), sizeof(d->tail));
+        d->tail_len = sizeof(d->tail);
+        return;
+    }
+    size_t keep = d->tail_len + len > sizeof(d->tail) ? sizeof(d->tail) - len : d->tail_len;
+    memmove(d->tail, d->tail + d->tail_len - keep, keep);
+    memcpy(d->tail + keep, data, len);
+    d->tail_len = keep + len;
+}
+
+/**
+ * @brief Pick the next optional gzip header field that FLG announces
+ */
+static void gzip_next_field(http_transport_inflate_t *d) {
+    d->count = 0;
+    d->skip = 0;
+    if (d->gzip_flags & GZIP_FEXTRA) {
+        d->gzip_flags &= ~GZIP_FEXTRA;
+        d->stage = GZIP_XLEN;
+    } else if (d->gzip_flags & GZIP_FNAME) {
+        d->gzip_flags &= ~GZIP_FNAME;
+        d->stage = GZIP_STRING;
+    } else if (d->gzip_flags & GZIP_FCOMMENT) {
+        d->gzip_flags &= ~GZIP_FCOMMENT;
+        d->stage = GZIP_STRING;
+    } else if (d->gzip_flags & GZIP_FHCRC) {
+        d->gzip_flags &= ~GZIP_FHCRC;
+        d->stage = GZIP_SKIP;
+        d->skip = 2;
+    } else {
+        d->stage = GZIP_DATA;
+    }
+}
+
+/**
+ * @brief Consume gzip header bytes (the header may span several chunks)
+ *
+ * @return false if this is not a gzip deflate member
+ */
+static bool gzip_header(http_transport_inflate_t *d, const uint8_t **in, size_t *in_len) {
+    while (*in_len && d->stage != GZIP_DATA) {
+        uint8_t c = *(*in)++;
+        (*in_len)--;
+
+        switch (d->stage) {
+            case GZIP_FIXED:
+                d->fixed[d->count++] = c;
+                if (d->count == sizeof(d->fixed)) {
+                    if (d->fixed[0] != 0x1f || d->fixed[1] != 0x8b || d->fixed[2] != 8 ||
+                        (d->fixed[3] & GZIP_RESERVED)) {
+                        return false;
+                    }
+                    d->gzip_flags = d->fixed[3];
+                    gzip_next_field(d);
+                }
+                break;
+
+            case GZIP_XLEN:
+                d->skip |= (size_t)c << (8 * d->count);
+                if (++d->count == 2) {
+                    d->stage = GZIP_SKIP;
+                    if (!d->skip) {
+                        gzip_next_field(d);
+                    }
+                }
+                break;
+
+            case GZIP_SKIP:
+                if (--d->skip == 0) {
+                    gzip_next_field(d);
+                }
+                break;
+
+            case GZIP_STRING:
+                if (c == 0) {
+                    gzip_next_field(d);
+                }
+                break;
+
+            case GZIP_DATA:
+                break;
+        }
+    }
+    if (d->stage == GZIP_DATA) {
+        d->phase = PHASE_DATA;
+    }
+    return true;
+}
+
+/**
+ * @brief Inflate straight into the body buffer
+ *
+ * The buffer is passed as a non-wrapping output buffer, so earlier output
+ * doubles as the LZ77 window. tinfl keeps offsets, not pointers, across
+ * calls, so the buffer may move when it grows.
+ */
+static esp_err_t inflate_data(http_transport_body_t *body, const uint8_t **in, size_t *in_len) {
+    http_transport_inflate_t *d = body->inflate;
+
+    if (!d->flags_known) {
+        // RFC 9110 deflate is zlib-wrapped, but some servers send raw deflate
+        uint8_t cmf = (*in)[0];
+        if (body->encoding == HTTP_TRANSPORT_ENCODING_DEFLATE && (cmf & 0x0f) == 8 && (cmf >> 4) <= 7) {
+            d->flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32;
+        }
+        d->flags_known = true;
+    }
+
+    while (*in_len) {
+        size_t room = body->cap ? body->cap - body->len - 1 : 0;
+        size_t want = HTTP_TRANSPORT_BODY_MIN_ROOM;
+        if (body->max_len && want > body->max_len - body->len) {
+            want = body->max_len - body->len;
+        }
+        if (room < want) {
+            if (!reserve(body, want)) {
+                ESP_LOGE(TAG, "Failed to expand response buffer");
+                return ESP_ERR_NO_MEM;
+            }
+            continue;
+        }
+        bool at_limit = body->max_len && body->len + room >= body->max_len;
+
+        size_t in_bytes = *in_len;
+        size_t out_bytes = room;
+        uint8_t *out = (uint8_t *)body->data + body->len;
+        tinfl_status status = tinfl_decompress(&d->tinfl, *in, &in_bytes,
+                                               (uint8_t *)body->data, out, &out_bytes,
+                                               d->flags | TINFL_FLAG_HAS_MORE_INPUT |
+                                               TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+        if (body->encoding == HTTP_TRANSPORT_ENCODING_GZIP) {
+            d->crc = esp_rom_crc32_le(d->crc, out, out_bytes);
+        }
+        body->len += out_bytes;
+        body->data[body->len] = '\0';
+        *in += in_bytes;
+        *in_len -= in_bytes;
+
+        if (status == TINFL_STATUS_DONE) {
+            d->phase = PHASE_DONE;
+            *in_len = 0;    // gzip trailer, checked from the tail at the end
+            return ESP_OK;
+        }
+        if (status < 0) {
+            ESP_LOGE(TAG, "Corrupt compressed body (tinfl status %d)", (int)status);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (status == TINFL_STATUS_HAS_MORE_OUTPUT && out_bytes == room && at_limit) {
+            ESP_LOGE(TAG, "Response too large (limit %zu bytes decoded)", body->max_len);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t inflate_write(http_transport_body_t *body, const uint8_t *in, size_t len) {
+    if (!body->inflate) {
+        body->inflate = calloc(1, sizeof(http_transport_inflate_t));
+        if (!body->inflate) {
+            ESP_LOGE(TAG, "No memory for the inflate state");
+            return ESP_ERR_NO_MEM;
+        }
+        tinfl_init(&body->inflate->tinfl);
+        body->inflate->phase = body->encoding == HTTP_TRANSPORT_ENCODING_GZIP ? PHASE_HEADER : PHASE_DATA;
+    }
+    http_transport_inflate_t *d = body->inflate;
+    tail_update(d, in, len);
+
+    while (len) {
+        switch (d->phase) {
+            case PHASE_HEADER:
+                if (!gzip_header(d, &in, &len)) {
+                    ESP_LOGE(TAG, "Body is not gzip encoded");
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                break;
+
+            case PHASE_DATA: {
+                esp_err_t err = inflate_data(body, &in, &len);
+                if (err != ESP_OK) {
+                    return err;
+                }
+                break;
+            }
+
+            case PHASE_DONE:
+                len = 0;
+                break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t http_transport_body_write(http_transport_body_t *body, const void *data, size_t len) {
+    if (!len) {
+        return ESP_OK;
+    }
+    body->wire_len += len;
+    if (body->encoding != HTTP_TRANSPORT_ENCODING_IDENTITY) {
+        return inflate_write(body, data, len);
+    }
+
+    if (body->max_len && body->len + len > body->max_len) {
+        ESP_LOGE(TAG, "Response too large (limit %zu bytes)", body->max_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!reserve(body, len)) {
+        ESP_LOGE(TAG, "Failed to expand response buffer");
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(body->data + body->len, data, len);
+    body->len += len;
+    body->data[body->len] = '\0';
+    return ESP_OK;
+}
+
+esp_err_t http_transport_body_finish(http_transport_body_t *body) {
+    http_transport_inflate_t *d = body->inflate;
+    if (body->encoding == HTTP_TRANSPORT_ENCODING_IDENTITY || !body->wire_len) {
+        return ESP_OK;  // Plain, or no body at all (HEAD, 204, 304)
+    }
+
+    esp_err_t err = ESP_OK;
+    if (!d || d->phase != PHASE_DONE) {
+        ESP_LOGE(TAG, "Compressed body is truncated");
+        err = ESP_ERR_INVALID_RESPONSE;
+    } else if (body->encoding == HTTP_TRANSPORT_ENCODING_GZIP) {
+        uint32_t crc = d->tail[0] | d->tail[1] << 8 | d->tail[2] << 16 | (uint32_t)d->tail[3] << 24;
+        uint32_t isize = d->tail[4] | d->tail[5] << 8 | d->tail[6] << 16 | (uint32_t)d->tail[7] << 24;
+        if (d->tail_len < sizeof(d->tail) || crc != d->crc || isize != (uint32_t)body->len) {
+            ESP_LOGE(TAG, "gzip trailer mismatch");
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    if (err == ESP_OK) {
+        ESP_LOGD(TAG, "Inflated %zu -> %zu bytes", body->wire_len, body->len);
+    }
+    free(body->inflate);
+    body->inflate = NULL;
+    return err;
+}
+
+void http_transport_body_free(http_transport_body_t *body) {
+    free(body->data);
+    free(body->inflate);
+    body->data = NULL;
+    body->inflate = NULL;
+    body->len = 0;
+    body->cap = 0;
+}
@@ -0,0 +1,80 @@
+#ifndef HTTP_TRANSPORT_BODY_H
+#define HTTP_TRANSPORT_BODY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Internal: response body buffer shared by the HTTP/1.1 and HTTP/2 paths,
+// with streaming gzip/deflate decoding
+
+#define HTTP_TRANSPORT_BODY_MIN_ROOM 1024   // Grow the body before inflating into less
+
+typedef enum {
+    HTTP_TRANSPORT_ENCODING_IDENTITY = 0,
+    HTTP_TRANSPORT_ENCODING_GZIP,
+    HTTP_TRANSPORT_ENCODING_DEFLATE,        // zlib-wrapped or raw
+} http_transport_encoding_t;
+
+typedef struct http_transport_inflate_t http_transport_inflate_t;
+
+/**
+ * @brief Growing, NUL-terminated response body
+ */
+typedef struct {
+    char *data;                             // Decoded body (NULL until the first byte)
+    size_t len;                             // Decoded length
+    size_t cap;
+    size_t max_len;                         // Decoded limit, 0 = unlimited
+    size_t wire_len;                        // Bytes received before decoding
+    bool decode;                            // Inflate gzip/deflate Content-Encoding
+    http_transport_encoding_t encoding;
+    http_transport_inflate_t *inflate;      // Decoder state while an encoded body streams
+} http_transport_body_t;
+
+/**
+ * @brief Prepare an empty body
+ *
+ * @param max_len Decoded size limit, 0 = unlimited
+ * @param decode Inflate the body if the response says it is gzip/deflate encoded
+ */
+void http_transport_body_init(http_transport_body_t *body, size_t max_len, bool decode);
+
+/**
+ * @brief Record the Content-Encoding response header (before any data)
+ */
+void http_transport_body_set_encoding(http_transport_body_t *body, const char *value, size_t value_len);
+
+/**
+ * @brief Append received bytes, inflating them if the body is encoded
+ *
+ * The decoded body is also the inflate window, so no 32 KB dictionary is
+ * needed and max_len bounds the memory an encoded response can take.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the decoded body exceeds max_len,
+ *         ESP_ERR_NO_MEM, or ESP_ERR_INVALID_RESPONSE if the encoding is corrupt
+ */
+esp_err_t http_transport_body_write(http_transport_body_t *body, const void *data, size_t len);
+
+/**
+ * @brief Check that an encoded body ended cleanly and release the decoder
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_RESPONSE if it is truncated or fails its checksum
+ */
+esp_err_t http_transport_body_finish(http_transport_body_t *body);
+
+/**
+ * @brief Free the body and decoder
+ */
+void http_transport_body_free(http_transport_body_t *body);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_TRANSPORT_BODY_H
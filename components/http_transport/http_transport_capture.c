@@ -0,0 +1,371 @@
+#include "http_transport_capture.h"
+#include "bulk_mem.h"
+#include "esp_log.h"
+#include "sync_util.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "http_capture";
+
+/**
+ * @brief Decoded fixed part of a record
+ */
+typedef struct {
+    uint8_t method;
+    uint16_t status;
+    int32_t err;
+    uint32_t latency_us;
+    uint32_t body_hash;
+    uint16_t url_len;
+    uint32_t headers_len;
+    uint32_t body_len;
+    const uint8_t *url;             // Points into the capture
+    const uint8_t *headers;
+    const uint8_t *body;
+} capture_record_t;
+
+static http_transport_capture_sink_t s_sink;
+static void *s_sink_ctx;
+static sync_mutex_t s_sink_lock = SYNC_MUTEX_INIT;
+
+// Replay state: lookups scan the records, so a mutex rather than a spinlock
+static sync_mutex_t s_replay_lock = SYNC_MUTEX_INIT;
+static const uint8_t *s_replay;
+static size_t s_replay_len;
+static uint32_t s_latency_pct;
+static size_t s_record_count;
+static uint32_t *s_record_offsets;
+static uint32_t *s_record_keys;     // Hash of method and URL, compared before decoding
+static uint8_t *s_record_used;
+static http_transport_replay_stats_t s_replay_stats;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;    // s_sink, s_sink_ctx
+
+static uint32_t fnv1a32(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static uint32_t record_key(uint8_t method, const void *url, size_t url_len) {
+    return fnv1a32(url, url_len) ^ method;
+}
+
+static uint32_t body_hash(const http_transport_request_t *request) {
+    if (!request->body || request->body_reader || !request->body_len) {
+        return 0;
+    }
+    return fnv1a32(request->body, request->body_len);
+}
+
+static uint8_t *put_le(uint8_t *p, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        *p++ = (uint8_t)(value >> (8 * i));
+    }
+    return p;
+}
+
+static uint32_t get_le(const uint8_t *p, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Decode the record at offset
+ *
+ * @return Offset of the next record, or 0 if the record is truncated
+ */
+static size_t record_decode(const uint8_t *data, size_t len, size_t offset, capture_record_t *rec) {
+    if (len - offset < HTTP_TRANSPORT_CAPTURE_RECORD_HEADER_LEN) {
+        return 0;
+    }
+    const uint8_t *p = data + offset;
+    rec->method = p[0];
+    rec->status = (uint16_t)get_le(p + 2, 2);
+    rec->err = (int32_t)get_le(p + 4, 4);
+    rec->latency_us = get_le(p + 8, 4);
+    rec->body_hash = get_le(p + 12, 4);
+    rec->url_len = (uint16_t)get_le(p + 16, 2);
+    rec->headers_len = get_le(p + 18, 4);
+    rec->body_len = get_le(p + 22, 4);
+
+    size_t payload = (size_t)rec->url_len + rec->headers_len + rec->body_len;
+    offset += HTTP_TRANSPORT_CAPTURE_RECORD_HEADER_LEN;
+    if (payload > len - offset) {
+        return 0;
+    }
+    rec->url = data + offset;
+    rec->headers = rec->url + rec->url_len;
+    rec->body = rec->headers + rec->headers_len;
+    return offset + payload;
+}
+
+static void sink_lock(void) {
+    sync_mutex_take(&s_sink_lock);
+}
+
+static void sink_unlock(void) {
+    sync_mutex_give(&s_sink_lock);
+}
+
+esp_err_t http_transport_capture_start(http_transport_capture_sink_t sink, void *sink_ctx) {
+    if (!sink) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    http_transport_replay_stop(NULL);
+
+    uint8_t header[HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN] = { 0 };
+    memcpy(header, HTTP_TRANSPORT_CAPTURE_MAGIC, 4);
+    header[4] = HTTP_TRANSPORT_CAPTURE_VERSION;
+
+    sink_lock();
+    sink(sink_ctx, header, sizeof(header));
+    portENTER_CRITICAL(&s_lock);
+    s_sink = sink;
+    s_sink_ctx = sink_ctx;
+    portEXIT_CRITICAL(&s_lock);
+    sink_unlock();
+
+    ESP_LOGI(TAG, "Capturing traffic");
+    return ESP_OK;
+}
+
+void http_transport_capture_stop(void) {
+    sink_lock();
+    portENTER_CRITICAL(&s_lock);
+    s_sink = NULL;
+    s_sink_ctx = NULL;
+    portEXIT_CRITICAL(&s_lock);
+    sink_unlock();
+}
+
+void http_transport_capture_record(const http_transport_request_t *request,
+                                   const http_transport_response_t *response, esp_err_t err,
+                                   uint32_t latency_us) {
+    portENTER_CRITICAL(&s_lock);
+    bool capturing = s_sink != NULL;
+    portEXIT_CRITICAL(&s_lock);
+    if (!capturing || !request || !request->url || !response) {
+        return;
+    }
+
+    size_t url_len = strlen(request->url);
+    size_t headers_len = err == ESP_OK && response->headers ? strlen(response->headers) : 0;
+    size_t body_len = err == ESP_OK && response->body ? response->body_len : 0;
+    if (url_len > UINT16_MAX) {
+        return;
+    }
+    size_t total = HTTP_TRANSPORT_CAPTURE_RECORD_HEADER_LEN + url_len + headers_len + body_len;
+    uint8_t *record = bulk_alloc(total);
+    if (!record) {
+        ESP_LOGW(TAG, "No memory to record %s", request->url);
+        return;
+    }
+
+    uint8_t *p = record;
+    *p++ = (uint8_t)request->method;
+    *p++ = 0;
+    p = put_le(p, err == ESP_OK ? (uint32_t)response->status_code : 0, 2);
+    p = put_le(p, (uint32_t)err, 4);
+    p = put_le(p, latency_us, 4);
+    p = put_le(p, body_hash(request), 4);
+    p = put_le(p, (uint32_t)url_len, 2);
+    p = put_le(p, (uint32_t)headers_len, 4);
+    p = put_le(p, (uint32_t)body_len, 4);
+    memcpy(p, request->url, url_len);
+    if (headers_len) {
+        memcpy(p + url_len, response->headers, headers_len);
+    }
+    if (body_len) {
+        memcpy(p + url_len + headers_len, response->body, body_len);
+    }
+
+    sink_lock();
+    if (s_sink) {   // Stopped while the record was built
+        s_sink(s_sink_ctx, record, total);
+    }
+    sink_unlock();
+    free(record);
+}
+
+esp_err_t http_transport_replay_start(const uint8_t *capture, size_t len, uint32_t latency_pct) {
+    if (!capture || len < HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN ||
+        memcmp(capture, HTTP_TRANSPORT_CAPTURE_MAGIC, 4) != 0 ||
+        capture[4] != HTTP_TRANSPORT_CAPTURE_VERSION) {
+        ESP_LOGE(TAG, "Not a version %d capture", HTTP_TRANSPORT_CAPTURE_VERSION);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Index the records once; lookups then only compare
+    size_t count = 0;
+    capture_record_t rec;
+    for (size_t offset = HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN; offset < len; count++) {
+        offset = record_decode(capture, len, offset, &rec);
+        if (!offset) {
+            ESP_LOGE(TAG, "Capture truncated in record %u", (unsigned)count);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    uint32_t *offsets = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *keys = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint8_t *used = calloc(count ? count : 1, 1);
+    if (!offsets || !keys || !used) {
+        free(offsets);
+        free(keys);
+        free(used);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t offset = HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN;
+    for (size_t i = 0; i < count; i++) {
+        offsets[i] = (uint32_t)offset;
+        offset = record_decode(capture, len, offset, &rec);
+        keys[i] = record_key(rec.method, rec.url, rec.url_len);
+    }
+
+    http_transport_capture_stop();
+    http_transport_replay_stop(NULL);
+    sync_mutex_take(&s_replay_lock);
+    s_replay = capture;
+    s_replay_len = len;
+    s_latency_pct = latency_pct;
+    s_record_count = count;
+    s_record_offsets = offsets;
+    s_record_keys = keys;
+    s_record_used = used;
+    memset(&s_replay_stats, 0, sizeof(s_replay_stats));
+    sync_mutex_give(&s_replay_lock);
+
+    ESP_LOGI(TAG, "Replaying %u records at %lu%% latency", (unsigned)count, (unsigned long)latency_pct);
+    return ESP_OK;
+}
+
+void http_transport_replay_stop(http_transport_replay_stats_t *stats_out) {
+    sync_mutex_take(&s_replay_lock);
+    uint32_t *offsets = s_record_offsets;
+    uint32_t *keys = s_record_keys;
+    uint8_t *used = s_record_used;
+    if (stats_out) {
+        *stats_out = s_replay_stats;
+    }
+    s_replay = NULL;
+    s_record_count = 0;
+    s_record_offsets = NULL;
+    s_record_keys = NULL;
+    s_record_used = NULL;
+    sync_mutex_give(&s_replay_lock);
+
+    free(offsets);
+    free(keys);
+    free(used);
+}
+
+static bool record_matches(const capture_record_t *rec, const http_transport_request_t *request,
+                           size_t url_len) {
+    return rec->method == (uint8_t)request->method && rec->url_len == url_len &&
+           memcmp(rec->url, request->url, url_len) == 0;
+}
+
+bool http_transport_replay_perform(const http_transport_request_t *request,
+                                   http_transport_response_t *response, esp_err_t *err_out) {
+    if (!request || !request->url || !response) {
+        return false;   // Let the transport report it
+    }
+    size_t url_len = strlen(request->url);
+    uint32_t key = record_key((uint8_t)request->method, request->url, url_len);
+    uint32_t hash = body_hash(request);
+    capture_record_t rec;
+    bool found = false;
+
+    sync_mutex_take(&s_replay_lock);
+    if (!s_replay) {
+        sync_mutex_give(&s_replay_lock);
+        return false;
+    }
+    int first_same_url = -1;
+    for (size_t i = 0; i < s_record_count; i++) {
+        if (s_record_used[i] || s_record_keys[i] != key) {
+            continue;
+        }
+        record_decode(s_replay, s_replay_len, s_record_offsets[i], &rec);
+        if (!record_matches(&rec, request, url_len)) {
+            continue;
+        }
+        if (rec.body_hash == hash) {
+            s_record_used[i] = 1;
+            found = true;
+            break;
+        }
+        if (first_same_url < 0) {
+            first_same_url = (int)i;
+        }
+    }
+    if (!found && first_same_url >= 0) {
+        // Bodies with per-run content (ids, signatures) still replay in order
+        s_record_used[first_same_url] = 1;
+        record_decode(s_replay, s_replay_len, s_record_offsets[first_same_url], &rec);
+        s_replay_stats.inexact++;
+        found = true;
+    }
+    if (found) {
+        s_replay_stats.served++;
+    } else {
+        s_replay_stats.missing++;
+    }
+    uint64_t delay_us = found ? (uint64_t)rec.latency_us * s_latency_pct / 100 : 0;
+    sync_mutex_give(&s_replay_lock);
+
+    memset(response, 0, sizeof(http_transport_response_t));
+    response->sent = found;     // Not recorded; a replayed error may have reached the server
+    if (!found) {
+        ESP_LOGW(TAG, "No recorded response for %s", request->url);
+        *err_out = ESP_ERR_NOT_FOUND;
+        return true;
+    }
+
+    if (delay_us >= 1000) {
+        vTaskDelay(pdMS_TO_TICKS(delay_us / 1000));
+    }
+
+    if (rec.err != ESP_OK) {
+        *err_out = rec.err;
+        return true;
+    }
+    if (request->max_response && rec.body_len > request->max_response) {
+        *err_out = ESP_ERR_INVALID_SIZE;
+        return true;
+    }
+    if (rec.headers_len) {
+        response->headers = bulk_alloc(rec.headers_len + 1);
+    }
+    if (rec.body_len) {
+        response->body = bulk_alloc(rec.body_len + 1);
+    }
+    if ((rec.headers_len && !response->headers) || (rec.body_len && !response->body)) {
+        http_transport_response_free(response);
+        *err_out = ESP_ERR_NO_MEM;
+        return true;
+    }
+    if (response->headers) {
+        memcpy(response->headers, rec.headers, rec.headers_len);
+        response->headers[rec.headers_len] = '\0';
+    }
+    if (response->body) {
+        memcpy(response->body, rec.body, rec.body_len);
+        response->body[rec.body_len] = '\0';
+    }
+    response->status_code = rec.status;
+    response->body_len = rec.body_len;
+    response->wire_len = rec.body_len;
+    response->conn = HTTP_TRANSPORT_CONN_REUSED;
+
+    *err_out = ESP_OK;
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef HTTP_TRANSPORT_CAPTURE_H
+#define HTTP_TRANSPORT_CAPTURE_H
+
+#include "http_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Traffic capture and deterministic replay (built with -DHTTP_TRANSPORT_CAPTURE=ON)
+//
+// A capture is a "HTCP" magic, a version byte and three reserved bytes,
+// followed by one record per http_transport_perform call, little-endian:
+//
+//   u8  method          esp_http_client_method_t
+//   u8  reserved
+//   u16 status          HTTP status (0 if err is set)
+//   i32 err             esp_err_t returned by http_transport_perform
+//   u32 latency_us      Wall time of the call
+//   u32 body_hash       FNV-1a of the request body (0 for none or streamed)
+//   u16 url_len
+//   u32 headers_len
+//   u32 body_len        Decoded response body
+//   url, response headers, response body
+//
+// Request headers are not recorded: they carry signatures and blockhashes
+// that differ between runs.
+
+#define HTTP_TRANSPORT_CAPTURE_MAGIC "HTCP"
+#define HTTP_TRANSPORT_CAPTURE_VERSION 1
+#define HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN 8
+#define HTTP_TRANSPORT_CAPTURE_RECORD_HEADER_LEN 26
+
+/**
+ * @brief Receives capture bytes (e.g. appends them to a file)
+ *
+ * Called once for the file header and once per record, never concurrently.
+ *
+ * @param ctx sink_ctx from http_transport_capture_start
+ * @param data Bytes to store
+ * @param len Length of data
+ */
+typedef void (*http_transport_capture_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Replay counters
+ */
+typedef struct {
+    uint32_t served;                    // Requests answered from the capture
+    uint32_t inexact;                   // ... matched on method and URL only
+    uint32_t missing;                   // Requests with no unused matching record
+} http_transport_replay_stats_t;
+
+/**
+ * @brief Record every request from now on
+ *
+ * Writes the file header, then one record per completed request (from any
+ * task, RPC, x402 API or facilitator). Stops a running replay.
+ *
+ * @param sink Receives the capture bytes
+ * @param sink_ctx Passed to sink
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if sink is NULL
+ */
+esp_err_t http_transport_capture_start(http_transport_capture_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Stop recording (returns once no record is being written)
+ */
+void http_transport_capture_stop(void);
+
+/**
+ * @brief Serve requests from a capture instead of the network
+ *
+ * Each request takes the first unused record with the same method, URL and
+ * request body, or else the same method and URL, so a flow replays in
+ * recorded order. The caller waits for the recorded latency scaled by
+ * latency_pct (100 = as recorded, 0 = none), so wall time reflects the
+ * recording and CPU time only this build's client work. Requests without a
+ * record fail with ESP_ERR_NOT_FOUND.
+ *
+ * @param capture Capture bytes (must stay valid until replay stops)
+ * @param len Length of capture
+ * @param latency_pct Percentage of recorded latency to apply
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE if capture is malformed,
+ *         ESP_ERR_NO_MEM if the record index cannot be allocated
+ */
+esp_err_t http_transport_replay_start(const uint8_t *capture, size_t len, uint32_t latency_pct);
+
+/**
+ * @brief Go back to the network
+ *
+ * @param stats_out Output: counters of the replay, can be NULL
+ */
+void http_transport_replay_stop(http_transport_replay_stats_t *stats_out);
+
+/**
+ * @brief Answer a request from the running replay (internal)
+ *
+ * @return true if a replay is running and err_out is the result to return
+ */
+bool http_transport_replay_perform(const http_transport_request_t *request,
+                                   http_transport_response_t *response, esp_err_t *err_out);
+
+/**
+ * @brief Record a completed request if capturing (internal)
+ */
+void http_transport_capture_record(const http_transport_request_t *request,
+                                   const http_transport_response_t *response, esp_err_t err,
+                                   uint32_t latency_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_TRANSPORT_CAPTURE_H
@@ -0,0 +1,258 @@
+#include "http_transport_dns.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "http_dns";
+
+/**
+ * @brief Cached lookup for one host
+ */
+typedef struct {
+    char host[HTTP_TRANSPORT_DNS_MAX_HOST_LEN];
+    char addr[HTTP_TRANSPORT_DNS_ADDR_LEN];     // Empty until resolved once
+    int64_t expires_us;                         // Positive entry expiry
+    int64_t negative_until_us;                  // Fail fast until then
+    int64_t last_used_us;
+} dns_entry_t;
+
+static dns_entry_t s_entries[HTTP_TRANSPORT_DNS_CACHE_SIZE];
+static http_transport_dns_stats_t s_stats;
+static TaskHandle_t s_refresh_task;
+static bool s_refresh_starting;
+static portMUX_TYPE s_dns_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool is_literal(const char *host) {
+    struct in_addr v4;
+    struct in6_addr v6;
+    return inet_pton(AF_INET, host, &v4) == 1 || inet_pton(AF_INET6, host, &v6) == 1;
+}
+
+/**
+ * @brief Blocking getaddrinfo, first result as text
+ */
+static bool dns_lookup(const char *host, char *addr_out, size_t max_len) {
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+
+    int ret = getaddrinfo(host, NULL, &hints, &res);
+    if (ret != 0 || !res) {
+        ESP_LOGW(TAG, "Lookup of %s failed: %d", host, ret);
+        return false;
+    }
+
+    const void *src = NULL;
+    if (res->ai_family == AF_INET) {
+        src = &((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    } else if (res->ai_family == AF_INET6) {
+        src = &((struct sockaddr_in6 *)res->ai_addr)->sin6_addr;
+    }
+    bool ok = src && inet_ntop(res->ai_family, src, addr_out, max_len) != NULL;
+    freeaddrinfo(res);
+    return ok;
+}
+
+static dns_entry_t *entry_find(const char *host) {
+    for (int i = 0; i < HTTP_TRANSPORT_DNS_CACHE_SIZE; i++) {
+        if (strcmp(s_entries[i].host, host) == 0) {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find or take over (empty, then least recently used) an entry
+ */
+static dns_entry_t *entry_claim(const char *host) {
+    dns_entry_t *e = entry_find(host);
+    if (e) {
+        return e;
+    }
+    e = &s_entries[0];
+    for (int i = 0; i < HTTP_TRANSPORT_DNS_CACHE_SIZE; i++) {
+        if (!s_entries[i].host[0]) {
+            e = &s_entries[i];
+            break;
+        }
+        if (s_entries[i].last_used_us < e->last_used_us) {
+            e = &s_entries[i];
+        }
+    }
+    memset(e, 0, sizeof(*e));
+    strcpy(e->host, host);
+    return e;
+}
+
+/**
+ * @brief Re-resolve entries that are about to expire
+ *
+ * A failed refresh keeps the old address and retries after the negative TTL,
+ * so a flaky resolver never takes a known host away from callers.
+ */
+static void dns_refresh_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HTTP_TRANSPORT_DNS_NEGATIVE_TTL_MS));
+
+        for (int i = 0; i < HTTP_TRANSPORT_DNS_CACHE_SIZE; i++) {
+            char host[HTTP_TRANSPORT_DNS_MAX_HOST_LEN];
+            bool due;
+
+            portENTER_CRITICAL(&s_dns_lock);
+            dns_entry_t *e = &s_entries[i];
+            due = e->addr[0] &&
+                  esp_timer_get_time() >= e->expires_us - HTTP_TRANSPORT_DNS_REFRESH_AHEAD_MS * 1000LL;
+            strcpy(host, e->host);
+            portEXIT_CRITICAL(&s_dns_lock);
+
+            if (!due) {
+                continue;
+            }
+
+            char addr[HTTP_TRANSPORT_DNS_ADDR_LEN];
+            bool ok = dns_lookup(host, addr, sizeof(addr));
+            int64_t now = esp_timer_get_time();
+
+            portENTER_CRITICAL(&s_dns_lock);
+            if (strcmp(e->host, host) == 0) {   // Not flushed or evicted meanwhile
+                if (ok) {
+                    strcpy(e->addr, addr);
+                    e->expires_us = now + HTTP_TRANSPORT_DNS_TTL_MS * 1000LL;
+                    s_stats.refreshes++;
+                } else {
+                    e->expires_us = now + (HTTP_TRANSPORT_DNS_REFRESH_AHEAD_MS +
+                                           HTTP_TRANSPORT_DNS_NEGATIVE_TTL_MS) * 1000LL;
+                    s_stats.failures++;
+                }
+            }
+            portEXIT_CRITICAL(&s_dns_lock);
+
+            ESP_LOGD(TAG, "Refreshed %s: %s", host, ok ? addr : "failed, keeping last address");
+        }
+    }
+}
+
+static void refresh_task_wake(bool notify) {
+    bool start = false;
+    portENTER_CRITICAL(&s_dns_lock);
+    if (!s_refresh_task && !s_refresh_starting) {
+        s_refresh_starting = true;
+        start = true;
+    }
+    TaskHandle_t task = s_refresh_task;
+    portEXIT_CRITICAL(&s_dns_lock);
+
+    if (start) {
+        TaskHandle_t created = NULL;
+        if (xTaskCreate(dns_refresh_task, "http_dns", HTTP_TRANSPORT_DNS_TASK_STACK_SIZE,
+                        NULL, tskIDLE_PRIORITY + 1, &created) != pdPASS) {
+            ESP_LOGW(TAG, "Refresh task unavailable, entries refresh on expiry only");
+            created = NULL;
+        }
+        portENTER_CRITICAL(&s_dns_lock);
+        s_refresh_task = created;
+        s_refresh_starting = false;
+        portEXIT_CRITICAL(&s_dns_lock);
+        task = created;
+    }
+
+    if (notify && task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+esp_err_t http_transport_dns_resolve(const char *host, char *addr_out, size_t max_len) {
+    if (!host || !addr_out || !max_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(host) >= HTTP_TRANSPORT_DNS_MAX_HOST_LEN || is_literal(host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t now = esp_timer_get_time();
+    char addr[HTTP_TRANSPORT_DNS_ADDR_LEN];
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    bool answered = false;
+    bool wake = false;
+
+    portENTER_CRITICAL(&s_dns_lock);
+    dns_entry_t *e = entry_find(host);
+    if (e && e->addr[0]) {
+        e->last_used_us = now;
+        strcpy(addr, e->addr);
+        if (now < e->expires_us) {
+            s_stats.hits++;
+            wake = now >= e->expires_us - HTTP_TRANSPORT_DNS_REFRESH_AHEAD_MS * 1000LL;
+        } else {
+            // Serve the last known address; the refresh task catches up
+            s_stats.stale_hits++;
+            wake = true;
+        }
+        err = ESP_OK;
+        answered = true;
+    } else if (e && now < e->negative_until_us) {
+        s_stats.negative_hits++;
+        answered = true;
+    } else {
+        s_stats.misses++;
+    }
+    portEXIT_CRITICAL(&s_dns_lock);
+
+    if (answered) {
+        if (err == ESP_OK) {
+            snprintf(addr_out, max_len, "%s", addr);
+        }
+        if (wake) {
+            refresh_task_wake(true);
+        }
+        return err;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool ok = dns_lookup(host, addr, sizeof(addr));
+    now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_dns_lock);
+    e = entry_claim(host);
+    e->last_used_us = now;
+    if (ok) {
+        strcpy(e->addr, addr);
+        e->expires_us = now + HTTP_TRANSPORT_DNS_TTL_MS * 1000LL;
+    } else {
+        e->negative_until_us = now + HTTP_TRANSPORT_DNS_NEGATIVE_TTL_MS * 1000LL;
+        s_stats.failures++;
+    }
+    portEXIT_CRITICAL(&s_dns_lock);
+
+    if (!ok) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    ESP_LOGI(TAG, "Resolved %s -> %s in %lld ms", host, addr, (now - start) / 1000);
+    snprintf(addr_out, max_len, "%s", addr);
+    refresh_task_wake(false);
+    return ESP_OK;
+}
+
+void http_transport_dns_get_stats(http_transport_dns_stats_t *stats_out) {
+    if (!stats_out) {
+        return;
+    }
+    portENTER_CRITICAL(&s_dns_lock);
+    *stats_out = s_stats;
+    portEXIT_CRITICAL(&s_dns_lock);
+}
+
+void http_transport_dns_flush(void) {
+    portENTER_CRITICAL(&s_dns_lock);
+    memset(s_entries, 0, sizeof(s_entries));
+    portEXIT_CRITICAL(&s_dns_lock);
+}
@@ -0,0 +1,66 @@
+#ifndef HTTP_TRANSPORT_DNS_H
+#define HTTP_TRANSPORT_DNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_TRANSPORT_DNS_CACHE_SIZE 8             // Cached host names
+#define HTTP_TRANSPORT_DNS_MAX_HOST_LEN 64          // Longest cacheable host name
+#define HTTP_TRANSPORT_DNS_TTL_MS 300000            // Positive entry lifetime
+#define HTTP_TRANSPORT_DNS_NEGATIVE_TTL_MS 10000    // Failed lookup lifetime
+#define HTTP_TRANSPORT_DNS_REFRESH_AHEAD_MS 60000   // Refresh this long before expiry
+#define HTTP_TRANSPORT_DNS_TASK_STACK_SIZE 3072     // Background refresh task
+#define HTTP_TRANSPORT_DNS_ADDR_LEN 48              // Textual IPv4/IPv6 address
+
+/**
+ * @brief Resolver cache counters
+ */
+typedef struct {
+    uint32_t hits;          // Answered from a fresh entry
+    uint32_t stale_hits;    // Answered from an expired entry while refreshing
+    uint32_t negative_hits; // Failed fast on a cached lookup failure
+    uint32_t misses;        // Lookups that blocked the caller
+    uint32_t refreshes;     // Background refreshes that succeeded
+    uint32_t failures;      // Lookups (blocking or background) that failed
+} http_transport_dns_stats_t;
+
+/**
+ * @brief Resolve a host name through the cache
+ *
+ * The first lookup for a host blocks on getaddrinfo. After that the host is
+ * answered from RAM: a background task refreshes it before it expires, and
+ * if the refresh fails the last known address is kept. A failed first lookup
+ * is cached for HTTP_TRANSPORT_DNS_NEGATIVE_TTL_MS so callers fail fast on
+ * flaky WiFi. getaddrinfo does not report record TTLs, so entries use the
+ * fixed HTTP_TRANSPORT_DNS_TTL_MS.
+ *
+ * @param host Host name or literal address
+ * @param addr_out Output: address as text (IPv6 without brackets)
+ * @param max_len Size of addr_out (HTTP_TRANSPORT_DNS_ADDR_LEN is enough)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the host does not resolve,
+ *         ESP_ERR_INVALID_ARG if host is literal or too long to cache
+ */
+esp_err_t http_transport_dns_resolve(const char *host, char *addr_out, size_t max_len);
+
+/**
+ * @brief Get resolver cache counters
+ *
+ * @param stats_out Output: counters since boot
+ */
+void http_transport_dns_get_stats(http_transport_dns_stats_t *stats_out);
+
+/**
+ * @brief Drop all cached entries (e.g. after switching networks)
+ */
+void http_transport_dns_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_TRANSPORT_DNS_H
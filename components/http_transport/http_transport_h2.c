@@ -0,0 +1,721 @@
+#include "http_transport_h2.h"
+#include "http_transport_dns.h"
+#include "http_transport_body.h"
+#include "bulk_mem.h"
+#include "sync_util.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "mbedtls/ssl.h"
+#include "nghttp2/nghttp2.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "http_transport_h2";
+
+typedef enum {
+    H2_UNKNOWN = 0,     // Not negotiated yet (or the handshake failed)
+    H2_YES,             // Server selected "h2" via ALPN
+    H2_NO,              // Server speaks HTTP/1.1 only
+} h2_support_t;
+
+/**
+ * @brief HTTP/2 connection for one origin
+ *
+ * session and tls are only touched with lock held. Whoever holds the lock
+ * drives the session, which delivers frames for every open stream.
+ */
+typedef struct {
+    char origin[HTTP_TRANSPORT_MAX_ORIGIN_LEN];
+    h2_support_t support;
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_buf;
+    esp_tls_t *tls;
+    nghttp2_session *session;
+    uint32_t generation;        // Bumped on teardown; waiting streams are lost
+    int streams;                // Streams submitted and not yet finished
+    bool goaway;                // Server is draining the connection
+    bool replaced;              // Taken over from another origin; reset on next use
+    int64_t retry_us;           // After a failed handshake: no h2 attempt before this
+    uint32_t retry_ms;          // Backoff of the last failure, 0 once h2 worked
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t *saved_session;
+    uint8_t master[48];         // TLS 1.2 master secret of the last connection
+    bool has_master;
+#endif
+    int64_t last_used_us;
+    http_transport_stats_t stats;
+} h2_conn_t;
+
+/**
+ * @brief One request, attached to its stream as stream user data
+ */
+typedef struct {
+    const http_transport_request_t *request;
+    size_t body_sent;
+    int status_code;
+    char *headers;
+    size_t headers_len;
+    http_transport_body_t body;
+    esp_err_t body_err;         // First failure while receiving the body
+    bool sent;                  // HEADERS frame written to the connection
+    bool done;
+    uint32_t error_code;        // RST_STREAM / GOAWAY code, 0 on clean close
+} h2_stream_t;
+
+static h2_conn_t s_conns[HTTP_TRANSPORT_MAX_ORIGINS];
+static portMUX_TYPE s_h2_lock = portMUX_INITIALIZER_UNLOCKED;
+static sync_once_t s_init_once = SYNC_ONCE_INIT;
+
+static void h2_init(void *arg) {
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        s_conns[i].lock = xSemaphoreCreateMutexStatic(&s_conns[i].lock_buf);
+    }
+}
+
+/**
+ * @brief Find the connection for origin, or take over an unused/idle one
+ */
+static h2_conn_t *conn_acquire(const char *origin) {
+    h2_conn_t *result = NULL;
+    h2_conn_t *lru = NULL;
+
+    portENTER_CRITICAL(&s_h2_lock);
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        h2_conn_t *c = &s_conns[i];
+        if (strcmp(c->origin, origin) == 0) {
+            result = c;
+            break;
+        }
+        if (!c->origin[0]) {
+            if (!lru || lru->origin[0]) {
+                lru = c;
+            }
+        } else if (c->streams == 0 && (!lru || (lru->origin[0] && c->last_used_us < lru->last_used_us))) {
+            lru = c;
+        }
+    }
+    if (!result && lru) {
+        // The old connection, if any, is closed by the next lock holder
+        strcpy(lru->origin, origin);
+        lru->support = H2_UNKNOWN;
+        lru->replaced = true;
+        memset(&lru->stats, 0, sizeof(lru->stats));
+        result = lru;
+    }
+    portEXIT_CRITICAL(&s_h2_lock);
+    return result;
+}
+
+static void conn_teardown(h2_conn_t *conn) {
+    if (conn->session) {
+        nghttp2_session_del(conn->session);
+        conn->session = NULL;
+    }
+    if (conn->tls) {
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // Taken at close so a ticket sent after the handshake is included
+        esp_tls_client_session_t *session = esp_tls_get_client_session(conn->tls);
+        if (session) {
+            if (conn->saved_session) {
+                esp_tls_free_client_session(conn->saved_session);
+            }
+            conn->saved_session = session;
+        }
+#endif
+        esp_tls_conn_destroy(conn->tls);
+        conn->tls = NULL;
+    }
+    conn->generation++;
+    conn->streams = 0;
+    conn->goaway = false;
+}
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/**
+ * @brief Tell a resumed handshake from a full one that was offered a session
+ *
+ * An abbreviated TLS 1.2 handshake keeps the master secret of the session it
+ * resumes; a full one derives a new one. Session ids are no help here: with
+ * tickets the server may echo any id. TLS 1.3 keeps no master secret in the
+ * session, so there only the offer is known.
+ */
+static void tls_classify(h2_conn_t *conn, esp_tls_t *tls, http_transport_response_t *response) {
+    mbedtls_ssl_context *ssl = (mbedtls_ssl_context *)esp_tls_get_ssl_context(tls);
+    if (mbedtls_ssl_get_version_number(ssl) != MBEDTLS_SSL_VERSION_TLS1_2) {
+        if (conn->saved_session) {
+            response->conn = HTTP_TRANSPORT_CONN_TLS_OFFERED;
+        }
+        conn->has_master = false;
+        return;
+    }
+    const uint8_t *master = ssl->MBEDTLS_PRIVATE(session)->MBEDTLS_PRIVATE(master);
+    if (conn->saved_session && conn->has_master && memcmp(conn->master, master, sizeof(conn->master)) == 0) {
+        response->conn = HTTP_TRANSPORT_CONN_TLS_RESUMED;
+    }
+    memcpy(conn->master, master, sizeof(conn->master));
+    conn->has_master = true;
+}
+#endif
+
+static bool tls_readable(esp_tls_t *tls, int timeout_ms) {
+    if (esp_tls_get_bytes_avail(tls) > 0) {
+        return true;    // Already decrypted by mbedTLS
+    }
+    int fd;
+    if (esp_tls_get_conn_sockfd(tls, &fd) != ESP_OK || fd < 0) {
+        return false;
+    }
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    return select(fd + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+static ssize_t on_send(nghttp2_session *session, const uint8_t *data, size_t length,
+                       int flags, void *user_data) {
+    h2_conn_t *conn = (h2_conn_t *)user_data;
+    ssize_t ret = esp_tls_conn_write(conn->tls, data, length);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) {
+        return NGHTTP2_ERR_WOULDBLOCK;
+    }
+    return ret > 0 ? ret : NGHTTP2_ERR_CALLBACK_FAILURE;
+}
+
+static ssize_t on_recv(nghttp2_session *session, uint8_t *buf, size_t length,
+                       int flags, void *user_data) {
+    h2_conn_t *conn = (h2_conn_t *)user_data;
+    if (!tls_readable(conn->tls, 0)) {
+        return NGHTTP2_ERR_WOULDBLOCK;
+    }
+    ssize_t ret = esp_tls_conn_read(conn->tls, buf, length);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) {
+        return NGHTTP2_ERR_WOULDBLOCK;
+    }
+    if (ret == 0) {
+        return NGHTTP2_ERR_EOF;
+    }
+    return ret > 0 ? ret : NGHTTP2_ERR_CALLBACK_FAILURE;
+}
+
+static int on_header(nghttp2_session *session, const nghttp2_frame *frame,
+                     const uint8_t *name, size_t namelen, const uint8_t *value, size_t valuelen,
+                     uint8_t flags, void *user_data) {
+    h2_stream_t *st = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+    if (!st || frame->hd.type != NGHTTP2_HEADERS) {
+        return 0;
+    }
+
+    if (namelen == 7 && memcmp(name, ":status", 7) == 0) {
+        int status = 0;
+        for (size_t i = 0; i < valuelen && isdigit(value[i]); i++) {
+            status = status * 10 + (value[i] - '0');
+        }
+        st->status_code = status;
+        return 0;
+    }
+    if (namelen == 16 && memcmp(name, "content-encoding", 16) == 0) {
+        http_transport_body_set_encoding(&st->body, (const char *)value, valuelen);
+    }
+
+    // Same "Name: value\r\n" layout as the HTTP/1.1 path (names arrive lowercase)
+    if (st->headers_len + namelen + valuelen + 5 > HTTP_TRANSPORT_MAX_HEADERS_LEN) {
+        ESP_LOGW(TAG, "Dropping response header %.*s (header buffer full)", (int)namelen, name);
+        return 0;
+    }
+    if (!st->headers) {
+        st->headers = bulk_alloc(HTTP_TRANSPORT_MAX_HEADERS_LEN);
+        if (!st->headers) {
+            return 0;
+        }
+    }
+    st->headers_len += snprintf(st->headers + st->headers_len,
+                                HTTP_TRANSPORT_MAX_HEADERS_LEN - st->headers_len,
+                                "%.*s: %.*s\r\n", (int)namelen, name, (int)valuelen, value);
+    return 0;
+}
+
+static int on_data_chunk(nghttp2_session *session, uint8_t flags, int32_t stream_id,
+                         const uint8_t *data, size_t len, void *user_data) {
+    h2_stream_t *st = nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!st || st->body_err != ESP_OK) {
+        return 0;
+    }
+    st->body_err = http_transport_body_write(&st->body, data, len);
+    if (st->body_err != ESP_OK) {
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+    }
+    return 0;
+}
+
+static int on_stream_close(nghttp2_session *session, int32_t stream_id,
+                           uint32_t error_code, void *user_data) {
+    h2_stream_t *st = nghttp2_session_get_stream_user_data(session, stream_id);
+    if (st) {
+        st->done = true;
+        st->error_code = error_code;
+    }
+    return 0;
+}
+
+static int on_frame_recv(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
+    h2_conn_t *conn = (h2_conn_t *)user_data;
+    if (frame->hd.type == NGHTTP2_GOAWAY) {
+        ESP_LOGD(TAG, "GOAWAY from %s (last stream %d)", conn->origin, (int)frame->goaway.last_stream_id);
+        conn->goaway = true;
+    }
+    return 0;
+}
+
+static int on_frame_send(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
+    if (frame->hd.type == NGHTTP2_HEADERS) {
+        h2_stream_t *st = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+        if (st) {
+            st->sent = true;
+        }
+    }
+    return 0;
+}
+
+static ssize_t on_body_read(nghttp2_session *session, int32_t stream_id, uint8_t *buf,
+                            size_t length, uint32_t *data_flags, nghttp2_data_source *source,
+                            void *user_data) {
+    h2_stream_t *st = (h2_stream_t *)source->ptr;
+    size_t remaining = st->request->body_len - st->body_sent;
+    size_t n = remaining < length ? remaining : length;
+    memcpy(buf, st->request->body + st->body_sent, n);
+    st->body_sent += n;
+    if (st->body_sent == st->request->body_len) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return n;
+}
+
+/**
+ * @brief Connect, negotiate ALPN and start an HTTP/2 session
+ *
+ * Both "h2" and "http/1.1" are offered, so servers that only know HTTP/1.1
+ * complete the handshake instead of rejecting it.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED if the server did not select "h2" (or
+ *         the handshake failed before h2 ever worked: HTTP/1.1 serves this
+ *         request and h2 is tried again after a backoff), ESP_ERR_NOT_FOUND
+ *         if the host does not resolve, ESP_FAIL otherwise
+ */
+static esp_err_t conn_open(h2_conn_t *conn, int timeout_ms, http_transport_response_t *response) {
+    const char *hostport = strstr(conn->origin, "://") + 3;
+    size_t host_len = strcspn(hostport, ":");
+    char host[HTTP_TRANSPORT_DNS_MAX_HOST_LEN];
+    if (hostport[0] == '[' || host_len >= sizeof(host)) {
+        return ESP_ERR_NOT_SUPPORTED;   // Leave IPv6 literals and long names to HTTP/1.1
+    }
+    memcpy(host, hostport, host_len);
+    host[host_len] = '\0';
+    int port = hostport[host_len] == ':' ? atoi(hostport + host_len + 1) : 443;
+
+    char addr[HTTP_TRANSPORT_DNS_ADDR_LEN];
+    esp_err_t err = http_transport_dns_resolve(host, addr, sizeof(addr));
+    if (err == ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+    const char *target = err == ESP_OK ? addr : host;
+
+    static const char *alpn_protos[] = { "h2", "http/1.1", NULL };
+    esp_tls_cfg_t cfg = {
+        .alpn_protos = alpn_protos,
+        .timeout_ms = timeout_ms,
+        .common_name = host,
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .client_session = conn->saved_session,
+#endif
+    };
+
+    esp_tls_t *tls = esp_tls_init();
+    if (!tls) {
+        return ESP_ERR_NO_MEM;
+    }
+    int64_t start = esp_timer_get_time();
+    if (esp_tls_conn_new_sync(target, strlen(target), port, &cfg, tls) != 1) {
+        esp_tls_conn_destroy(tls);
+        if (conn->support == H2_UNKNOWN) {
+            // Never reached over h2: a server that aborts on ALPN, or just a
+            // network error, so only this request falls back. HTTP/1.1
+            // reports the real error if the origin is down altogether.
+            conn->retry_ms = conn->retry_ms ? conn->retry_ms * 2 : HTTP_TRANSPORT_H2_RETRY_MS;
+            if (conn->retry_ms > HTTP_TRANSPORT_H2_RETRY_MAX_MS) {
+                conn->retry_ms = HTTP_TRANSPORT_H2_RETRY_MAX_MS;
+            }
+            conn->retry_us = esp_timer_get_time() + conn->retry_ms * 1000LL;
+            ESP_LOGW(TAG, "TLS connection to %s failed, using HTTP/1.1 for %lu ms",
+                     conn->origin, (unsigned long)conn->retry_ms);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        ESP_LOGE(TAG, "TLS connection to %s failed", conn->origin);
+        return ESP_FAIL;
+    }
+    response->connect_us = (uint32_t)(esp_timer_get_time() - start);
+    response->conn = HTTP_TRANSPORT_CONN_TLS_FULL;
+
+    const char *proto = mbedtls_ssl_get_alpn_protocol((mbedtls_ssl_context *)esp_tls_get_ssl_context(tls));
+    if (!proto || strcmp(proto, "h2") != 0) {
+        ESP_LOGI(TAG, "%s does not offer HTTP/2, using HTTP/1.1", conn->origin);
+        conn->support = H2_NO;
+        esp_tls_conn_destroy(tls);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    tls_classify(conn, tls, response);
+#endif
+
+    nghttp2_session_callbacks *callbacks;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) {
+        esp_tls_conn_destroy(tls);
+        return ESP_ERR_NO_MEM;
+    }
+    nghttp2_session_callbacks_set_send_callback(callbacks, on_send);
+    nghttp2_session_callbacks_set_recv_callback(callbacks, on_recv);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, on_header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, on_data_chunk);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, on_stream_close);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, on_frame_recv);
+    nghttp2_session_callbacks_set_on_frame_send_callback(callbacks, on_frame_send);
+
+    int rv = nghttp2_session_client_new(&conn->session, callbacks, conn);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) {
+        esp_tls_conn_destroy(tls);
+        return ESP_ERR_NO_MEM;
+    }
+
+    nghttp2_settings_entry settings[] = {
+        { NGHTTP2_SETTINGS_ENABLE_PUSH, 0 },
+    };
+    nghttp2_submit_settings(conn->session, NGHTTP2_FLAG_NONE, settings, 1);
+
+    conn->tls = tls;
+    conn->support = H2_YES;
+    conn->retry_ms = 0;
+    conn->streams = 0;
+    conn->goaway = false;
+    ESP_LOGD(TAG, "HTTP/2 connection to %s in %lu us", conn->origin, (unsigned long)response->connect_us);
+    return ESP_OK;
+}
+
+/**
+ * @brief Flush pending frames and process whatever arrives within a poll period
+ */
+static esp_err_t conn_pump(h2_conn_t *conn) {
+    if (nghttp2_session_send(conn->session) != 0) {
+        return ESP_FAIL;
+    }
+    if (!tls_readable(conn->tls, HTTP_TRANSPORT_H2_POLL_MS)) {
+        return ESP_OK;
+    }
+    int rv = nghttp2_session_recv(conn->session);
+    if (rv != 0) {
+        ESP_LOGW(TAG, "Connection to %s lost: %s", conn->origin, nghttp2_strerror(rv));
+        return ESP_FAIL;
+    }
+    // WINDOW_UPDATE, SETTINGS ACK, PING replies
+    return nghttp2_session_send(conn->session) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static const char *method_name(esp_http_client_method_t method) {
+    switch (method) {
+        case HTTP_METHOD_GET: return "GET";
+        case HTTP_METHOD_POST: return "POST";
+        case HTTP_METHOD_PUT: return "PUT";
+        case HTTP_METHOD_PATCH: return "PATCH";
+        case HTTP_METHOD_DELETE: return "DELETE";
+        case HTTP_METHOD_HEAD: return "HEAD";
+        default: return NULL;
+    }
+}
+
+#define MAKE_NV(NAME, NAMELEN, VALUE, VALUELEN) \
+    { (uint8_t *)(NAME), (uint8_t *)(VALUE), (NAMELEN), (VALUELEN), NGHTTP2_NV_FLAG_NONE }
+
+/**
+ * @brief Build the header block; names are lowercased in headers_buf
+ *
+ * @return Number of entries, or -1 if there are too many headers
+ */
+static int build_nv(nghttp2_nv *nva, const char *method, const char *authority, const char *path,
+                    char *headers_buf, char *content_length, bool accept_encoding) {
+    int n = 0;
+    nva[n++] = (nghttp2_nv)MAKE_NV(":method", 7, method, strlen(method));
+    nva[n++] = (nghttp2_nv)MAKE_NV(":scheme", 7, "https", 5);
+    nva[n++] = (nghttp2_nv)MAKE_NV(":authority", 10, authority, strlen(authority));
+    nva[n++] = (nghttp2_nv)MAKE_NV(":path", 5, path, strlen(path));
+    if (content_length[0]) {
+        nva[n++] = (nghttp2_nv)MAKE_NV("content-length", 14, content_length, strlen(content_length));
+    }
+    if (accept_encoding) {
+        nva[n++] = (nghttp2_nv)MAKE_NV("accept-encoding", 15, HTTP_TRANSPORT_ACCEPT_ENCODING,
+                                       strlen(HTTP_TRANSPORT_ACCEPT_ENCODING));
+    }
+
+    char *save = NULL;
+    for (char *line = headers_buf ? strtok_r(headers_buf, "\r\n", &save) : NULL; line;
+         line = strtok_r(NULL, "\r\n", &save)) {
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            continue;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ') value++; // Skip spaces
+        for (char *p = line; *p; p++) {
+            *p = tolower((unsigned char)*p);
+        }
+        // Connection-specific headers are not allowed in HTTP/2
+        if (!strcmp(line, "host") || !strcmp(line, "connection") || !strcmp(line, "keep-alive") ||
+            !strcmp(line, "transfer-encoding") || !strcmp(line, "upgrade") ||
+            !strcmp(line, "content-length")) {
+            continue;
+        }
+        if (n >= HTTP_TRANSPORT_H2_MAX_HEADERS + 6) {
+            return -1;
+        }
+        nva[n++] = (nghttp2_nv)MAKE_NV(line, strlen(line), value, strlen(value));
+    }
+    return n;
+}
+
+esp_err_t http_transport_h2_perform(const http_transport_request_t *request, const char *origin,
+                                    http_transport_response_t *response) {
+    const char *method = method_name(request->method);
+    if (!method) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    sync_once(&s_init_once, h2_init, NULL);
+    h2_conn_t *conn = conn_acquire(origin);
+    if (!conn || conn->support == H2_NO) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    int timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : HTTP_TRANSPORT_TIMEOUT_MS;
+    const char *authority = strstr(origin, "://") + 3;
+    const char *path = request->url + strlen(origin);
+    char *path_buf = NULL;
+    if (path[0] != '/') {
+        // "https://host?q" and "https://host" both need a leading slash
+        if (asprintf(&path_buf, "/%s", path) < 0) {
+            return ESP_ERR_NO_MEM;
+        }
+        path = path_buf;
+    }
+    char *headers_buf = request->headers ? strdup(request->headers) : NULL;
+    char content_length[16] = "";
+    if (request->body) {
+        snprintf(content_length, sizeof(content_length), "%zu", request->body_len);
+    }
+    nghttp2_nv nva[HTTP_TRANSPORT_H2_MAX_HEADERS + 6];
+    int nvlen = build_nv(nva, method, authority, path, headers_buf, content_length,
+                         request->accept_encoding);
+
+    h2_stream_t st;
+    esp_err_t err = ESP_FAIL;
+
+    xSemaphoreTake(conn->lock, portMAX_DELAY);
+    if (strcmp(conn->origin, origin) != 0 || conn->support == H2_NO || nvlen < 0) {
+        // Slot taken over by another origin, or headers do not fit
+        err = ESP_ERR_NOT_SUPPORTED;
+        goto out;
+    }
+    if (conn->replaced) {
+        conn_teardown(conn);
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (conn->saved_session) {
+            esp_tls_free_client_session(conn->saved_session);
+            conn->saved_session = NULL;
+        }
+        memset(conn->master, 0, sizeof(conn->master));
+        conn->has_master = false;
+#endif
+        conn->retry_us = 0;
+        conn->retry_ms = 0;
+        conn->replaced = false;
+    }
+    if (!conn->session && conn->support == H2_UNKNOWN && esp_timer_get_time() < conn->retry_us) {
+        err = ESP_ERR_NOT_SUPPORTED;    // Handshake failed lately; HTTP/1.1 until the backoff ends
+        goto out;
+    }
+    if (conn->session && conn->goaway && conn->streams > 0) {
+        err = ESP_ERR_NOT_SUPPORTED;    // Draining; use HTTP/1.1 meanwhile
+        goto out;
+    }
+    if (conn->session && conn->streams == 0 &&
+        (conn->goaway || esp_timer_get_time() - conn->last_used_us > HTTP_TRANSPORT_IDLE_TIMEOUT_MS * 1000LL)) {
+        conn_teardown(conn);
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = conn->session != NULL;
+        memset(response, 0, sizeof(http_transport_response_t));
+        if (!reused) {
+            err = conn_open(conn, timeout_ms, response);
+            if (err != ESP_OK) {
+                goto out;
+            }
+        }
+
+        memset(&st, 0, sizeof(st));
+        st.request = request;
+        http_transport_body_init(&st.body, request->max_response, request->accept_encoding);
+        nghttp2_data_provider provider = {
+            .source.ptr = &st,
+            .read_callback = on_body_read,
+        };
+        int32_t stream_id = nghttp2_submit_request(conn->session, NULL, nva, nvlen,
+                                                   request->body ? &provider : NULL, &st);
+        if (stream_id < 0) {
+            ESP_LOGE(TAG, "Failed to submit request: %s", nghttp2_strerror(stream_id));
+            err = ESP_FAIL;
+            goto out;
+        }
+        conn->streams++;
+        uint32_t generation = conn->generation;
+        int64_t deadline = esp_timer_get_time() + timeout_ms * 1000LL;
+        bool lost = false;
+        err = ESP_OK;
+
+        while (!st.done) {
+            if (conn_pump(conn) != ESP_OK) {
+                conn_teardown(conn);
+                lost = true;
+                break;
+            }
+            if (st.done) {
+                break;
+            }
+            if (esp_timer_get_time() > deadline) {
+                ESP_LOGE(TAG, "Stream %d to %s timed out", (int)stream_id, origin);
+                nghttp2_session_set_stream_user_data(conn->session, stream_id, NULL);
+                nghttp2_submit_rst_stream(conn->session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+                if (nghttp2_session_send(conn->session) != 0) {
+                    conn_teardown(conn);
+                }
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            // Let other streams of this connection submit and pump
+            xSemaphoreGive(conn->lock);
+            taskYIELD();
+            xSemaphoreTake(conn->lock, portMAX_DELAY);
+            if (conn->generation != generation) {
+                lost = true;
+                break;
+            }
+        }
+        if (conn->generation == generation) {
+            conn->streams--;
+        }
+
+        if (lost && !st.done) {
+            http_transport_body_free(&st.body);
+            free(st.headers);
+            st.headers = NULL;
+            if (reused && !st.status_code && attempt == 0 &&
+                (!st.sent || http_transport_method_idempotent(request->method))) {
+                // Stale connection: nothing came back, and the server either
+                // never saw the request or may see it twice. Retry once fresh
+                ESP_LOGD(TAG, "Reused connection to %s failed, reconnecting", origin);
+                if (conn->session) {
+                    conn_teardown(conn);
+                }
+                continue;
+            }
+            err = ESP_FAIL;
+        }
+        if (reused) {
+            response->conn = HTTP_TRANSPORT_CONN_REUSED;
+        }
+        break;
+    }
+
+    if (err == ESP_OK && (!st.done || st.error_code != NGHTTP2_NO_ERROR || !st.status_code)) {
+        err = st.body_err != ESP_OK ? st.body_err : ESP_FAIL;
+    }
+    if (err == ESP_OK) {
+        err = st.body_err != ESP_OK ? st.body_err : http_transport_body_finish(&st.body);
+    }
+    response->http2 = true;
+    response->sent = st.sent;
+    if (err == ESP_OK || err == ESP_ERR_INVALID_SIZE) {
+        response->status_code = st.status_code;
+    }
+    if (err == ESP_OK) {
+        response->headers = st.headers;
+        response->body = st.body.data;
+        response->body_len = st.body.len;
+        response->wire_len = st.body.wire_len;
+        st.body.data = NULL;
+    } else {
+        free(st.headers);
+    }
+    http_transport_body_free(&st.body);
+    if (conn->goaway && conn->streams == 0) {
+        conn_teardown(conn);
+    }
+    conn->last_used_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_h2_lock);
+    http_transport_stats_add(&conn->stats, response, err);
+    portEXIT_CRITICAL(&s_h2_lock);
+
+    ESP_LOGD(TAG, "%s -> %d (%zu bytes, h2, conn %d)", request->url, response->status_code,
+             response->body_len, response->conn);
+
+out:
+    xSemaphoreGive(conn->lock);
+    free(headers_buf);
+    free(path_buf);
+    return err;
+}
+
+esp_err_t http_transport_h2_get_stats(const char *origin, http_transport_stats_t *stats_out) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_h2_lock);
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        if (s_conns[i].support == H2_YES && strcmp(s_conns[i].origin, origin) == 0) {
+            *stats_out = s_conns[i].stats;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_h2_lock);
+    return err;
+}
+
+void http_transport_h2_suspend(void) {
+    if (!sync_once_done(&s_init_once)) {
+        return;
+    }
+    for (int i = 0; i < HTTP_TRANSPORT_MAX_ORIGINS; i++) {
+        h2_conn_t *conn = &s_conns[i];
+        if (xSemaphoreTake(conn->lock, 0) != pdTRUE) {
+            continue;   // In use
+        }
+        if (conn->session && conn->streams == 0) {
+            conn_teardown(conn);
+        }
+        xSemaphoreGive(conn->lock);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HTTP_TRANSPORT_H2_H
+#define HTTP_TRANSPORT_H2_H
+
+#include "http_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Internal interface between http_transport.c and the optional HTTP/2
+// backend (built with -DHTTP_TRANSPORT_HTTP2=ON)
+
+#define HTTP_TRANSPORT_H2_MAX_HEADERS 16    // Request headers per stream
+#define HTTP_TRANSPORT_H2_POLL_MS 20        // Socket wait per pump before yielding
+#ifndef HTTP_TRANSPORT_H2_RETRY_MS
+#define HTTP_TRANSPORT_H2_RETRY_MS 30000    // HTTP/1.1 only this long after a failed handshake (doubles)
+#endif
+#define HTTP_TRANSPORT_H2_RETRY_MAX_MS 600000
+
+/**
+ * @brief Perform a request as a stream on the origin's HTTP/2 connection
+ *
+ * Callers for the same origin share one connection: each submits its stream
+ * and takes turns driving the session, so concurrent requests overlap.
+ *
+ * @param request Request description
+ * @param origin "https://host[:port]" of request->url
+ * @param response Output: response (response->http2 is set)
+ * @return Same as http_transport_perform, or ESP_ERR_NOT_SUPPORTED if the
+ *         origin does not negotiate h2 and the caller should use HTTP/1.1
+ */
+esp_err_t http_transport_h2_perform(const http_transport_request_t *request, const char *origin,
+                                    http_transport_response_t *response);
+
+/**
+ * @brief Get counters of an HTTP/2 origin
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the origin has no HTTP/2 connection
+ */
+esp_err_t http_transport_h2_get_stats(const char *origin, http_transport_stats_t *stats_out);
+
+/**
+ * @brief Close idle HTTP/2 connections, keeping their TLS sessions
+ */
+void http_transport_h2_suspend(void);
+
+/**
+ * @brief Account one request in a counter set (caller holds the owning lock)
+ */
+void http_transport_stats_add(http_transport_stats_t *stats, const http_transport_response_t *response,
+                              esp_err_t err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_TRANSPORT_H2_H
@@ -0,0 +1,268 @@
+#include "solana_pda.h"
+#include "tweetnacl.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mbedtls/sha256.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "solana_pda";
+
+static const char PDA_MARKER[] = "ProgramDerivedAddress";
+
+// Requests whose search state fits on the caller's stack
+#define PDA_LOCAL_STATES 4
+
+/**
+ * @brief Per-request search state, guarded by pda_batch_t.lock
+ */
+typedef struct {
+    int16_t next;       // Next bump to hand out (-1 when exhausted)
+    int16_t found;      // Highest off-curve bump seen so far (-1 if none)
+    uint8_t inflight;   // Bumps currently being evaluated
+} pda_state_t;
+
+typedef struct {
+    solana_pda_request_t *requests;
+    pda_state_t *state;
+    size_t count;
+    portMUX_TYPE lock;
+    SemaphoreHandle_t done;
+} pda_batch_t;
+
+/**
+ * @brief sha256(seeds || [bump] || program_id || "ProgramDerivedAddress")
+ *
+ * @param bump Bump seed to append, or -1 for none
+ */
+static void pda_hash(const uint8_t **seeds, const size_t *seed_lens, size_t num_seeds,
+                     int bump, const uint8_t *program_id, uint8_t *hash_out) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);  // 0 = SHA-256 (not SHA-224)
+    for (size_t i = 0; i < num_seeds; i++) {
+        mbedtls_sha256_update(&ctx, seeds[i], seed_lens[i]);
+    }
+    if (bump >= 0) {
+        uint8_t b = (uint8_t)bump;
+        mbedtls_sha256_update(&ctx, &b, 1);
+    }
+    mbedtls_sha256_update(&ctx, program_id, 32);
+    mbedtls_sha256_update(&ctx, (const uint8_t *)PDA_MARKER, sizeof(PDA_MARKER) - 1);
+    mbedtls_sha256_finish(&ctx, hash_out);
+    mbedtls_sha256_free(&ctx);
+}
+
+/**
+ * @brief Check if a 32-byte value decodes to an Ed25519 curve point
+ *
+ * A valid PDA must NOT be on the curve. unpackneg returns 0 for points on
+ * the curve and -1 otherwise.
+ */
+static bool is_on_curve(const uint8_t *bytes) {
+    gf r[4];
+    return unpackneg(r, bytes) == 0;
+}
+
+static bool seeds_valid(const uint8_t **seeds, const size_t *seed_lens,
+                        size_t num_seeds, size_t max_seeds) {
+    if (num_seeds > max_seeds || (num_seeds && (!seeds || !seed_lens))) {
+        return false;
+    }
+    for (size_t i = 0; i < num_seeds; i++) {
+        if (seed_lens[i] > SOLANA_PDA_MAX_SEED_LEN || (seed_lens[i] && !seeds[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t solana_pda_create(
+    const uint8_t **seeds,
+    const size_t *seed_lens,
+    size_t num_seeds,
+    const uint8_t *program_id,
+    uint8_t *address_out
+) {
+    if (!program_id || !address_out ||
+        !seeds_valid(seeds, seed_lens, num_seeds, SOLANA_PDA_MAX_SEEDS)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t hash[32];
+    pda_hash(seeds, seed_lens, num_seeds, -1, program_id, hash);
+    if (is_on_curve(hash)) {
+        ESP_LOGD(TAG, "Seeds produce an on-curve address");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(address_out, hash, 32);
+    return ESP_OK;
+}
+
+/**
+ * @brief Claim and evaluate (request, bump) units until none are useful
+ *
+ * Bumps are handed out in descending order, so once a request has an
+ * off-curve result no further bumps are needed. The highest off-curve bump
+ * among those in flight wins, which keeps the result canonical.
+ */
+static void pda_work(pda_batch_t *b) {
+    for (;;) {
+        size_t idx = b->count;
+        int bump;
+
+        portENTER_CRITICAL(&b->lock);
+        for (size_t i = 0; i < b->count; i++) {
+            pda_state_t *s = &b->state[i];
+            if (s->found >= 0 || s->next < 0) {
+                continue;
+            }
+            if (idx == b->count || s->inflight < b->state[idx].inflight) {
+                idx = i;
+            }
+        }
+        if (idx == b->count) {
+            portEXIT_CRITICAL(&b->lock);
+            return;
+        }
+        bump = b->state[idx].next--;
+        b->state[idx].inflight++;
+        portEXIT_CRITICAL(&b->lock);
+
+        solana_pda_request_t *req = &b->requests[idx];
+        uint8_t hash[32];
+        pda_hash(req->seeds, req->seed_lens, req->num_seeds, bump, req->program_id, hash);
+        bool off_curve = !is_on_curve(hash);
+
+        portENTER_CRITICAL(&b->lock);
+        b->state[idx].inflight--;
+        if (off_curve && bump > b->state[idx].found) {
+            b->state[idx].found = bump;
+            memcpy(req->address, hash, 32);
+        }
+        portEXIT_CRITICAL(&b->lock);
+    }
+}
+
+static void pda_worker_task(void *arg) {
+    pda_batch_t *b = (pda_batch_t *)arg;
+    pda_work(b);
+    xSemaphoreGive(b->done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t solana_pda_find_batch(solana_pda_request_t *requests, size_t count) {
+    if (!requests && count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!count) {
+        return ESP_OK;
+    }
+
+    pda_state_t local[PDA_LOCAL_STATES];
+    pda_batch_t b = {
+        .requests = requests,
+        .state = local,
+        .count = count,
+        .lock = portMUX_INITIALIZER_UNLOCKED,
+        .done = NULL,
+    };
+    if (count > PDA_LOCAL_STATES) {
+        b.state = (pda_state_t *)malloc(count * sizeof(pda_state_t));
+        if (!b.state) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        solana_pda_request_t *req = &requests[i];
+        bool valid = req->program_id &&
+                     seeds_valid(req->seeds, req->seed_lens, req->num_seeds, SOLANA_PDA_MAX_SEEDS - 1);
+        b.state[i].next = valid ? 255 : -1;
+        b.state[i].found = -1;
+        b.state[i].inflight = 0;
+        req->err = valid ? ESP_OK : ESP_ERR_INVALID_ARG;
+    }
+
+    // Second worker on the other core; fall back to the caller alone if the
+    // helper cannot be started. A single request stays in the caller: half
+    // of them stop at bump 255 and nearly all within a few, well under the
+    // cost of creating and deleting the task.
+    bool helper = false;
+#if portNUM_PROCESSORS > 1
+    b.done = count > 1 ? xSemaphoreCreateBinary() : NULL;
+    if (b.done) {
+        BaseType_t core = xPortGetCoreID() ? 0 : 1;
+        helper = xTaskCreatePinnedToCore(pda_worker_task, "pda_worker",
+                                         SOLANA_PDA_WORKER_STACK_SIZE, &b,
+                                         uxTaskPriorityGet(NULL), NULL, core) == pdPASS;
+        if (!helper) {
+            ESP_LOGD(TAG, "Helper task unavailable, searching on one core");
+        }
+    }
+#endif
+
+    pda_work(&b);
+
+    if (helper) {
+        xSemaphoreTake(b.done, portMAX_DELAY);
+    }
+    if (b.done) {
+        vSemaphoreDelete(b.done);
+    }
+
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+        solana_pda_request_t *req = &requests[i];
+        if (req->err == ESP_OK) {
+            if (b.state[i].found >= 0) {
+                req->bump = (uint8_t)b.state[i].found;
+                ESP_LOGD(TAG, "Found PDA at bump %d", req->bump);
+            } else {
+                // Exhausted all bumps without finding valid PDA (extremely unlikely)
+                ESP_LOGE(TAG, "Failed to find valid PDA after trying all bumps");
+                req->err = ESP_ERR_NOT_FOUND;
+            }
+        }
+        if (result == ESP_OK) {
+            result = req->err;
+        }
+    }
+
+    if (b.state != local) {
+        free(b.state);
+    }
+    return result;
+}
+
+esp_err_t solana_pda_find(
+    const uint8_t **seeds,
+    const size_t *seed_lens,
+    size_t num_seeds,
+    const uint8_t *program_id,
+    uint8_t *address_out,
+    uint8_t *bump_out
+) {
+    if (!address_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    solana_pda_request_t req = {
+        .seeds = seeds,
+        .seed_lens = seed_lens,
+        .num_seeds = num_seeds,
+        .program_id = program_id,
+    };
+    esp_err_t err = solana_pda_find_batch(&req, 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    memcpy(address_out, req.address, 32);
+    if (bump_out) *bump_out = req.bump;
+    return ESP_OK;
+}
@@ -0,0 +1,102 @@
+#ifndef SOLANA_PDA_H
+#define SOLANA_PDA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Solana runtime limits for create_program_address
+#define SOLANA_PDA_MAX_SEEDS 16
+#define SOLANA_PDA_MAX_SEED_LEN 32
+
+// Stack for the helper task that runs on the other core during batch search
+#ifndef SOLANA_PDA_WORKER_STACK_SIZE
+#define SOLANA_PDA_WORKER_STACK_SIZE 4096
+#endif
+
+/**
+ * @brief One derivation in a batch
+ *
+ * Inputs are read-only and must stay valid until solana_pda_find_batch returns.
+ */
+typedef struct {
+    const uint8_t **seeds;      // Seed byte strings (without the bump)
+    const size_t *seed_lens;    // Length of each seed
+    size_t num_seeds;           // Number of seeds
+    const uint8_t *program_id;  // Owning program (32 bytes)
+    uint8_t address[32];        // Output: derived address
+    uint8_t bump;               // Output: bump seed used
+    esp_err_t err;              // Output: ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NOT_FOUND
+} solana_pda_request_t;
+
+/**
+ * @brief Create a program address from a complete seed list
+ *
+ * Equivalent of Pubkey::create_program_address: sha256(seeds || program_id ||
+ * "ProgramDerivedAddress"). The caller supplies the bump as the last seed.
+ *
+ * @param seeds Seed byte strings
+ * @param seed_lens Length of each seed
+ * @param num_seeds Number of seeds (max SOLANA_PDA_MAX_SEEDS)
+ * @param program_id Program ID (32 bytes)
+ * @param address_out Output: program address (32 bytes)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the seeds exceed the
+ *         runtime limits or the result lies on the Ed25519 curve
+ */
+esp_err_t solana_pda_create(
+    const uint8_t **seeds,
+    const size_t *seed_lens,
+    size_t num_seeds,
+    const uint8_t *program_id,
+    uint8_t *address_out
+);
+
+/**
+ * @brief Find a program derived address and its canonical bump
+ *
+ * Equivalent of Pubkey::find_program_address: tries bumps from 255 down and
+ * returns the first address that is off the Ed25519 curve. Runs in the
+ * calling task.
+ *
+ * @param seeds Seed byte strings (without the bump)
+ * @param seed_lens Length of each seed
+ * @param num_seeds Number of seeds (max SOLANA_PDA_MAX_SEEDS - 1)
+ * @param program_id Program ID (32 bytes)
+ * @param address_out Output: program derived address (32 bytes)
+ * @param bump_out Output: canonical bump (may be NULL)
+ * @return ESP_OK on success
+ */
+esp_err_t solana_pda_find(
+    const uint8_t **seeds,
+    const size_t *seed_lens,
+    size_t num_seeds,
+    const uint8_t *program_id,
+    uint8_t *address_out,
+    uint8_t *bump_out
+);
+
+/**
+ * @brief Find several independent program derived addresses
+ *
+ * The calling task and a helper task pinned to the other core claim work
+ * from a shared queue. Each unit is one (request, bump) pair, and the least
+ * busy unfinished request is served first. Two requests therefore run side by
+ * side, and the last one left has its next bump evaluated speculatively. A
+ * batch of one is searched in the calling task alone. Results are identical
+ * to calling solana_pda_find on each request.
+ *
+ * @param requests Array of requests; outputs are filled in per entry
+ * @param count Number of requests
+ * @return ESP_OK if every request succeeded, otherwise the first failing err
+ */
+esp_err_t solana_pda_find_batch(solana_pda_request_t *requests, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOLANA_PDA_H
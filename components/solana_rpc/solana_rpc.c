@@ -1,63 +1,368 @@
 #include "solana_rpc.h"
-#include "esp_http_client.h"
+#include "http_transport.h"
+#include "bulk_mem.h"
+#include "sync_util.h"
+#include "base58.h"
+#include "cJSON.h"
+#include "mbedtls/base64.h"
 #include "esp_log.h"
-#include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
 static const char *TAG = "SolanaRPC";
 
+/**
+ * @brief Token bucket for one RPC endpoint, shared by all its clients
+ *
+ * The rate adapts to the node: a 429 halves it and pauses the endpoint for
+ * Retry-After, and each rate's worth of answered calls without one raises it
+ * by a tenth of the configured maximum again.
+ */
+typedef struct {
+    uint64_t url_hash;              // 0 = unused
+    int clients;
+    int64_t max_rate_milli;         // Configured requests/s x1000 (0 = unlimited)
+    int64_t rate_milli;             // Current requests/s x1000
+    int64_t burst_milli;
+    int64_t tokens_milli;
+    int64_t refill_us;
+    int64_t blocked_until_us;       // End of the Retry-After pause
+    uint32_t answered;              // Since the last rate change
+    solana_rpc_limiter_stats_t stats;
+} rpc_endpoint_t;
+
 typedef struct solana_rpc_client_t {
     char *rpc_url;
     int timeout_ms;
     int request_id;
+    bool compression;
+    rpc_endpoint_t *endpoint;       // NULL if the endpoint table was full
 } solana_rpc_client_t;
 
+static rpc_endpoint_t s_endpoints[SOLANA_RPC_MAX_ENDPOINTS];
+static portMUX_TYPE s_limiter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Result of an in-flight call, kept next to its single-flight slot
+ *
+ * The leader performs the request; followers wait for it and then share
+ * its response buffer. The slot's refs count the callers still holding it
+ * (leader + followers); solana_rpc_free_response drops one reference and
+ * the slot is reused once the last one is gone.
+ */
 typedef struct {
-    char *buffer;
-    size_t size;
-    size_t capacity;
-} http_response_buffer_t;
+    solana_rpc_priority_t priority; // Raised to critical when a critical call joins
+    esp_err_t err;
+    int status_code;
+    bool success;
+    char *data;
+    size_t length;
+} rpc_flight_t;
+
+// Slots keyed by a hash of URL, method and params
+static sync_flight_t s_flight_slots[SOLANA_RPC_MAX_INFLIGHT];
+static rpc_flight_t s_flights[SOLANA_RPC_MAX_INFLIGHT];
+static solana_rpc_stats_t s_stats;
+static portMUX_TYPE s_flight_lock = portMUX_INITIALIZER_UNLOCKED;
+static sync_once_t s_flight_once = SYNC_ONCE_INIT;
+
+// Calls with side effects that must reach the node once per caller: never
+// coalesced or retried (sendTransaction is safe to repeat: same signature)
+static const char *const s_not_idempotent[] = { "requestAirdrop" };
+
+// Error text (JSON-RPC error message/data, facilitator reasons) by class
+static const struct {
+    const char *text;
+    solana_rpc_error_class_t error_class;
+} s_error_text[] = {
+    { "blockhash not found", SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED },
+    { "BlockhashNotFound", SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED },
+    { "block height exceeded", SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED },
+    { "insufficient funds", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },
+    { "insufficient lamports", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },
+    { "insufficient_funds", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },         // x402 error code
+    { "InsufficientFunds", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },
+    { "no record of a prior credit", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },
+    { "custom program error: 0x1\"", SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS },   // SPL Token
+    { "node is behind", SOLANA_RPC_ERROR_TRANSPORT },
+    { "node is unhealthy", SOLANA_RPC_ERROR_TRANSPORT },
+};
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+_Static_assert(SOLANA_RPC_MAX_FOLLOWERS <= SYNC_FLIGHT_MAX_FOLLOWERS, "too many followers per flight");
+
+static void flight_init(void *arg)
 {
-    http_response_buffer_t *response = (http_response_buffer_t *)evt->user_data;
-    
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // Expand buffer if needed
-                if (response->size + evt->data_len >= response->capacity) {
-                    size_t new_capacity = response->capacity * 2;
-                    if (new_capacity < response->size + evt->data_len + 1) {
-                        new_capacity = response->size + evt->data_len + 1;
-                    }
-                    if (new_capacity > SOLANA_RPC_MAX_RESPONSE_SIZE) {
-                        ESP_LOGE(TAG, "Response too large: %zu bytes", new_capacity);
-                        return ESP_FAIL;
-                    }
-                    
-                    char *new_buffer = realloc(response->buffer, new_capacity);
-                    if (!new_buffer) {
-                        ESP_LOGE(TAG, "Failed to expand response buffer");
-                        return ESP_ERR_NO_MEM;
-                    }
-                    response->buffer = new_buffer;
-                    response->capacity = new_capacity;
-                }
-                
-                // Append data
-                memcpy(response->buffer + response->size, evt->data, evt->data_len);
-                response->size += evt->data_len;
-                response->buffer[response->size] = '\0';
+    sync_flight_init(s_flight_slots, SOLANA_RPC_MAX_INFLIGHT, SOLANA_RPC_MAX_FOLLOWERS);
+}
+
+/**
+ * @brief FNV-1a of s and its terminator, so "ab"+"c" and "a"+"bc" differ
+ */
+static uint64_t fnv1a(uint64_t hash, const char *s)
+{
+    for (const char *p = s; ; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 0x100000001b3ULL;
+        if (!*p) {
+            return hash;
+        }
+    }
+}
+
+static uint64_t url_hash(const char *url)
+{
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, url);
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Key of a call: URL, method and params (the JSON-RPC id is not part of it)
+ */
+static uint64_t flight_key(const char *url, const char *method, const char *params)
+{
+    uint64_t hash = fnv1a(fnv1a(url_hash(url), method), params ? params : "");
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Drop one reference; the caller frees data if this returns true
+ *
+ * @return true if data is not shared (anymore)
+ */
+static bool flight_release(const char *data)
+{
+    bool last = true;
+    portENTER_CRITICAL(&s_flight_lock);
+    for (int i = 0; i < SOLANA_RPC_MAX_INFLIGHT; i++) {
+        if (s_flight_slots[i].refs > 0 && s_flights[i].data == data) {
+            last = sync_flight_release(&s_flight_slots[i]);
+            if (last) {
+                s_flights[i].data = NULL;
             }
             break;
-            
-        default:
+        }
+    }
+    portEXIT_CRITICAL(&s_flight_lock);
+    return last;
+}
+
+/**
+ * @brief Release a slot whose call produced no data
+ */
+static void flight_release_empty(int slot)
+{
+    portENTER_CRITICAL(&s_flight_lock);
+    sync_flight_release(&s_flight_slots[slot]);
+    portEXIT_CRITICAL(&s_flight_lock);
+}
+
+static void endpoint_attach(solana_rpc_client_t *client)
+{
+    uint64_t hash = url_hash(client->rpc_url);
+    rpc_endpoint_t *free_ep = NULL;
+
+    portENTER_CRITICAL(&s_limiter_lock);
+    for (int i = 0; i < SOLANA_RPC_MAX_ENDPOINTS; i++) {
+        rpc_endpoint_t *ep = &s_endpoints[i];
+        if (ep->url_hash == hash) {
+            client->endpoint = ep;
             break;
+        }
+        if (!ep->url_hash && !free_ep) {
+            free_ep = ep;
+        }
+    }
+    if (!client->endpoint && free_ep) {
+        memset(free_ep, 0, sizeof(*free_ep));
+        free_ep->url_hash = hash;
+        free_ep->max_rate_milli = SOLANA_RPC_RATE_LIMIT_RPS * 1000LL;
+        free_ep->rate_milli = free_ep->max_rate_milli;
+        free_ep->burst_milli = SOLANA_RPC_RATE_LIMIT_BURST * 1000LL;
+        free_ep->tokens_milli = free_ep->burst_milli;
+        free_ep->refill_us = esp_timer_get_time();
+        client->endpoint = free_ep;
+    }
+    if (client->endpoint) {
+        client->endpoint->clients++;
+    }
+    portEXIT_CRITICAL(&s_limiter_lock);
+
+    if (!client->endpoint) {
+        ESP_LOGW(TAG, "No rate limiter slot for %s, calls are not throttled", client->rpc_url);
+    }
+}
+
+static void endpoint_detach(solana_rpc_client_t *client)
+{
+    if (!client->endpoint) {
+        return;
+    }
+    portENTER_CRITICAL(&s_limiter_lock);
+    if (--client->endpoint->clients == 0) {
+        client->endpoint->url_hash = 0;
+    }
+    portEXIT_CRITICAL(&s_limiter_lock);
+    client->endpoint = NULL;
+}
+
+static void limiter_refill(rpc_endpoint_t *ep, int64_t now)
+{
+    ep->tokens_milli += (now - ep->refill_us) * ep->rate_milli / 1000000;
+    if (ep->tokens_milli > ep->burst_milli) {
+        ep->tokens_milli = ep->burst_milli;
+    }
+    ep->refill_us = now;
+}
+
+/**
+ * @brief Wait for a token of the client's endpoint
+ *
+ * Background calls leave SOLANA_RPC_BACKGROUND_RESERVE tokens in the bucket
+ * for critical ones. Nobody sends during a Retry-After pause. A call that
+ * could not start within the client timeout fails locally instead of adding
+ * load to a node that is already throttling.
+ *
+ * A background call that leads a flight rechecks the flight's priority each
+ * time a token comes in, so a critical call joining it is not held back by
+ * the reserve.
+ *
+ * @param flight Flight the call leads, or NULL
+ * @return ESP_OK, or ESP_ERR_TIMEOUT if the call was shed
+ */
+static esp_err_t limiter_acquire(solana_rpc_client_t *client, solana_rpc_priority_t priority,
+                                 rpc_flight_t *flight)
+{
+    rpc_endpoint_t *ep = client->endpoint;
+    int64_t start = esp_timer_get_time();
+    int64_t deadline = start + client->timeout_ms * 1000LL;
+
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        int64_t wait_us = 0;
+        int64_t sleep_us = 0;
+
+        if (flight) {
+            portENTER_CRITICAL(&s_flight_lock);
+            priority = flight->priority;
+            portEXIT_CRITICAL(&s_flight_lock);
+        }
+
+        portENTER_CRITICAL(&s_limiter_lock);
+        if (ep && ep->max_rate_milli > 0) {
+            limiter_refill(ep, now);
+            int64_t reserve = 0;
+            if (priority == SOLANA_RPC_PRIORITY_BACKGROUND) {
+                reserve = SOLANA_RPC_BACKGROUND_RESERVE * 1000LL;
+                if (reserve > ep->burst_milli - 1000) {
+                    reserve = ep->burst_milli - 1000;
+                }
+            }
+            if (now < ep->blocked_until_us) {
+                wait_us = ep->blocked_until_us - now;
+            } else if (ep->tokens_milli >= 1000 + reserve) {
+                ep->tokens_milli -= 1000;
+            } else {
+                wait_us = (1000 + reserve - ep->tokens_milli) * 1000000 / ep->rate_milli + 1;
+                if (flight && reserve > 0 && wait_us > 1000000000LL / ep->rate_milli) {
+                    sleep_us = 1000000000LL / ep->rate_milli;   // One token: a critical call may join
+                }
+            }
+
+            if (wait_us == 0 && now > start) {
+                ep->stats.delayed++;
+                ep->stats.delay_ms += (uint32_t)((now - start) / 1000);
+            } else if (wait_us > 0 && now + wait_us > deadline) {
+                ep->stats.shed++;
+            }
+        }
+        portEXIT_CRITICAL(&s_limiter_lock);
+
+        if (wait_us == 0) {
+            return ESP_OK;
+        }
+        if (now + wait_us > deadline) {
+            ESP_LOGW(TAG, "Rate limited: not sending (next slot in %lld ms)", wait_us / 1000);
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS((sleep_us ? sleep_us : wait_us) / 1000) + 1);
+    }
+}
+
+/**
+ * @brief Retry-After in ms (delta-seconds form), 0 if absent or an HTTP date
+ */
+static uint32_t retry_after_ms(const char *headers)
+{
+    static const char name[] = "Retry-After:";
+    for (const char *line = headers; line && *line; ) {
+        if (strncasecmp(line, name, sizeof(name) - 1) == 0) {
+            const char *value = line + sizeof(name) - 1;
+            while (*value == ' ' || *value == '\t') value++;
+            char *end;
+            unsigned long seconds = strtoul(value, &end, 10);
+            if (end == value || (*end && *end != '\r' && *end != '\n')) {
+                return 0;
+            }
+            return seconds > SOLANA_RPC_RETRY_AFTER_MAX_MS / 1000
+                   ? SOLANA_RPC_RETRY_AFTER_MAX_MS : (uint32_t)seconds * 1000;
+        }
+        line += strcspn(line, "\r\n");
+        line += strspn(line, "\r\n");
+    }
+    return 0;
+}
+
+/**
+ * @brief Learn from the node's answer (status 0 = no answer)
+ */
+static void limiter_record(solana_rpc_client_t *client, int status_code, const char *headers)
+{
+    rpc_endpoint_t *ep = client->endpoint;
+    if (!ep || status_code == 0) {
+        return;
+    }
+    uint32_t pause_ms = 0;
+    if (status_code == 429) {
+        pause_ms = retry_after_ms(headers);
+        if (!pause_ms) {
+            pause_ms = SOLANA_RPC_RETRY_AFTER_DEFAULT_MS;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_limiter_lock);
+    if (ep->max_rate_milli > 0) {
+        limiter_refill(ep, now);
+        if (status_code == 429) {
+            ep->stats.throttled++;
+            ep->rate_milli /= 2;
+            if (ep->rate_milli < SOLANA_RPC_RATE_LIMIT_MIN_RPS * 1000LL) {
+                ep->rate_milli = SOLANA_RPC_RATE_LIMIT_MIN_RPS * 1000LL;
+            }
+            ep->tokens_milli = 0;
+            if (now + pause_ms * 1000LL > ep->blocked_until_us) {
+                ep->blocked_until_us = now + pause_ms * 1000LL;
+            }
+            ep->answered = 0;
+        } else if (ep->rate_milli < ep->max_rate_milli &&
+                   ++ep->answered >= ep->rate_milli / 1000) {
+            ep->rate_milli += ep->max_rate_milli / 10;
+            if (ep->rate_milli > ep->max_rate_milli) {
+                ep->rate_milli = ep->max_rate_milli;
+            }
+            ep->answered = 0;
+        }
+    }
+    portEXIT_CRITICAL(&s_limiter_lock);
+
+    if (status_code == 429) {
+        ESP_LOGW(TAG, "Throttled by %s: pausing %lu ms", client->rpc_url, (unsigned long)pause_ms);
     }
-    
-    return ESP_OK;
 }
 
 solana_rpc_handle_t solana_rpc_init(const char *rpc_url)
@@ -82,6 +387,9 @@ solana_rpc_handle_t solana_rpc_init(const char *rpc_url)
 
     client->timeout_ms = SOLANA_RPC_TIMEOUT_MS;
     client->request_id = 1;
+    client->compression = SOLANA_RPC_COMPRESSION;
+    client->endpoint = NULL;
+    endpoint_attach(client);
 
     ESP_LOGI(TAG, "Initialized Solana RPC client with URL: %s", rpc_url);
     return client;
@@ -90,22 +398,17 @@ solana_rpc_handle_t solana_rpc_init(const char *rpc_url)
 void solana_rpc_free_response(solana_rpc_response_t *response)
 {
     if (response && response->data) {
-        free(response->data);
+        if (flight_release(response->data)) {
+            free(response->data);
+        }
         response->data = NULL;
         response->length = 0;
     }
 }
 
-esp_err_t solana_rpc_call(solana_rpc_handle_t client, const char *method, const char *params,
-                           solana_rpc_response_t *response)
+static esp_err_t rpc_perform(solana_rpc_handle_t client, const char *method, const char *params,
+                             solana_rpc_response_t *response)
 {
-    if (!client || !method || !response) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    // Initialize response
-    memset(response, 0, sizeof(solana_rpc_response_t));
-
     // Build JSON-RPC request
     char *request_body = NULL;
     if (params) {
@@ -125,78 +428,287 @@ esp_err_t solana_rpc_call(solana_rpc_handle_t client, const char *method, const
 
     ESP_LOGD(TAG, "Request: %s", request_body);
 
-    // Prepare response buffer
-    http_response_buffer_t http_response = {
-        .buffer = malloc(4096),
-        .size = 0,
-        .capacity = 4096
-    };
-
-    if (!http_response.buffer) {
-        ESP_LOGE(TAG, "Failed to allocate response buffer");
-        free(request_body);
-        return ESP_ERR_NO_MEM;
-    }
-
-    // Configure HTTP client
-    esp_http_client_config_t config = {
+    // Pooled connection: keep-alive and TLS session reuse across calls
+    http_transport_request_t http_request = {
         .url = client->rpc_url,
         .method = HTTP_METHOD_POST,
+        .headers = "Content-Type: application/json",
+        .body = request_body,
+        .body_len = strlen(request_body),
         .timeout_ms = client->timeout_ms,
-        .event_handler = http_event_handler,
-        .user_data = &http_response,
-        .buffer_size = 2048,
-        .buffer_size_tx = 2048,
-#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-        .crt_bundle_attach = esp_crt_bundle_attach,
-#endif
+        .max_response = SOLANA_RPC_MAX_RESPONSE_SIZE,
+        .accept_encoding = client->compression,
     };
-
-    esp_http_client_handle_t http_client = esp_http_client_init(&config);
-    if (!http_client) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        free(request_body);
-        free(http_response.buffer);
-        return ESP_FAIL;
-    }
-
-    // Set headers
-    esp_http_client_set_header(http_client, "Content-Type", "application/json");
-
-    // Set POST data
-    esp_http_client_set_post_field(http_client, request_body, strlen(request_body));
-
-    // Perform request
-    esp_err_t err = esp_http_client_perform(http_client);
-    response->status_code = esp_http_client_get_status_code(http_client);
+    http_transport_response_t http_response;
+    esp_err_t err = http_transport_perform(&http_request, &http_response);
+    response->status_code = http_response.status_code;
+    limiter_record(client, http_response.status_code, http_response.headers);
 
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP Status: %d, Response length: %zu", 
-                 response->status_code, http_response.size);
+        ESP_LOGI(TAG, "HTTP Status: %d, Response length: %zu (%zu on the wire)",
+                 response->status_code, http_response.body_len, http_response.wire_len);
         
-        if (response->status_code == 200 && http_response.size > 0) {
-            response->data = http_response.buffer;
-            response->length = http_response.size;
+        if (response->status_code == 200 && http_response.body_len > 0) {
+            response->data = http_response.body;
+            response->length = http_response.body_len;
             response->success = true;
+            http_response.body = NULL;
             ESP_LOGD(TAG, "Response: %s", response->data);
         } else {
             ESP_LOGE(TAG, "RPC call failed with status %d", response->status_code);
-            free(http_response.buffer);
             response->success = false;
         }
     } else {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        free(http_response.buffer);
         response->success = false;
     }
 
     // Cleanup
-    esp_http_client_cleanup(http_client);
+    http_transport_response_free(&http_response);
     free(request_body);
 
     return err;
 }
 
+/**
+ * @brief Perform a call, repeating it while it fails for transient reasons
+ *
+ * Transport errors back off with jitter; after a 429 the limiter holds the
+ * next attempt until Retry-After has passed. Nothing is repeated once the
+ * node has answered the call itself.
+ */
+static esp_err_t rpc_perform_retry(solana_rpc_handle_t client, const char *method, const char *params,
+                                   solana_rpc_priority_t priority, rpc_flight_t *flight, bool retry,
+                                   solana_rpc_response_t *response)
+{
+    for (int attempt = 1; ; attempt++) {
+        esp_err_t err = limiter_acquire(client, priority, flight);
+        if (err != ESP_OK) {
+            return err;     // Shed: another attempt would wait even longer
+        }
+        err = rpc_perform(client, method, params, response);
+
+        solana_rpc_error_class_t error_class = solana_rpc_classify_error(err, response);
+        if (!retry || attempt >= SOLANA_RPC_MAX_ATTEMPTS ||
+            (error_class != SOLANA_RPC_ERROR_TRANSPORT && error_class != SOLANA_RPC_ERROR_RATE_LIMITED)) {
+            return err;
+        }
+
+        uint32_t delay_ms = error_class == SOLANA_RPC_ERROR_TRANSPORT ? solana_rpc_backoff_ms(attempt - 1) : 0;
+        ESP_LOGW(TAG, "%s: attempt %d failed (%s), retrying in %lu ms", method, attempt,
+                 error_class == SOLANA_RPC_ERROR_TRANSPORT ? "transport" : "rate limited",
+                 (unsigned long)delay_ms);
+        solana_rpc_free_response(response);
+        memset(response, 0, sizeof(*response));
+
+        portENTER_CRITICAL(&s_flight_lock);
+        s_stats.retries++;
+        portEXIT_CRITICAL(&s_flight_lock);
+        if (delay_ms) {
+            vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        }
+    }
+}
+
+esp_err_t solana_rpc_call(solana_rpc_handle_t client, const char *method, const char *params,
+                           solana_rpc_response_t *response)
+{
+    return solana_rpc_call_with_priority(client, method, params, SOLANA_RPC_PRIORITY_CRITICAL, response);
+}
+
+esp_err_t solana_rpc_call_with_priority(solana_rpc_handle_t client, const char *method, const char *params,
+                                        solana_rpc_priority_t priority, solana_rpc_response_t *response)
+{
+    if (!client || !method || !response) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Initialize response
+    memset(response, 0, sizeof(solana_rpc_response_t));
+
+    bool coalesce = true;   // Also: safe to retry
+    for (size_t i = 0; i < sizeof(s_not_idempotent) / sizeof(s_not_idempotent[0]); i++) {
+        if (strcmp(method, s_not_idempotent[i]) == 0) {
+            coalesce = false;
+        }
+    }
+    if (coalesce) {
+        sync_once(&s_flight_once, flight_init, NULL);
+    }
+
+    int slot = -1;
+    bool follow = false;
+
+    portENTER_CRITICAL(&s_flight_lock);
+    s_stats.calls++;
+    if (coalesce) {
+        slot = sync_flight_join(s_flight_slots, SOLANA_RPC_MAX_INFLIGHT, SOLANA_RPC_MAX_FOLLOWERS,
+                                flight_key(client->rpc_url, method, params), NULL, &follow);
+    }
+    if (follow) {
+        s_stats.coalesced++;
+        if (priority == SOLANA_RPC_PRIORITY_CRITICAL) {
+            s_flights[slot].priority = priority;    // Do not wait behind the background reserve
+        }
+    } else if (slot >= 0) {
+        s_flights[slot].priority = priority;
+        s_flights[slot].data = NULL;
+    }
+    portEXIT_CRITICAL(&s_flight_lock);
+
+    if (follow) {
+        ESP_LOGD(TAG, "%s: joining identical in-flight call", method);
+        sync_flight_wait(&s_flight_slots[slot]);
+
+        portENTER_CRITICAL(&s_flight_lock);
+        rpc_flight_t *f = &s_flights[slot];
+        esp_err_t err = f->err;
+        response->status_code = f->status_code;
+        response->success = f->success;
+        response->data = f->data;
+        response->length = f->length;
+        portEXIT_CRITICAL(&s_flight_lock);
+
+        if (!response->data) {
+            flight_release_empty(slot);
+        }
+        return err;
+    }
+
+    // No slot free: perform uncoalesced
+    rpc_flight_t *leader = slot >= 0 ? &s_flights[slot] : NULL;
+    esp_err_t err = rpc_perform_retry(client, method, params, priority, leader, coalesce, response);
+
+    if (leader) {
+        portENTER_CRITICAL(&s_flight_lock);
+        leader->err = err;
+        leader->status_code = response->status_code;
+        leader->success = response->success;
+        leader->data = response->data;
+        leader->length = response->length;
+        int followers = sync_flight_finish(&s_flight_slots[slot]);
+        portEXIT_CRITICAL(&s_flight_lock);
+
+        sync_flight_wake(&s_flight_slots[slot], followers);
+        if (!response->data) {
+            flight_release_empty(slot);
+        }
+    }
+    return err;
+}
+
+void solana_rpc_get_stats(solana_rpc_stats_t *stats_out)
+{
+    if (!stats_out) {
+        return;
+    }
+    portENTER_CRITICAL(&s_flight_lock);
+    *stats_out = s_stats;
+    portEXIT_CRITICAL(&s_flight_lock);
+}
+
+/**
+ * @brief Case-insensitive strstr (strcasestr is not always available)
+ */
+static const char *find_text(const char *haystack, const char *needle)
+{
+    size_t needle_len = strlen(needle);
+    for (const char *p = haystack; *p; p++) {
+        if (strncasecmp(p, needle, needle_len) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+solana_rpc_error_class_t solana_rpc_classify_text(const char *text)
+{
+    if (!text) {
+        return SOLANA_RPC_ERROR_NONE;
+    }
+    for (size_t i = 0; i < sizeof(s_error_text) / sizeof(s_error_text[0]); i++) {
+        if (find_text(text, s_error_text[i].text)) {
+            return s_error_text[i].error_class;
+        }
+    }
+    return SOLANA_RPC_ERROR_NONE;
+}
+
+solana_rpc_error_class_t solana_rpc_classify_error(esp_err_t err, const solana_rpc_response_t *response)
+{
+    if (err != ESP_OK) {
+        return SOLANA_RPC_ERROR_TRANSPORT;
+    }
+    if (!response) {
+        return SOLANA_RPC_ERROR_NONE;
+    }
+    if (response->status_code == 429) {
+        return SOLANA_RPC_ERROR_RATE_LIMITED;
+    }
+    if (response->status_code == 0 || response->status_code >= 500) {
+        return SOLANA_RPC_ERROR_TRANSPORT;
+    }
+    if (!response->success || !response->data) {
+        return SOLANA_RPC_ERROR_REJECTED;
+    }
+
+    // JSON-RPC errors come back as HTTP 200
+    const char *error = strstr(response->data, "\"error\":");
+    if (!error) {
+        return SOLANA_RPC_ERROR_NONE;
+    }
+    solana_rpc_error_class_t error_class = solana_rpc_classify_text(error);
+    return error_class != SOLANA_RPC_ERROR_NONE ? error_class : SOLANA_RPC_ERROR_REJECTED;
+}
+
+uint32_t solana_rpc_backoff_ms(int attempt)
+{
+    uint32_t cap = SOLANA_RPC_BACKOFF_MAX_MS;
+    if (attempt >= 0 && attempt < 16 && ((uint32_t)SOLANA_RPC_BACKOFF_BASE_MS << attempt) < cap) {
+        cap = (uint32_t)SOLANA_RPC_BACKOFF_BASE_MS << attempt;
+    }
+    // Equal jitter: callers that failed together do not retry together
+    return cap / 2 + esp_random() % (cap / 2 + 1);
+}
+
+esp_err_t solana_rpc_get_blockhash(solana_rpc_handle_t client, uint8_t *blockhash_out,
+                                   uint64_t *last_valid_block_height)
+{
+    if (!client || !blockhash_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    solana_rpc_response_t response;
+    esp_err_t err = solana_rpc_get_latest_blockhash(client, &response);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!response.success) {
+        solana_rpc_free_response(&response);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(response.data, response.length);
+    solana_rpc_free_response(&response);
+    cJSON *result = root ? cJSON_GetObjectItem(root, "result") : NULL;
+    cJSON *value = result ? cJSON_GetObjectItem(result, "value") : NULL;
+    cJSON *blockhash = value ? cJSON_GetObjectItem(value, "blockhash") : NULL;
+    cJSON *height = value ? cJSON_GetObjectItem(value, "lastValidBlockHeight") : NULL;
+
+    size_t len = 0;
+    if (!cJSON_IsString(blockhash) ||
+        !base58_decode(blockhash->valuestring, blockhash_out, &len, 32) || len != 32) {
+        ESP_LOGE(TAG, "Invalid blockhash in response");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (last_valid_block_height) {
+        *last_valid_block_height = cJSON_IsNumber(height) ? (uint64_t)height->valuedouble : 0;
+    }
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
 esp_err_t solana_rpc_get_latest_blockhash(solana_rpc_handle_t client, solana_rpc_response_t *response)
 {
     const char *params = "[{\"commitment\":\"finalized\"}]";
@@ -225,13 +737,29 @@ esp_err_t solana_rpc_get_balance(solana_rpc_handle_t client, const char *pubkey_
 esp_err_t solana_rpc_send_transaction(solana_rpc_handle_t client, const char *transaction_base58,
                                        solana_rpc_response_t *response)
 {
-    if (!transaction_base58) {
+    const solana_rpc_send_options_t options = {
+        .skip_preflight = false,
+        .max_retries = -1,
+    };
+    return solana_rpc_send_transaction_with_options(client, transaction_base58, &options, response);
+}
+
+esp_err_t solana_rpc_send_transaction_with_options(solana_rpc_handle_t client, const char *transaction_base58,
+                                                   const solana_rpc_send_options_t *options,
+                                                   solana_rpc_response_t *response)
+{
+    if (!transaction_base58 || !options) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    char max_retries[32] = "";
+    if (options->max_retries >= 0) {
+        snprintf(max_retries, sizeof(max_retries), ",\"maxRetries\":%d", options->max_retries);
+    }
+
     char *params = NULL;
-    asprintf(&params, "[\"%s\",{\"encoding\":\"base58\",\"skipPreflight\":false,\"preflightCommitment\":\"finalized\"}]",
-             transaction_base58);
+    asprintf(&params, "[\"%s\",{\"encoding\":\"base58\",\"skipPreflight\":%s,\"preflightCommitment\":\"confirmed\"%s}]",
+             transaction_base58, options->skip_preflight ? "true" : "false", max_retries);
     
     if (!params) {
         return ESP_ERR_NO_MEM;
@@ -242,6 +770,90 @@ esp_err_t solana_rpc_send_transaction(solana_rpc_handle_t client, const char *tr
     return ret;
 }
 
+esp_err_t solana_rpc_get_signature_status(solana_rpc_handle_t client, const char *signature_base58,
+                                          solana_rpc_signature_status_t *status)
+{
+    if (!signature_base58 || !status) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(status, 0, sizeof(*status));
+
+    char *params = NULL;
+    asprintf(&params, "[[\"%s\"]]", signature_base58);
+    
+    if (!params) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Polling: must not crowd out the calls that make progress
+    solana_rpc_response_t response;
+    esp_err_t err = solana_rpc_call_with_priority(client, "getSignatureStatuses", params,
+                                                  SOLANA_RPC_PRIORITY_BACKGROUND, &response);
+    free(params);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!response.success) {
+        solana_rpc_free_response(&response);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(response.data, response.length);
+    solana_rpc_free_response(&response);
+    cJSON *result = root ? cJSON_GetObjectItem(root, "result") : NULL;
+    cJSON *value = result ? cJSON_GetObjectItem(result, "value") : NULL;
+    if (!cJSON_IsArray(value)) {
+        ESP_LOGE(TAG, "getSignatureStatuses: missing result.value");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    cJSON *entry = cJSON_GetArrayItem(value, 0);
+    if (entry && !cJSON_IsNull(entry)) {
+        cJSON *slot = cJSON_GetObjectItem(entry, "slot");
+        cJSON *error = cJSON_GetObjectItem(entry, "err");
+        cJSON *level = cJSON_GetObjectItem(entry, "confirmationStatus");
+        const char *level_str = cJSON_IsString(level) ? level->valuestring : "";
+        status->commitment = strcmp(level_str, "finalized") == 0 ? SOLANA_RPC_COMMITMENT_FINALIZED
+                           : strcmp(level_str, "confirmed") == 0 ? SOLANA_RPC_COMMITMENT_CONFIRMED
+                           : SOLANA_RPC_COMMITMENT_PROCESSED;
+        status->failed = error && !cJSON_IsNull(error);
+        status->slot = cJSON_IsNumber(slot) ? (uint64_t)slot->valuedouble : 0;
+    }
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+esp_err_t solana_rpc_get_block_height(solana_rpc_handle_t client, uint64_t *height_out)
+{
+    if (!height_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    solana_rpc_response_t response;
+    esp_err_t err = solana_rpc_call_with_priority(client, "getBlockHeight", "[{\"commitment\":\"confirmed\"}]",
+                                                  SOLANA_RPC_PRIORITY_BACKGROUND, &response);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!response.success) {
+        solana_rpc_free_response(&response);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(response.data, response.length);
+    solana_rpc_free_response(&response);
+    cJSON *result = root ? cJSON_GetObjectItem(root, "result") : NULL;
+    if (!cJSON_IsNumber(result)) {
+        ESP_LOGE(TAG, "getBlockHeight: missing result");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    *height_out = (uint64_t)result->valuedouble;
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
 esp_err_t solana_rpc_get_transaction(solana_rpc_handle_t client, const char *signature_base58,
                                       solana_rpc_response_t *response)
 {
@@ -262,9 +874,253 @@ esp_err_t solana_rpc_get_transaction(solana_rpc_handle_t client, const char *sig
     return ret;
 }
 
+#define ACCOUNT_CONFIG_LEN 160
+
+/**
+ * @brief Config object for the account methods: base64 data, sliced unless length is SOLANA_RPC_DATA_ALL
+ */
+static void account_config(char *buf, size_t size, size_t data_offset, size_t data_length)
+{
+    if (data_length == SOLANA_RPC_DATA_ALL) {
+        snprintf(buf, size, "{\"encoding\":\"base64\",\"commitment\":\"finalized\"}");
+    } else {
+        snprintf(buf, size, "{\"encoding\":\"base64\",\"dataSlice\":{\"offset\":%zu,\"length\":%zu},"
+                 "\"commitment\":\"finalized\"}", data_offset, data_length);
+    }
+}
+
+/**
+ * @brief Make an account call and return its parsed response and result.value
+ */
+static esp_err_t account_call(solana_rpc_handle_t client, const char *method, const char *params,
+                              cJSON **root_out, const cJSON **value_out)
+{
+    solana_rpc_response_t response;
+    esp_err_t err = solana_rpc_call(client, method, params, &response);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!response.success) {
+        solana_rpc_free_response(&response);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(response.data, response.length);
+    solana_rpc_free_response(&response);
+    if (!root) {
+        ESP_LOGE(TAG, "%s: failed to parse response", method);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    const cJSON *error = cJSON_GetObjectItem(root, "error");
+    if (error) {
+        const cJSON *message = cJSON_GetObjectItem(error, "message");
+        ESP_LOGE(TAG, "%s: %s", method, cJSON_IsString(message) ? message->valuestring : "RPC error");
+        cJSON_Delete(root);
+        return ESP_FAIL;
+    }
+
+    const cJSON *result = cJSON_GetObjectItem(root, "result");
+    const cJSON *value = result ? cJSON_GetObjectItem(result, "value") : NULL;
+    if (!value) {
+        ESP_LOGE(TAG, "%s: missing result.value", method);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    *root_out = root;
+    *value_out = value;
+    return ESP_OK;
+}
+
+/**
+ * @brief Fill an account from one base64-encoded result value (null = no account)
+ */
+static esp_err_t account_parse(const cJSON *value, solana_rpc_account_t *account)
+{
+    memset(account, 0, sizeof(*account));
+    if (cJSON_IsNull(value)) {
+        return ESP_OK;
+    }
+
+    const cJSON *owner = cJSON_GetObjectItem(value, "owner");
+    const cJSON *lamports = cJSON_GetObjectItem(value, "lamports");
+    const cJSON *data = cJSON_GetObjectItem(value, "data");
+    const cJSON *data_b64 = cJSON_IsArray(data) ? cJSON_GetArrayItem(data, 0) : NULL;
+    size_t owner_len = 0;
+    if (!cJSON_IsString(owner) || !cJSON_IsNumber(lamports) || !cJSON_IsString(data_b64) ||
+        !base58_decode(owner->valuestring, account->owner, &owner_len, sizeof(account->owner)) ||
+        owner_len != sizeof(account->owner)) {
+        ESP_LOGE(TAG, "Malformed account in RPC response");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    account->lamports = (uint64_t)lamports->valuedouble;
+    account->executable = cJSON_IsTrue(cJSON_GetObjectItem(value, "executable"));
+
+    size_t b64_len = strlen(data_b64->valuestring);
+    if (b64_len > 0) {
+        size_t cap = b64_len / 4 * 3;
+        account->data = bulk_alloc(cap ? cap : 1);
+        if (!account->data) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (mbedtls_base64_decode(account->data, cap, &account->data_len,
+                                  (const unsigned char *)data_b64->valuestring, b64_len) != 0) {
+            ESP_LOGE(TAG, "Invalid base64 account data");
+            solana_rpc_free_account(account);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    account->exists = true;
+    return ESP_OK;
+}
+
+esp_err_t solana_rpc_get_account_info(solana_rpc_handle_t client, const char *pubkey_base58,
+                                      size_t data_offset, size_t data_length,
+                                      solana_rpc_account_t *account)
+{
+    if (!pubkey_base58 || !account) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(account, 0, sizeof(*account));
+
+    char config[ACCOUNT_CONFIG_LEN];
+    account_config(config, sizeof(config), data_offset, data_length);
+    char *params = NULL;
+    asprintf(&params, "[\"%s\",%s]", pubkey_base58, config);
+
+    if (!params) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    cJSON *root = NULL;
+    const cJSON *value = NULL;
+    esp_err_t ret = account_call(client, "getAccountInfo", params, &root, &value);
+    free(params);
+    if (ret == ESP_OK) {
+        ret = account_parse(value, account);
+        cJSON_Delete(root);
+    }
+    return ret;
+}
+
+esp_err_t solana_rpc_get_multiple_accounts(solana_rpc_handle_t client, const char *const *pubkeys_base58,
+                                           size_t count, size_t data_offset, size_t data_length,
+                                           solana_rpc_account_t *accounts)
+{
+    if (!pubkeys_base58 || !accounts || count == 0 || count > SOLANA_RPC_MAX_MULTIPLE_ACCOUNTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(accounts, 0, count * sizeof(*accounts));
+
+    size_t params_size = ACCOUNT_CONFIG_LEN + 8;
+    for (size_t i = 0; i < count; i++) {
+        if (!pubkeys_base58[i]) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        params_size += strlen(pubkeys_base58[i]) + 3;
+    }
+    char *params = malloc(params_size);
+    if (!params) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = snprintf(params, params_size, "[[");
+    for (size_t i = 0; i < count; i++) {
+        len += snprintf(params + len, params_size - len, "%s\"%s\"", i ? "," : "", pubkeys_base58[i]);
+    }
+    len += snprintf(params + len, params_size - len, "],");
+    account_config(params + len, params_size - len - 1, data_offset, data_length);
+    strcat(params, "]");
+
+    cJSON *root = NULL;
+    const cJSON *value = NULL;
+    esp_err_t ret = account_call(client, "getMultipleAccounts", params, &root, &value);
+    free(params);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (!cJSON_IsArray(value) || (size_t)cJSON_GetArraySize(value) != count) {
+        ESP_LOGE(TAG, "getMultipleAccounts: expected %zu accounts", count);
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    for (size_t i = 0; ret == ESP_OK && i < count; i++) {
+        ret = account_parse(cJSON_GetArrayItem(value, i), &accounts[i]);
+    }
+    cJSON_Delete(root);
+
+    if (ret != ESP_OK) {
+        for (size_t i = 0; i < count; i++) {
+            solana_rpc_free_account(&accounts[i]);
+        }
+    }
+    return ret;
+}
+
+void solana_rpc_free_account(solana_rpc_account_t *account)
+{
+    if (account) {
+        free(account->data);
+        account->data = NULL;
+        account->data_len = 0;
+    }
+}
+
+esp_err_t solana_rpc_set_compression(solana_rpc_handle_t client, bool enable)
+{
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->compression = enable;
+    return ESP_OK;
+}
+
+esp_err_t solana_rpc_set_rate_limit(solana_rpc_handle_t client, uint32_t requests_per_second,
+                                    uint32_t burst)
+{
+    if (!client || (requests_per_second && !burst)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->endpoint) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    portENTER_CRITICAL(&s_limiter_lock);
+    rpc_endpoint_t *ep = client->endpoint;
+    ep->max_rate_milli = requests_per_second * 1000LL;
+    ep->rate_milli = ep->max_rate_milli;
+    ep->burst_milli = burst * 1000LL;
+    ep->tokens_milli = ep->burst_milli;
+    ep->refill_us = esp_timer_get_time();
+    ep->answered = 0;
+    portEXIT_CRITICAL(&s_limiter_lock);
+    return ESP_OK;
+}
+
+esp_err_t solana_rpc_get_limiter_stats(solana_rpc_handle_t client, solana_rpc_limiter_stats_t *stats_out)
+{
+    if (!client || !stats_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->endpoint) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_limiter_lock);
+    rpc_endpoint_t *ep = client->endpoint;
+    if (ep->max_rate_milli > 0) {
+        limiter_refill(ep, now);
+    }
+    *stats_out = ep->stats;
+    stats_out->rate_milli = (uint32_t)ep->rate_milli;
+    stats_out->tokens_milli = (uint32_t)ep->tokens_milli;
+    stats_out->blocked_ms = now < ep->blocked_until_us ? (uint32_t)((ep->blocked_until_us - now) / 1000) : 0;
+    portEXIT_CRITICAL(&s_limiter_lock);
+    return ESP_OK;
+}
+
 void solana_rpc_destroy(solana_rpc_handle_t client)
 {
     if (client) {
+        endpoint_detach(client);
         if (client->rpc_url) {
             free(client->rpc_url);
         }
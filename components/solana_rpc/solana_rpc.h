@@ -12,6 +12,21 @@ extern "C" {
 
 #define SOLANA_RPC_MAX_RESPONSE_SIZE 16384  // 16KB max response
 #define SOLANA_RPC_TIMEOUT_MS 30000         // 30 second timeout
+#define SOLANA_RPC_COMPRESSION false        // Default for solana_rpc_set_compression
+#define SOLANA_RPC_MAX_INFLIGHT 8           // Distinct calls that can be coalesced at once
+#define SOLANA_RPC_MAX_FOLLOWERS 16         // Callers that can join one in-flight call
+#define SOLANA_RPC_MAX_ENDPOINTS 4          // RPC URLs with their own rate limiter
+#define SOLANA_RPC_RATE_LIMIT_RPS 10        // Default requests/s per endpoint (0 = unlimited)
+#define SOLANA_RPC_RATE_LIMIT_BURST 10      // Default bucket size
+#define SOLANA_RPC_RATE_LIMIT_MIN_RPS 1     // Floor when backing off after 429s
+#define SOLANA_RPC_BACKGROUND_RESERVE 3     // Tokens background calls leave for critical ones
+#define SOLANA_RPC_RETRY_AFTER_DEFAULT_MS 1000  // Pause after a 429 without Retry-After
+#define SOLANA_RPC_RETRY_AFTER_MAX_MS 60000     // Longest Retry-After honored
+#define SOLANA_RPC_MAX_MULTIPLE_ACCOUNTS 100    // getMultipleAccounts limit of the RPC API
+#define SOLANA_RPC_DATA_ALL SIZE_MAX            // data_length: the whole account data
+#define SOLANA_RPC_MAX_ATTEMPTS 3           // Tries per call on transport errors and 429s
+#define SOLANA_RPC_BACKOFF_BASE_MS 250      // First retry delay (doubles, with jitter)
+#define SOLANA_RPC_BACKOFF_MAX_MS 4000      // Longest retry delay
 
 /**
  * @brief Solana RPC client handle
@@ -22,12 +37,93 @@ typedef struct solana_rpc_client_t* solana_rpc_handle_t;
  * @brief Solana RPC response structure
  */
 typedef struct {
-    char *data;           // Response data (JSON string)
+    char *data;           // Response data (JSON string, read-only: may be shared)
     size_t length;        // Length of response data
     int status_code;      // HTTP status code
     bool success;         // Whether request was successful
 } solana_rpc_response_t;
 
+/**
+ * @brief Account fetched with base64 encoding
+ */
+typedef struct {
+    bool exists;          // false if there is no account (other fields are zero)
+    uint8_t owner[32];    // Owning program
+    uint64_t lamports;
+    bool executable;
+    uint8_t *data;        // Requested slice of the account data (NULL if empty)
+    size_t data_len;
+} solana_rpc_account_t;
+
+/**
+ * @brief What a failed call needs to recover
+ */
+typedef enum {
+    SOLANA_RPC_ERROR_NONE = 0,
+    SOLANA_RPC_ERROR_TRANSPORT,           // No answer, 5xx or node behind: send again
+    SOLANA_RPC_ERROR_RATE_LIMITED,        // 429: send again after Retry-After
+    SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED,   // Re-sign with a fresh blockhash
+    SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS,  // Not recoverable by retrying
+    SOLANA_RPC_ERROR_REJECTED,            // Any other error: not recoverable by retrying
+} solana_rpc_error_class_t;
+
+/**
+ * @brief Commitment level a transaction has reached
+ */
+typedef enum {
+    SOLANA_RPC_COMMITMENT_NONE = 0,       // Not seen by the node (yet)
+    SOLANA_RPC_COMMITMENT_PROCESSED,
+    SOLANA_RPC_COMMITMENT_CONFIRMED,
+    SOLANA_RPC_COMMITMENT_FINALIZED,
+} solana_rpc_commitment_t;
+
+/**
+ * @brief Status of one transaction signature
+ */
+typedef struct {
+    solana_rpc_commitment_t commitment;
+    bool failed;          // Landed, but the transaction returned an error
+    uint64_t slot;
+} solana_rpc_signature_status_t;
+
+/**
+ * @brief sendTransaction options
+ */
+typedef struct {
+    bool skip_preflight;  // Do not simulate first (rebroadcasts of checked bytes)
+    int max_retries;      // Node-side rebroadcasts, -1 = node default
+} solana_rpc_send_options_t;
+
+/**
+ * @brief Call priority for the endpoint rate limiter
+ */
+typedef enum {
+    SOLANA_RPC_PRIORITY_CRITICAL = 0,     // Payment path: may use the whole bucket
+    SOLANA_RPC_PRIORITY_BACKGROUND,       // Polling, refreshes: keeps a reserve free
+} solana_rpc_priority_t;
+
+/**
+ * @brief Rate limiter state and counters of one endpoint
+ */
+typedef struct {
+    uint32_t rate_milli;  // Current allowed requests/s x1000
+    uint32_t tokens_milli; // Tokens in the bucket x1000
+    uint32_t blocked_ms;  // Remaining Retry-After pause
+    uint32_t throttled;   // 429 responses
+    uint32_t delayed;     // Calls that waited for a token
+    uint32_t delay_ms;    // Total time those calls waited
+    uint32_t shed;        // Calls failed locally because the wait exceeded the timeout
+} solana_rpc_limiter_stats_t;
+
+/**
+ * @brief Single-flight and retry counters
+ */
+typedef struct {
+    uint32_t calls;       // solana_rpc_call invocations
+    uint32_t coalesced;   // Calls answered by joining an identical in-flight call
+    uint32_t retries;     // Calls sent again after a transport error or 429
+} solana_rpc_stats_t;
+
 /**
  * @brief Create a new Solana RPC client
  * 
@@ -66,6 +162,8 @@ esp_err_t solana_rpc_get_balance(solana_rpc_handle_t client, const char *pubkey_
 /**
  * @brief Send a raw transaction
  * 
+ * Simulated first at confirmed commitment; the node rebroadcasts it.
+ * 
  * @param client RPC client handle
  * @param transaction_base58 Serialized transaction in Base58 format
  * @param response Response structure to populate
@@ -74,6 +172,44 @@ esp_err_t solana_rpc_get_balance(solana_rpc_handle_t client, const char *pubkey_
 esp_err_t solana_rpc_send_transaction(solana_rpc_handle_t client, const char *transaction_base58,
                                        solana_rpc_response_t *response);
 
+/**
+ * @brief Send a raw transaction with explicit options
+ * 
+ * @param client RPC client handle
+ * @param transaction_base58 Serialized transaction in Base58 format
+ * @param options Preflight and node retry options
+ * @param response Response structure to populate
+ * @return ESP_OK on success
+ */
+esp_err_t solana_rpc_send_transaction_with_options(solana_rpc_handle_t client, const char *transaction_base58,
+                                                   const solana_rpc_send_options_t *options,
+                                                   solana_rpc_response_t *response);
+
+/**
+ * @brief Get the status of a transaction signature (getSignatureStatuses)
+ * 
+ * Sent with background priority, so polling leaves tokens for other calls.
+ * 
+ * @param client RPC client handle
+ * @param signature_base58 Transaction signature in Base58 format
+ * @param status Output: status (commitment NONE if the node has not seen it)
+ * @return ESP_OK on success
+ */
+esp_err_t solana_rpc_get_signature_status(solana_rpc_handle_t client, const char *signature_base58,
+                                          solana_rpc_signature_status_t *status);
+
+/**
+ * @brief Get the current block height at confirmed commitment
+ * 
+ * Compare with the lastValidBlockHeight of a blockhash to know when a
+ * transaction using it can no longer land.
+ * 
+ * @param client RPC client handle
+ * @param height_out Output: block height
+ * @return ESP_OK on success
+ */
+esp_err_t solana_rpc_get_block_height(solana_rpc_handle_t client, uint64_t *height_out);
+
 /**
  * @brief Get transaction status
  * 
@@ -85,9 +221,73 @@ esp_err_t solana_rpc_send_transaction(solana_rpc_handle_t client, const char *tr
 esp_err_t solana_rpc_get_transaction(solana_rpc_handle_t client, const char *signature_base58,
                                       solana_rpc_response_t *response);
 
+/**
+ * @brief Get the latest blockhash as bytes
+ * 
+ * @param client RPC client handle
+ * @param blockhash_out Output: blockhash (32 bytes)
+ * @param last_valid_block_height Output: last block height it is valid for (can be NULL)
+ * @return ESP_OK on success
+ */
+esp_err_t solana_rpc_get_blockhash(solana_rpc_handle_t client, uint8_t *blockhash_out,
+                                   uint64_t *last_valid_block_height);
+
+/**
+ * @brief Get an account with base64 data, limited to the bytes needed
+ * 
+ * Only data_length bytes from data_offset are requested (dataSlice), so
+ * with data_length 0 the node returns just owner and lamports: a few
+ * hundred bytes instead of a jsonParsed document.
+ * 
+ * @param client RPC client handle
+ * @param pubkey_base58 Account address in Base58 format
+ * @param data_offset First data byte to return
+ * @param data_length Bytes to return, 0 for none or SOLANA_RPC_DATA_ALL
+ * @param account Output: account, free with solana_rpc_free_account
+ * @return ESP_OK on success (also if the account does not exist),
+ *         ESP_ERR_INVALID_RESPONSE if the response is malformed
+ */
+esp_err_t solana_rpc_get_account_info(solana_rpc_handle_t client, const char *pubkey_base58,
+                                      size_t data_offset, size_t data_length,
+                                      solana_rpc_account_t *account);
+
+/**
+ * @brief Get several accounts in one call, with the same data slice for each
+ * 
+ * @param client RPC client handle
+ * @param pubkeys_base58 Account addresses in Base58 format
+ * @param count Number of addresses (at most SOLANA_RPC_MAX_MULTIPLE_ACCOUNTS)
+ * @param data_offset First data byte to return
+ * @param data_length Bytes to return, 0 for none or SOLANA_RPC_DATA_ALL
+ * @param accounts Output: count accounts, free each with solana_rpc_free_account
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE if the response is malformed
+ */
+esp_err_t solana_rpc_get_multiple_accounts(solana_rpc_handle_t client, const char *const *pubkeys_base58,
+                                           size_t count, size_t data_offset, size_t data_length,
+                                           solana_rpc_account_t *accounts);
+
+/**
+ * @brief Free account data
+ * 
+ * @param account Account to free
+ */
+void solana_rpc_free_account(solana_rpc_account_t *account);
+
 /**
  * @brief Make a generic JSON-RPC call
  * 
+ * Identical calls (same RPC URL, method and params) issued while one is in
+ * flight do not go out again: they wait for it and get the same response,
+ * sharing one reference-counted buffer. Release it with
+ * solana_rpc_free_response as usual and do not modify it.
+ * 
+ * Calls go through the endpoint rate limiter with critical priority: they
+ * wait for a token or a Retry-After pause to end, and fail with
+ * ESP_ERR_TIMEOUT without sending if that takes longer than the client
+ * timeout. Transport errors, 5xx and 429 answers are retried up to
+ * SOLANA_RPC_MAX_ATTEMPTS times (transport errors with jittered backoff,
+ * 429 after Retry-After); requestAirdrop is never repeated.
+ * 
  * @param client RPC client handle
  * @param method RPC method name
  * @param params JSON array of parameters (can be NULL)
@@ -97,6 +297,100 @@ esp_err_t solana_rpc_get_transaction(solana_rpc_handle_t client, const char *sig
 esp_err_t solana_rpc_call(solana_rpc_handle_t client, const char *method, const char *params,
                            solana_rpc_response_t *response);
 
+/**
+ * @brief Make a generic JSON-RPC call with a rate limiter priority
+ * 
+ * Same as solana_rpc_call. Background calls only take a token while more
+ * than SOLANA_RPC_BACKGROUND_RESERVE are left, so polling cannot starve the
+ * payment path. A critical call that joins an identical background call in
+ * flight raises it to critical priority.
+ * 
+ * @param client RPC client handle
+ * @param method RPC method name
+ * @param params JSON array of parameters (can be NULL)
+ * @param priority Rate limiter priority
+ * @param response Response structure to populate
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if rate limiting kept it from being sent
+ */
+esp_err_t solana_rpc_call_with_priority(solana_rpc_handle_t client, const char *method, const char *params,
+                                        solana_rpc_priority_t priority, solana_rpc_response_t *response);
+
+/**
+ * @brief Configure the rate limiter of the client's endpoint
+ * 
+ * The limiter is shared by all clients of the same RPC URL. After a 429 it
+ * halves the rate (down to SOLANA_RPC_RATE_LIMIT_MIN_RPS) and pauses for
+ * Retry-After; answered calls raise it back towards this maximum.
+ * 
+ * @param client RPC client handle
+ * @param requests_per_second Maximum rate, 0 = unlimited
+ * @param burst Bucket size (calls that can go out back to back)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the endpoint has no limiter slot
+ */
+esp_err_t solana_rpc_set_rate_limit(solana_rpc_handle_t client, uint32_t requests_per_second,
+                                    uint32_t burst);
+
+/**
+ * @brief Get the rate limiter state of the client's endpoint
+ * 
+ * @param client RPC client handle
+ * @param stats_out Output: limiter state and counters
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the endpoint has no limiter slot
+ */
+esp_err_t solana_rpc_get_limiter_stats(solana_rpc_handle_t client, solana_rpc_limiter_stats_t *stats_out);
+
+/**
+ * @brief Classify the outcome of a call
+ * 
+ * JSON-RPC errors (HTTP 200 with an "error" member) are classified by their
+ * message and data, e.g. "Blockhash not found" or an insufficient funds
+ * simulation failure.
+ * 
+ * @param err Return value of the call
+ * @param response Response of the call (can be NULL)
+ * @return SOLANA_RPC_ERROR_NONE if the call succeeded
+ */
+solana_rpc_error_class_t solana_rpc_classify_error(esp_err_t err, const solana_rpc_response_t *response);
+
+/**
+ * @brief Classify an error message (RPC or facilitator) by what it says
+ * 
+ * @param text Error text
+ * @return Matching class, SOLANA_RPC_ERROR_NONE if none matches
+ */
+solana_rpc_error_class_t solana_rpc_classify_text(const char *text);
+
+/**
+ * @brief Delay before retry number attempt (0-based)
+ * 
+ * Exponential from SOLANA_RPC_BACKOFF_BASE_MS up to SOLANA_RPC_BACKOFF_MAX_MS,
+ * randomized over its upper half.
+ * 
+ * @param attempt Retries made so far
+ * @return Delay in ms
+ */
+uint32_t solana_rpc_backoff_ms(int attempt);
+
+/**
+ * @brief Ask the RPC node for gzip/deflate responses
+ *
+ * Responses are inflated as they arrive, so callers still get plain JSON.
+ * Verbose replies (jsonParsed accounts, getTransaction) shrink several times
+ * on the air; SOLANA_RPC_MAX_RESPONSE_SIZE still limits the inflated size.
+ *
+ * @param client RPC client handle
+ * @param enable true to send Accept-Encoding: gzip, deflate
+ * @return ESP_OK on success
+ */
+esp_err_t solana_rpc_set_compression(solana_rpc_handle_t client, bool enable);
+
+/**
+ * @brief Get single-flight and retry counters since boot
+ * 
+ * @param stats_out Output: counters
+ */
+void solana_rpc_get_stats(solana_rpc_stats_t *stats_out);
+
 /**
  * @brief Destroy RPC client and free resources
  * 
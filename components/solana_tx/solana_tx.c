@@ -63,6 +63,19 @@ static size_t encode_compact_u16(uint16_t value, uint8_t *out) {
     }
 }
 
+static bool decode_compact_u16(const uint8_t *in, size_t len, size_t *value, size_t *consumed) {
+    size_t result = 0;
+    for (size_t i = 0; i < 3 && i < len; i++) {
+        result |= (size_t)(in[i] & 0x7f) << (7 * i);
+        if (!(in[i] & 0x80)) {
+            *value = result;
+            *consumed = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 static int find_or_add_account(solana_tx_t *tx, const solana_pubkey_t *pubkey, 
                                  bool is_signer, bool is_writable) {
     // Check if account already exists
@@ -119,6 +132,16 @@ solana_tx_t* solana_tx_new(const char *recent_blockhash, const solana_pubkey_t *
     return tx;
 }
 
+esp_err_t solana_tx_set_blockhash(solana_tx_t *tx, const uint8_t *blockhash) {
+    if (!tx || !blockhash) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(tx->blockhash, blockhash, SOLANA_BLOCKHASH_SIZE);
+    tx->has_signature = false;  // Signed the old message
+    return ESP_OK;
+}
+
 esp_err_t solana_tx_add_transfer(solana_tx_t *tx, const solana_pubkey_t *from,
                                   const solana_pubkey_t *to, uint64_t lamports) {
     if (!tx || !from || !to) {
@@ -339,6 +362,53 @@ esp_err_t solana_tx_serialize(solana_tx_t *tx, uint8_t *output,
     return ESP_OK;
 }
 
+esp_err_t solana_tx_wire_parse(const uint8_t *tx, size_t tx_len, solana_tx_wire_layout_t *layout) {
+    if (!tx || !layout) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    size_t offset = 0, consumed;
+    
+    // Signatures
+    if (!decode_compact_u16(tx, tx_len, &layout->signature_count, &consumed)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    offset += consumed;
+    layout->signatures_offset = offset;
+    offset += layout->signature_count * SOLANA_SIGNATURE_SIZE;
+    layout->message_offset = offset;
+    
+    // Versioned messages start with 0x80 | version
+    if (offset < tx_len && (tx[offset] & 0x80)) {
+        offset++;
+    }
+    
+    // Header
+    if (offset + 3 > tx_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    layout->required_signatures = tx[offset];
+    offset += 3;
+    
+    // Account addresses
+    if (!decode_compact_u16(tx + offset, tx_len - offset, &layout->account_count, &consumed)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    offset += consumed;
+    layout->accounts_offset = offset;
+    offset += layout->account_count * SOLANA_PUBKEY_SIZE;
+    
+    // Recent blockhash
+    layout->blockhash_offset = offset;
+    if (offset + SOLANA_BLOCKHASH_SIZE > tx_len ||
+        layout->required_signatures > layout->account_count ||
+        layout->signature_count != layout->required_signatures) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    return ESP_OK;
+}
+
 void solana_tx_destroy(solana_tx_t *tx) {
     if (tx) {
         // Free instruction data
@@ -26,6 +26,19 @@ typedef struct {
  */
 typedef struct solana_tx_t solana_tx_t;
 
+/**
+ * @brief Offsets into a serialized (wire format) transaction
+ */
+typedef struct {
+    size_t signature_count;
+    size_t signatures_offset;       // First 64-byte signature slot
+    size_t message_offset;          // Signed bytes run from here to the end
+    size_t required_signatures;     // The first accounts are the signers, in slot order
+    size_t account_count;
+    size_t accounts_offset;
+    size_t blockhash_offset;
+} solana_tx_wire_layout_t;
+
 /**
  * @brief Create a new transaction builder
  * 
@@ -35,6 +48,17 @@ typedef struct solana_tx_t solana_tx_t;
  */
 solana_tx_t* solana_tx_new(const char *recent_blockhash, const solana_pubkey_t *payer);
 
+/**
+ * @brief Replace the recent blockhash
+ * 
+ * The signature no longer matches the message; sign again before serializing.
+ * 
+ * @param tx Transaction builder
+ * @param blockhash New blockhash (32 bytes)
+ * @return ESP_OK on success
+ */
+esp_err_t solana_tx_set_blockhash(solana_tx_t *tx, const uint8_t *blockhash);
+
 /**
  * @brief Add a SOL transfer instruction
  * 
@@ -82,6 +106,19 @@ esp_err_t solana_tx_add_signature(solana_tx_t *tx, const uint8_t *signature);
 esp_err_t solana_tx_serialize(solana_tx_t *tx, uint8_t *output, 
                                size_t *output_len, size_t max_len);
 
+/**
+ * @brief Locate signatures, signers and blockhash in a serialized transaction
+ * 
+ * Lets a signed transaction get a fresh blockhash and be signed again in
+ * place, without rebuilding it. Legacy and versioned messages are supported.
+ * 
+ * @param tx Serialized transaction
+ * @param tx_len Transaction length
+ * @param layout Output: offsets
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if it is truncated or malformed
+ */
+esp_err_t solana_tx_wire_parse(const uint8_t *tx, size_t tx_len, solana_tx_wire_layout_t *layout);
+
 /**
  * @brief Destroy transaction builder
  * 
@@ -1,7 +1,12 @@
 #include "solana_wallet.h"
 #include "tweetnacl.h"
 #include "base58.h"
+#include "bulk_mem.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdlib.h>
 #include <cJSON.h>
@@ -12,6 +17,9 @@ struct solana_wallet_t {
     uint8_t secret_key[64];  // Ed25519 secret key
     uint8_t public_key[32];  // Ed25519 public key
     solana_rpc_handle_t rpc;
+    crypto_sign_scratch scratch;  // Reused Ed25519 temporaries (keeps signing off the task stack)
+    SemaphoreHandle_t sign_lock;  // Serializes users of scratch
+    StaticSemaphore_t sign_lock_buf;
 };
 
 solana_wallet_t* solana_wallet_from_keypair(const uint8_t *secret_key, 
@@ -34,6 +42,7 @@ solana_wallet_t* solana_wallet_from_keypair(const uint8_t *secret_key,
     memcpy(wallet->public_key, secret_key + 32, 32);
     
     wallet->rpc = rpc_client;
+    wallet->sign_lock = xSemaphoreCreateMutexStatic(&wallet->sign_lock_buf);
     
     char address[64];
     if (base58_encode(wallet->public_key, 32, address, sizeof(address))) {
@@ -118,67 +127,186 @@ esp_err_t solana_wallet_sign(solana_wallet_t *wallet, const uint8_t *message,
         return ESP_ERR_INVALID_ARG;
     }
     
-    // TweetNaCl signing: creates [signature][message]
-    uint8_t *signed_msg = (uint8_t *)malloc(64 + message_len);
-    if (!signed_msg) {
-        return ESP_ERR_NO_MEM;
-    }
-    
-    unsigned long long signed_len;
-    int result = crypto_sign(signed_msg, &signed_len, message, message_len, wallet->secret_key);
+    // Detached signature: no [signature][message] copy, temporaries live in the wallet.
+    // Concurrent payments sign with the same wallet, so they take turns on them.
+    xSemaphoreTake(wallet->sign_lock, portMAX_DELAY);
+    int result = crypto_sign_detached_scratch(signature_out, message, message_len,
+                                              wallet->secret_key, &wallet->scratch);
+    xSemaphoreGive(wallet->sign_lock);
     
     if (result != 0) {
         ESP_LOGE(TAG, "Signing failed");
-        free(signed_msg);
         return ESP_FAIL;
     }
     
-    // Extract just the signature (first 64 bytes)
-    memcpy(signature_out, signed_msg, 64);
-    free(signed_msg);
-    
     ESP_LOGI(TAG, "Message signed successfully");
     return ESP_OK;
 }
 
-esp_err_t solana_wallet_send_sol(solana_wallet_t *wallet, const char *to_address,
-                                   uint64_t lamports, char *signature_out, size_t max_sig_len) {
-    if (!wallet || !to_address || !signature_out) {
-        return ESP_ERR_INVALID_ARG;
+/**
+ * @brief Sign the transaction and encode it for sendTransaction
+ */
+static esp_err_t sign_and_encode(solana_wallet_t *wallet, solana_tx_t *tx,
+                                 char *tx_base58, size_t max_len,
+                                 char *signature_b58, size_t max_sig_len) {
+    uint8_t message[1024];
+    size_t message_len;
+    esp_err_t err = solana_tx_get_message(tx, message, &message_len, sizeof(message));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to serialize message");
+        return err;
     }
     
-    ESP_LOGI(TAG, "Sending %llu lamports to %s", lamports, to_address);
+    uint8_t signature[64];
+    err = solana_wallet_sign(wallet, message, message_len, signature);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to sign transaction");
+        return err;
+    }
     
-    // Step 1: Get latest blockhash
-    solana_rpc_response_t response;
-    esp_err_t err = solana_rpc_get_latest_blockhash(wallet->rpc, &response);
-    if (err != ESP_OK || !response.success) {
-        ESP_LOGE(TAG, "Failed to get blockhash");
-        solana_rpc_free_response(&response);
-        return ESP_FAIL;
+    err = solana_tx_add_signature(tx, signature);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add signature");
+        return err;
     }
     
-    // Parse blockhash from response
-    cJSON *root = cJSON_Parse(response.data);
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse blockhash response");
-        solana_rpc_free_response(&response);
+    // The first signature is the transaction id, known before the node answers
+    if (!base58_encode(signature, sizeof(signature), signature_b58, max_sig_len)) {
+        ESP_LOGE(TAG, "Failed to encode signature to Base58");
         return ESP_FAIL;
     }
     
-    cJSON *result = cJSON_GetObjectItem(root, "result");
-    cJSON *value = cJSON_GetObjectItem(result, "value");
-    cJSON *blockhash_json = cJSON_GetObjectItem(value, "blockhash");
+    uint8_t serialized_tx[2048];
+    size_t serialized_len;
+    err = solana_tx_serialize(tx, serialized_tx, &serialized_len, sizeof(serialized_tx));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to serialize transaction");
+        return err;
+    }
     
-    if (!cJSON_IsString(blockhash_json)) {
-        ESP_LOGE(TAG, "Invalid blockhash in response");
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
+    if (!base58_encode(serialized_tx, serialized_len, tx_base58, max_len)) {
+        ESP_LOGE(TAG, "Failed to encode transaction to Base58");
         return ESP_FAIL;
     }
     
-    char *blockhash = cJSON_GetStringValue(blockhash_json);
-    ESP_LOGI(TAG, "Latest blockhash: %s", blockhash);
+    ESP_LOGI(TAG, "Transaction encoded (%zu bytes -> %d chars)", 
+             serialized_len, strlen(tx_base58));
+    return ESP_OK;
+}
+
+/**
+ * @brief Map a send failure class to the wallet's return codes
+ */
+static esp_err_t error_from_class(solana_rpc_error_class_t error_class) {
+    switch (error_class) {
+    case SOLANA_RPC_ERROR_TRANSPORT:
+    case SOLANA_RPC_ERROR_RATE_LIMITED:
+        return ESP_ERR_TIMEOUT;
+    case SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS:
+        return ESP_ERR_INVALID_STATE;
+    default:
+        return ESP_FAIL;
+    }
+}
+
+/**
+ * @brief Poll the signature and rebroadcast the signed bytes until it lands
+ * 
+ * Rebroadcasts skip preflight (the first send already simulated these exact
+ * bytes) and ask the node not to retry, so our interval is the only one.
+ */
+static esp_err_t wait_for_commitment(solana_wallet_t *wallet, const char *tx_base58,
+                                     uint64_t last_valid_block_height, int64_t sent_us,
+                                     solana_rpc_commitment_t commitment, uint32_t timeout_ms,
+                                     solana_wallet_send_result_t *result) {
+    const solana_rpc_send_options_t rebroadcast = {
+        .skip_preflight = true,
+        .max_retries = 0,
+    };
+    int64_t next_broadcast_us = sent_us + SOLANA_WALLET_REBROADCAST_MS * 1000LL;
+    bool expired = false;
+    
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(SOLANA_WALLET_STATUS_POLL_MS));
+        
+        solana_rpc_signature_status_t status;
+        if (solana_rpc_get_signature_status(wallet->rpc, result->signature, &status) == ESP_OK) {
+            if (status.commitment > result->commitment) {
+                result->commitment = status.commitment;
+            }
+            if (status.failed) {
+                ESP_LOGE(TAG, "Transaction landed in slot %llu but failed", status.slot);
+                return ESP_FAIL;
+            }
+            if (status.commitment >= commitment) {
+                result->latency_ms = (uint32_t)((esp_timer_get_time() - sent_us) / 1000);
+                ESP_LOGI(TAG, "Transaction reached commitment %d in slot %llu after %lu ms (%d broadcasts)",
+                         status.commitment, status.slot, (unsigned long)result->latency_ms,
+                         result->broadcasts);
+                return ESP_OK;
+            }
+        }
+        
+        if (expired) {
+            // Last look done: with its blockhash expired it can never land
+            ESP_LOGW(TAG, "Blockhash expired before confirmation");
+            result->expired = true;
+            return ESP_ERR_TIMEOUT;
+        }
+        
+        int64_t now_us = esp_timer_get_time();
+        if (timeout_ms && now_us - sent_us >= timeout_ms * 1000LL) {
+            ESP_LOGW(TAG, "Not confirmed within %lu ms", (unsigned long)timeout_ms);
+            return ESP_ERR_TIMEOUT;
+        }
+        if (now_us < next_broadcast_us) {
+            continue;
+        }
+        next_broadcast_us = now_us + SOLANA_WALLET_REBROADCAST_MS * 1000LL;
+        
+        uint64_t height;
+        if (last_valid_block_height &&
+            solana_rpc_get_block_height(wallet->rpc, &height) == ESP_OK &&
+            height > last_valid_block_height) {
+            expired = true;     // Poll once more: it may have landed just before
+            continue;
+        }
+        
+        // Once confirmed, the cluster has it; only the wait for finality remains
+        if (result->commitment < SOLANA_RPC_COMMITMENT_CONFIRMED) {
+            solana_rpc_response_t response;
+            if (solana_rpc_send_transaction_with_options(wallet->rpc, tx_base58, &rebroadcast,
+                                                         &response) == ESP_OK) {
+                solana_rpc_free_response(&response);
+            }
+            result->broadcasts++;
+        }
+    }
+}
+
+/**
+ * @brief Build, sign and submit a transfer, then optionally wait for it to land
+ */
+static esp_err_t send_transfer(solana_wallet_t *wallet, const char *to_address, uint64_t lamports,
+                               solana_rpc_commitment_t commitment, uint32_t timeout_ms,
+                               solana_wallet_send_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    ESP_LOGI(TAG, "Sending %llu lamports to %s", lamports, to_address);
+    
+    // Step 1: Get latest blockhash (transport errors are retried by solana_rpc)
+    uint8_t blockhash[32];
+    uint64_t last_valid_block_height = 0;
+    esp_err_t err = solana_rpc_get_blockhash(wallet->rpc, blockhash, &last_valid_block_height);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to get blockhash");
+        return (err == ESP_FAIL || err == ESP_ERR_INVALID_RESPONSE) ? ESP_FAIL : ESP_ERR_TIMEOUT;
+    }
+    
+    char blockhash_b58[64];
+    if (!base58_encode(blockhash, sizeof(blockhash), blockhash_b58, sizeof(blockhash_b58))) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Latest blockhash: %s", blockhash_b58);
     
     // Step 2: Build transaction
     solana_pubkey_t from_pubkey, to_pubkey;
@@ -187,16 +315,12 @@ esp_err_t solana_wallet_send_sol(solana_wallet_t *wallet, const char *to_address
     err = solana_pubkey_from_base58(to_address, &to_pubkey);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Invalid destination address");
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
         return err;
     }
     
-    solana_tx_t *tx = solana_tx_new(blockhash, &from_pubkey);
+    solana_tx_t *tx = solana_tx_new(blockhash_b58, &from_pubkey);
     if (!tx) {
         ESP_LOGE(TAG, "Failed to create transaction");
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
         return ESP_FAIL;
     }
     
@@ -204,132 +328,111 @@ esp_err_t solana_wallet_send_sol(solana_wallet_t *wallet, const char *to_address
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add transfer instruction");
         solana_tx_destroy(tx);
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
-        return err;
-    }
-    
-    // Step 3: Sign transaction
-    uint8_t message[1024];
-    size_t message_len;
-    err = solana_tx_get_message(tx, message, &message_len, sizeof(message));
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to serialize message");
-        solana_tx_destroy(tx);
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
         return err;
     }
     
-    uint8_t signature[64];
-    err = solana_wallet_sign(wallet, message, message_len, signature);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to sign transaction");
+    char *tx_base58 = bulk_alloc(3000);
+    if (!tx_base58) {
         solana_tx_destroy(tx);
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
-        return err;
-    }
-    
-    err = solana_tx_add_signature(tx, signature);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add signature");
-        solana_tx_destroy(tx);
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
-        return err;
+        return ESP_ERR_NO_MEM;
     }
     
-    // Step 4: Serialize complete transaction
-    uint8_t serialized_tx[2048];
-    size_t serialized_len;
-    err = solana_tx_serialize(tx, serialized_tx, &serialized_len, sizeof(serialized_tx));
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to serialize transaction");
-        solana_tx_destroy(tx);
-        cJSON_Delete(root);
+    // Steps 3-5: Sign, encode and send. An expired blockhash only costs a
+    // fresh blockhash and a new signature; the transaction is not rebuilt.
+    solana_rpc_response_t response = {0};
+    solana_rpc_error_class_t error_class = SOLANA_RPC_ERROR_NONE;
+    int64_t sent_us = 0;
+    for (int attempt = 1; ; attempt++) {
+        error_class = SOLANA_RPC_ERROR_NONE;
+        err = sign_and_encode(wallet, tx, tx_base58, 3000,
+                              result->signature, sizeof(result->signature));
+        if (err != ESP_OK) {
+            break;
+        }
+        
+        sent_us = esp_timer_get_time();
+        err = solana_rpc_send_transaction(wallet->rpc, tx_base58, &response);
+        error_class = solana_rpc_classify_error(err, &response);
+        if (error_class != SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED || attempt >= SOLANA_RPC_MAX_ATTEMPTS) {
+            break;
+        }
+        
+        ESP_LOGW(TAG, "Blockhash expired, re-signing with a fresh one");
         solana_rpc_free_response(&response);
-        return err;
+        err = solana_rpc_get_blockhash(wallet->rpc, blockhash, &last_valid_block_height);
+        if (err == ESP_OK) {
+            err = solana_tx_set_blockhash(tx, blockhash);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to refresh blockhash");
+            error_class = SOLANA_RPC_ERROR_TRANSPORT;
+            break;
+        }
     }
+    solana_tx_destroy(tx);
     
-    // Step 5: Encode to Base58
-    char tx_base58[3000];
-    if (!base58_encode(serialized_tx, serialized_len, tx_base58, sizeof(tx_base58))) {
-        ESP_LOGE(TAG, "Failed to encode transaction to Base58");
-        solana_tx_destroy(tx);
-        cJSON_Delete(root);
-        solana_rpc_free_response(&response);
-        return ESP_FAIL;
+    if (err != ESP_OK && error_class == SOLANA_RPC_ERROR_NONE) {
+        free(tx_base58);
+        return err;     // Local failure (signing, encoding)
     }
     
-    ESP_LOGI(TAG, "Transaction encoded (%zu bytes -> %d chars)", 
-             serialized_len, strlen(tx_base58));
-    
-    // Step 6: Send transaction
-    cJSON_Delete(root);
-    solana_rpc_free_response(&response);
-    
-    err = solana_rpc_send_transaction(wallet->rpc, tx_base58, &response);
-    if (err != ESP_OK || !response.success) {
+    if (error_class != SOLANA_RPC_ERROR_NONE) {
         ESP_LOGE(TAG, "Failed to send transaction");
         if (response.data) {
             ESP_LOGE(TAG, "Response: %s", response.data);
         }
-        solana_tx_destroy(tx);
         solana_rpc_free_response(&response);
-        return ESP_FAIL;
+        free(tx_base58);
+        return error_from_class(error_class);
     }
+    solana_rpc_free_response(&response);
+    result->broadcasts = 1;
+    ESP_LOGI(TAG, "Transaction sent! Signature: %s", result->signature);
     
-    // Parse signature from response
-    ESP_LOGI(TAG, "Raw RPC response: %s", response.data);
-    
-    root = cJSON_Parse(response.data);
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse send response");
-        solana_tx_destroy(tx);
-        solana_rpc_free_response(&response);
-        return ESP_FAIL;
+    // Step 6: Track it until it lands or its blockhash expires
+    if (commitment != SOLANA_RPC_COMMITMENT_NONE) {
+        err = wait_for_commitment(wallet, tx_base58, last_valid_block_height, sent_us,
+                                  commitment, timeout_ms, result);
     }
-    
-    // Check for error in response
-    cJSON *error = cJSON_GetObjectItem(root, "error");
-    if (error) {
-        cJSON *message = cJSON_GetObjectItem(error, "message");
-        if (cJSON_IsString(message)) {
-            ESP_LOGE(TAG, "Solana RPC Error: %s", cJSON_GetStringValue(message));
-        } else {
-            ESP_LOGE(TAG, "Solana RPC returned an error (no message)");
-        }
-        cJSON_Delete(root);
-        solana_tx_destroy(tx);
-        solana_rpc_free_response(&response);
-        return ESP_FAIL;
+    free(tx_base58);
+    return err;
+}
+
+esp_err_t solana_wallet_send_sol(solana_wallet_t *wallet, const char *to_address,
+                                   uint64_t lamports, char *signature_out, size_t max_sig_len) {
+    if (!wallet || !to_address || !signature_out) {
+        return ESP_ERR_INVALID_ARG;
     }
     
-    result = cJSON_GetObjectItem(root, "result");
-    if (cJSON_IsString(result)) {
-        strncpy(signature_out, cJSON_GetStringValue(result), max_sig_len - 1);
+    solana_wallet_send_result_t result;
+    esp_err_t err = send_transfer(wallet, to_address, lamports, SOLANA_RPC_COMMITMENT_NONE, 0, &result);
+    if (err == ESP_OK) {
+        strncpy(signature_out, result.signature, max_sig_len - 1);
         signature_out[max_sig_len - 1] = '\0';
-        ESP_LOGI(TAG, "Transaction sent! Signature: %s", signature_out);
-    } else {
-        ESP_LOGE(TAG, "Invalid signature in response (result is not a string)");
-        cJSON_Delete(root);
-        solana_tx_destroy(tx);
-        solana_rpc_free_response(&response);
-        return ESP_FAIL;
+    }
+    return err;
+}
+
+esp_err_t solana_wallet_send_sol_confirmed(solana_wallet_t *wallet, const char *to_address,
+                                             uint64_t lamports, solana_rpc_commitment_t commitment,
+                                             uint32_t timeout_ms, solana_wallet_send_result_t *result) {
+    if (!result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+    if (!wallet || !to_address || commitment == SOLANA_RPC_COMMITMENT_NONE) {
+        return ESP_ERR_INVALID_ARG;
     }
     
-    cJSON_Delete(root);
-    solana_tx_destroy(tx);
-    solana_rpc_free_response(&response);
-    
-    return ESP_OK;
+    return send_transfer(wallet, to_address, lamports, commitment, timeout_ms, result);
 }
 
 void solana_wallet_destroy(solana_wallet_t *wallet) {
     if (wallet) {
         // Zero out secret key
         memset(wallet->secret_key, 0, 64);
+        memset(&wallet->scratch, 0, sizeof(wallet->scratch));
+        vSemaphoreDelete(wallet->sign_lock);
         free(wallet);
         ESP_LOGI(TAG, "Wallet destroyed");
     }
@@ -5,11 +5,18 @@
 #include "solana_tx.h"
 #include "solana_rpc.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Confirmation tracking knobs for solana_wallet_send_sol_confirmed()
+ */
+#define SOLANA_WALLET_STATUS_POLL_MS  400     // getSignatureStatuses interval (about one slot)
+#define SOLANA_WALLET_REBROADCAST_MS  2000    // Resend interval for the same signed bytes
+
 /**
  * @brief Solana wallet handle
  */
@@ -56,19 +63,61 @@ esp_err_t solana_wallet_get_balance(solana_wallet_t *wallet, uint64_t *balance_o
 /**
  * @brief Send SOL to another address
  * 
+ * If the node reports an expired blockhash, the same transaction is signed
+ * again with a fresh one and resent (up to SOLANA_RPC_MAX_ATTEMPTS times);
+ * transport errors and 429s are retried by solana_rpc.
+ * 
  * @param wallet Wallet handle
  * @param to_address Destination address (Base58)
  * @param lamports Amount in lamports (1 SOL = 1,000,000,000 lamports)
  * @param signature_out Output buffer for transaction signature (Base58)
  * @param max_sig_len Maximum size of signature buffer
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the node could not be reached,
+ *         ESP_ERR_INVALID_STATE if the wallet cannot cover amount and fee,
+ *         ESP_FAIL if the transaction was rejected
  */
 esp_err_t solana_wallet_send_sol(solana_wallet_t *wallet, const char *to_address,
                                    uint64_t lamports, char *signature_out, size_t max_sig_len);
 
+/**
+ * @brief Outcome of a confirmed send
+ */
+typedef struct {
+    char signature[96];                   // Base58 transaction signature
+    solana_rpc_commitment_t commitment;   // Highest commitment observed
+    uint32_t latency_ms;                  // First send until the requested commitment
+    int broadcasts;                       // Times the signed bytes were sent
+    bool expired;                         // Blockhash expired first: it can no longer land
+} solana_wallet_send_result_t;
+
+/**
+ * @brief Send SOL and wait until the transaction reaches a commitment level
+ * 
+ * Signs once, then resends the same bytes every SOLANA_WALLET_REBROADCAST_MS
+ * while polling getSignatureStatuses, until the requested commitment is
+ * reached or the blockhash expires. After expiry it is safe to send again.
+ * 
+ * @param wallet Wallet handle
+ * @param to_address Destination address (Base58)
+ * @param lamports Amount in lamports
+ * @param commitment Level to wait for (PROCESSED, CONFIRMED or FINALIZED)
+ * @param timeout_ms Give up after this long, 0 = until the blockhash expires
+ * @param result Output: signature, commitment reached and latency
+ * @return ESP_OK once confirmed, ESP_ERR_TIMEOUT if the node could not be
+ *         reached or the transaction did not land in time (check result->expired),
+ *         ESP_ERR_INVALID_STATE if the wallet cannot cover amount and fee,
+ *         ESP_FAIL if the transaction was rejected or failed on chain
+ */
+esp_err_t solana_wallet_send_sol_confirmed(solana_wallet_t *wallet, const char *to_address,
+                                             uint64_t lamports, solana_rpc_commitment_t commitment,
+                                             uint32_t timeout_ms, solana_wallet_send_result_t *result);
+
 /**
  * @brief Sign a transaction message
  * 
+ * Uses scratch space held in the wallet, so peak stack stays around 1.3 KB.
+ * Tasks signing with the same wallet at once take turns on it.
+ * 
  * @param wallet Wallet handle
  * @param message Message bytes to sign
  * @param message_len Length of message
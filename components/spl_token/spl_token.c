@@ -1,11 +1,8 @@
 #include "spl_token.h"
 #include "base58.h"
-#include "tweetnacl.h"
+#include "solana_pda.h"
 #include "esp_log.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
-#include "cJSON.h"
-#include "mbedtls/sha256.h"
+#include "solana_rpc.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -46,151 +43,12 @@ const uint8_t USDC_DEVNET_MINT[32] = {
     0xb7, 0x79, 0x06, 0x08, 0xdf, 0x00, 0x2e, 0xa7
 };
 
-
-/**
- * @brief SHA256 hash implementation using mbedtls
- */
-static void sha256(const uint8_t *data, size_t len, uint8_t *hash_out) {
-    mbedtls_sha256_context ctx;
-    mbedtls_sha256_init(&ctx);
-    mbedtls_sha256_starts(&ctx, 0);  // 0 = SHA-256 (not SHA-224)
-    mbedtls_sha256_update(&ctx, data, len);
-    mbedtls_sha256_finish(&ctx, hash_out);
-    mbedtls_sha256_free(&ctx);
-}
-
-/**
- * @brief TweetNaCl's unpackneg function for Ed25519 curve checking
- * 
- * This function unpacks a compressed Ed25519 point and validates if it's on the curve.
- * Returns 0 if on curve (valid point), -1 if off curve (invalid point).
- * Now exposed in tweetnacl.h
- */
-
-/**
- * @brief Check if a 32-byte value is a valid Ed25519 curve point
- * 
- * A valid PDA must NOT be on the Ed25519 curve. This function checks
- * if the bytes represent a point on the curve using TweetNaCl's internal
- * curve validation function.
- * 
- * @param bytes The 32-byte value to check
- * @return true if on curve (invalid PDA), false if off curve (valid PDA)
- */
-static bool is_on_curve(const uint8_t *bytes) {
-    // Use TweetNaCl's unpackneg function to check if point is on curve
-    // unpackneg returns:
-    //   0 = point is on curve (valid Ed25519 point) - NOT a valid PDA
-    //  -1 = point is off curve (invalid Ed25519 point) - this IS a valid PDA
-    
-    gf r[4];  // Temporary storage for unpacked point
-    int result = unpackneg(r, bytes);
-    
-    // result == 0 means on curve (invalid PDA)
-    // result == -1 means off curve (valid PDA)
-    return (result == 0);
-}
-
-/**
- * @brief Find Program Derived Address (PDA)
- * 
- * This is Solana's PDA algorithm for deriving Associated Token Accounts.
- * A valid PDA must be OFF the Ed25519 curve.
- */
-static esp_err_t find_program_address(
-    const uint8_t **seeds,
-    const size_t *seed_lens,
-    size_t num_seeds,
-    const uint8_t *program_id,
-    uint8_t *pda_out,
-    uint8_t *bump_out
-) {
-    // PDA derivation: hash(seeds + [bump] + program_id + "ProgramDerivedAddress")
-    // Try bump values from 255 down to 0 until we find one that's OFF the curve
-    
-    for (int bump = 255; bump >= 0; bump--) {
-        // Build buffer: seeds + bump + program_id + "ProgramDerivedAddress"
-        uint8_t buffer[1024];
-        size_t offset = 0;
-        
-        // Add all seeds
-        for (size_t i = 0; i < num_seeds; i++) {
-            if (offset + seed_lens[i] > sizeof(buffer)) {
-                return ESP_ERR_NO_MEM;
-            }
-            memcpy(buffer + offset, seeds[i], seed_lens[i]);
-            offset += seed_lens[i];
-        }
-        
-        // Add bump
-        buffer[offset++] = (uint8_t)bump;
-        
-        // Add program ID
-        memcpy(buffer + offset, program_id, 32);
-        offset += 32;
-        
-        // Add "ProgramDerivedAddress" marker
-        const char *marker = "ProgramDerivedAddress";
-        size_t marker_len = strlen(marker);
-        memcpy(buffer + offset, marker, marker_len);
-        offset += marker_len;
-        
-        // Hash
-        uint8_t hash[32];
-        sha256(buffer, offset, hash);
-        
-        // Check if this hash is OFF the Ed25519 curve (valid PDA)
-        if (!is_on_curve(hash)) {
-            // Found a valid PDA (off curve)!
-            memcpy(pda_out, hash, 32);
-            if (bump_out) *bump_out = (uint8_t)bump;
-            
-            ESP_LOGD(TAG, "Found PDA at bump %d", bump);
-            return ESP_OK;
-        }
-        
-        // This bump produced an on-curve point, try next bump
-        ESP_LOGV(TAG, "Bump %d is on curve, trying next", bump);
-    }
-    
-    // Exhausted all bumps without finding valid PDA (extremely unlikely)
-    ESP_LOGE(TAG, "Failed to find valid PDA after trying all bumps");
-    return ESP_FAIL;
-}
-
-/**
- * @brief HTTP event handler for RPC response
- */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
-    if (evt->event_id == HTTP_EVENT_ON_DATA) {
-        // Append response data
-        char **response_buffer = (char **)evt->user_data;
-        if (*response_buffer == NULL) {
-            *response_buffer = malloc(evt->data_len + 1);
-            if (*response_buffer) {
-                memcpy(*response_buffer, evt->data, evt->data_len);
-                (*response_buffer)[evt->data_len] = '\0';
-            }
-        } else {
-            size_t old_len = strlen(*response_buffer);
-            char *new_buffer = realloc(*response_buffer, old_len + evt->data_len + 1);
-            if (new_buffer) {
-                *response_buffer = new_buffer;
-                memcpy(*response_buffer + old_len, evt->data, evt->data_len);
-                (*response_buffer)[old_len + evt->data_len] = '\0';
-            }
-        }
-    }
-    return ESP_OK;
-}
-
 esp_err_t spl_token_get_mint_program(
     const char *rpc_url,
     const uint8_t *mint_pubkey,
     uint8_t *program_id_out
 ) {
     esp_err_t err;
-    char *response_buffer = NULL;
     
     // Convert mint pubkey to base58
     char mint_b58[64];
@@ -199,108 +57,33 @@ esp_err_t spl_token_get_mint_program(
         return ESP_FAIL;
     }
     
-    // Build RPC request
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "jsonrpc", "2.0");
-    cJSON_AddNumberToObject(root, "id", 1);
-    cJSON_AddStringToObject(root, "method", "getAccountInfo");
-    
-    cJSON *params = cJSON_CreateArray();
-    cJSON_AddItemToArray(params, cJSON_CreateString(mint_b58));
-    
-    cJSON *config = cJSON_CreateObject();
-    cJSON_AddStringToObject(config, "encoding", "jsonParsed");
-    cJSON_AddItemToArray(params, config);
-    
-    cJSON_AddItemToObject(root, "params", params);
-    
-    char *request_body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    if (!request_body) {
-        ESP_LOGE(TAG, "Failed to create RPC request");
-        return ESP_ERR_NO_MEM;
-    }
-    
-    // Make HTTP request
-    esp_http_client_config_t config_http = {
-        .url = rpc_url,
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_event_handler,
-        .user_data = &response_buffer,
-        .timeout_ms = 10000,
-        .skip_cert_common_name_check = true,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config_http);
+    // Owner and lamports only: dataSlice of 0 bytes instead of the jsonParsed mint
+    solana_rpc_handle_t client = solana_rpc_init(rpc_url);
     if (!client) {
-        free(request_body);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Failed to create RPC client");
+        return ESP_ERR_NO_MEM;
     }
-    
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, request_body, strlen(request_body));
-    
-    err = esp_http_client_perform(client);
-    free(request_body);
+    solana_rpc_account_t account;
+    err = solana_rpc_get_account_info(client, mint_b58, 0, 0, &account);
+    solana_rpc_destroy(client);
     
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        if (response_buffer) free(response_buffer);
+        ESP_LOGE(TAG, "getAccountInfo failed: %s", esp_err_to_name(err));
         return err;
     }
     
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
-    
-    if (status_code != 200 || !response_buffer) {
-        ESP_LOGE(TAG, "RPC request failed with status %d", status_code);
-        if (response_buffer) free(response_buffer);
-        return ESP_FAIL;
+    if (!account.exists) {
+        ESP_LOGE(TAG, "Mint account %s not found", mint_b58);
+        return ESP_ERR_NOT_FOUND;
     }
     
-    // Parse response
-    cJSON *response = cJSON_Parse(response_buffer);
-    free(response_buffer);
-    
-    if (!response) {
-        ESP_LOGE(TAG, "Failed to parse RPC response");
-        return ESP_FAIL;
-    }
-    
-    // Extract owner field: result.value.owner
-    cJSON *result = cJSON_GetObjectItem(response, "result");
-    cJSON *value = result ? cJSON_GetObjectItem(result, "value") : NULL;
-    cJSON *owner = value ? cJSON_GetObjectItem(value, "owner") : NULL;
-    
-    if (!owner || !cJSON_IsString(owner)) {
-        ESP_LOGE(TAG, "Missing or invalid 'owner' field in RPC response");
-        cJSON_Delete(response);
-        return ESP_FAIL;
-    }
-    
-    // Decode owner from base58
-    const char *owner_b58 = owner->valuestring;
-    size_t decoded_len;
-    if (!base58_decode(owner_b58, program_id_out, &decoded_len, 32)) {
-        ESP_LOGE(TAG, "Failed to decode token program ID from base58");
-        cJSON_Delete(response);
-        return ESP_FAIL;
-    }
-    
-    if (decoded_len != 32) {
-        ESP_LOGE(TAG, "Invalid token program ID length: %zu", decoded_len);
-        cJSON_Delete(response);
-        return ESP_FAIL;
-    }
+    memcpy(program_id_out, account.owner, 32);
+    solana_rpc_free_account(&account);
     
     char program_b58[64];
     base58_encode(program_id_out, 32, program_b58, sizeof(program_b58));
     ESP_LOGI(TAG, "Mint %s is owned by program %s", mint_b58, program_b58);
     
-    cJSON_Delete(response);
     return ESP_OK;
 }
 
@@ -318,11 +101,10 @@ esp_err_t spl_token_get_associated_token_address_with_program(
     };
     const size_t seed_lens[] = {32, 32, 32};
     
-    uint8_t bump;
-    return find_program_address(
+    return solana_pda_find(
         seeds, seed_lens, 3,
         SPL_ASSOCIATED_TOKEN_PROGRAM_ID,
-        ata_out, &bump
+        ata_out, NULL
     );
 }
 
@@ -403,20 +185,24 @@ esp_err_t spl_token_create_transfer_transaction(
     esp_err_t err;
     
     // Step 1: Derive ATAs using the correct token program
-    uint8_t source_ata[32];
-    uint8_t dest_ata[32];
-    
-    err = spl_token_get_associated_token_address_with_program(from_wallet, mint, token_program_id, source_ata);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to derive source ATA");
-        return err;
-    }
+    // Source and destination are independent, so derive them side by side
+    const uint8_t *source_seeds[] = { from_wallet, token_program_id, mint };
+    const uint8_t *dest_seeds[] = { to_wallet, token_program_id, mint };
+    const size_t seed_lens[] = {32, 32, 32};
+    solana_pda_request_t atas[2] = {
+        { .seeds = source_seeds, .seed_lens = seed_lens, .num_seeds = 3,
+          .program_id = SPL_ASSOCIATED_TOKEN_PROGRAM_ID },
+        { .seeds = dest_seeds, .seed_lens = seed_lens, .num_seeds = 3,
+          .program_id = SPL_ASSOCIATED_TOKEN_PROGRAM_ID },
+    };
     
-    err = spl_token_get_associated_token_address_with_program(to_wallet, mint, token_program_id, dest_ata);
+    err = solana_pda_find_batch(atas, 2);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to derive dest ATA");
+        ESP_LOGE(TAG, "Failed to derive %s ATA", atas[0].err != ESP_OK ? "source" : "dest");
         return err;
     }
+    const uint8_t *source_ata = atas[0].address;
+    const uint8_t *dest_ata = atas[1].address;
     
     // Step 2: Build instruction data
     uint8_t instruction_data[32];
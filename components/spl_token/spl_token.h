@@ -43,12 +43,13 @@ extern const uint8_t USDC_DEVNET_MINT[32];
  * @brief Get the token program ID that owns a mint
  * 
  * Queries the Solana RPC to get the mint account info and extracts the owner
- * (which is the token program ID - either Token or Token-2022).
+ * (which is the token program ID - either Token or Token-2022). Only owner
+ * and lamports are requested (base64 with an empty dataSlice).
  * 
  * @param rpc_url Solana RPC URL (e.g., "https://api.devnet.solana.com")
  * @param mint_pubkey Token mint public key (32 bytes)
  * @param program_id_out Output: Token program ID (32 bytes)
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the mint does not exist
  */
 esp_err_t spl_token_get_mint_program(
     const char *rpc_url,
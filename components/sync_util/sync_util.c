@@ -0,0 +1,105 @@
+#include "sync_util.h"
+#include "freertos/task.h"
+
+void sync_once(sync_once_t *once, void (*init)(void *arg), void *arg) {
+    for (;;) {
+        bool run = false;
+        portENTER_CRITICAL(&once->lock);
+        if (once->state == 0) {
+            once->state = 1;
+            run = true;
+        }
+        int state = once->state;
+        portEXIT_CRITICAL(&once->lock);
+
+        if (run) {
+            init(arg);
+            portENTER_CRITICAL(&once->lock);
+            once->state = 2;
+            portEXIT_CRITICAL(&once->lock);
+            return;
+        }
+        if (state == 2) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+bool sync_once_done(sync_once_t *once) {
+    portENTER_CRITICAL(&once->lock);
+    bool done = once->state == 2;
+    portEXIT_CRITICAL(&once->lock);
+    return done;
+}
+
+static void mutex_create(void *arg) {
+    sync_mutex_t *mutex = (sync_mutex_t *)arg;
+    mutex->handle = xSemaphoreCreateMutexStatic(&mutex->buf);
+}
+
+void sync_mutex_take(sync_mutex_t *mutex) {
+    sync_once(&mutex->once, mutex_create, mutex);
+    xSemaphoreTake(mutex->handle, portMAX_DELAY);
+}
+
+void sync_mutex_give(sync_mutex_t *mutex) {
+    xSemaphoreGive(mutex->handle);
+}
+
+void sync_flight_init(sync_flight_t *flights, int count, int max_followers) {
+    for (int i = 0; i < count; i++) {
+        flights[i].done_sem = xSemaphoreCreateCountingStatic(max_followers, 0, &flights[i].done_sem_buf);
+    }
+}
+
+int sync_flight_join(sync_flight_t *flights, int count, int max_followers, uint64_t key,
+                     void *follower_arg, bool *follow_out) {
+    int free_slot = -1;
+    *follow_out = false;
+    for (int i = 0; i < count; i++) {
+        sync_flight_t *f = &flights[i];
+        if (f->key == key && !f->done && f->followers < max_followers) {
+            f->follower_arg[f->followers++] = follower_arg;
+            f->refs++;
+            *follow_out = true;
+            return i;
+        }
+        if (free_slot < 0 && f->refs == 0) {
+            free_slot = i;
+        }
+    }
+    if (free_slot >= 0) {
+        sync_flight_t *f = &flights[free_slot];
+        f->key = key;
+        f->done = false;
+        f->followers = 0;
+        f->refs = 1;
+    }
+    return free_slot;
+}
+
+int sync_flight_finish(sync_flight_t *flight) {
+    flight->done = true;
+    int followers = flight->followers;
+    flight->followers = 0;
+    return followers;
+}
+
+void sync_flight_wake(sync_flight_t *flight, int followers) {
+    for (int i = 0; i < followers; i++) {
+        xSemaphoreGive(flight->done_sem);
+    }
+}
+
+void sync_flight_wait(sync_flight_t *flight) {
+    xSemaphoreTake(flight->done_sem, portMAX_DELAY);
+}
+
+bool sync_flight_release(sync_flight_t *flight) {
+    if (--flight->refs > 0) {
+        return false;
+    }
+    flight->key = 0;
+    return true;
+}
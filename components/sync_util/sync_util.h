@@ -0,0 +1,137 @@
+#ifndef SYNC_UTIL_H
+#define SYNC_UTIL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lazily initialized state and single-flight slots, shared by the modules
+// that create their locks on first use and let identical concurrent calls
+// wait for one another.
+
+#define SYNC_FLIGHT_MAX_FOLLOWERS 16    // Upper bound for any table's followers per flight
+
+/**
+ * @brief One-time initialization that concurrent first callers wait for
+ */
+typedef struct {
+    portMUX_TYPE lock;
+    int state;                  // 0 = not started, 1 = in progress, 2 = done
+} sync_once_t;
+
+#define SYNC_ONCE_INIT { portMUX_INITIALIZER_UNLOCKED, 0 }
+
+/**
+ * @brief Mutex created on first use (static storage, never deleted)
+ */
+typedef struct {
+    sync_once_t once;
+    SemaphoreHandle_t handle;
+    StaticSemaphore_t buf;
+} sync_mutex_t;
+
+#define SYNC_MUTEX_INIT { .once = SYNC_ONCE_INIT }
+
+/**
+ * @brief One call that identical concurrent calls wait for
+ *
+ * The leader performs the call; followers block on done_sem until it is
+ * finished. refs counts the callers still using the slot (leader and
+ * followers), and the slot is free again once it drops to zero. Owners keep
+ * per-call results in an array next to their flights, indexed the same way,
+ * and guard both with one spinlock. Everything except sync_flight_wait and
+ * sync_flight_wake is called with that lock held.
+ */
+typedef struct {
+    uint64_t key;               // Hash identifying the call (0 = unused)
+    bool done;                  // Finished: no more followers
+    int followers;              // Waiting on done_sem
+    int refs;
+    void *follower_arg[SYNC_FLIGHT_MAX_FOLLOWERS];  // Given by each follower when joining
+    SemaphoreHandle_t done_sem;
+    StaticSemaphore_t done_sem_buf;
+} sync_flight_t;
+
+/**
+ * @brief Run init exactly once
+ *
+ * Callers arriving while another one runs init wait until it has returned.
+ *
+ * @param once Once flag (SYNC_ONCE_INIT)
+ * @param init Initialization; runs without any lock held
+ * @param arg Passed to init
+ */
+void sync_once(sync_once_t *once, void (*init)(void *arg), void *arg);
+
+/**
+ * @brief Whether init has completed (never waits)
+ */
+bool sync_once_done(sync_once_t *once);
+
+/**
+ * @brief Take a lazily created mutex, creating it on first use
+ */
+void sync_mutex_take(sync_mutex_t *mutex);
+
+/**
+ * @brief Give a mutex taken with sync_mutex_take
+ */
+void sync_mutex_give(sync_mutex_t *mutex);
+
+/**
+ * @brief Create the semaphores of a flight table (from a sync_once init)
+ *
+ * @param flights Flight slots
+ * @param count Number of slots
+ * @param max_followers Followers one flight can take (<= SYNC_FLIGHT_MAX_FOLLOWERS)
+ */
+void sync_flight_init(sync_flight_t *flights, int count, int max_followers);
+
+/**
+ * @brief Join the unfinished flight with this key, or lead a new one (lock held)
+ *
+ * @param flights Flight slots
+ * @param count Number of slots
+ * @param max_followers Followers one flight can take
+ * @param key Call key, not 0
+ * @param follower_arg Stored for the leader if this caller follows
+ * @param follow_out Output: true if the returned flight is someone else's
+ * @return Slot index, or -1 if every slot is busy (perform the call alone)
+ */
+int sync_flight_join(sync_flight_t *flights, int count, int max_followers, uint64_t key,
+                     void *follower_arg, bool *follow_out);
+
+/**
+ * @brief Close a flight to new followers (leader, lock held)
+ *
+ * @return Followers to wake; their follower_arg entries are stable from here
+ */
+int sync_flight_finish(sync_flight_t *flight);
+
+/**
+ * @brief Wake the followers counted by sync_flight_finish (leader, no lock)
+ */
+void sync_flight_wake(sync_flight_t *flight, int followers);
+
+/**
+ * @brief Wait for the leader to finish (follower, no lock)
+ */
+void sync_flight_wait(sync_flight_t *flight);
+
+/**
+ * @brief Drop one reference (lock held)
+ *
+ * @return true if this was the last one and the slot is free again
+ */
+bool sync_flight_release(sync_flight_t *flight);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYNC_UTIL_H
@@ -1,4 +1,10 @@
 #include "tweetnacl.h"
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+#ifdef CONFIG_TWEETNACL_SMALL_STACK
+#include <stdlib.h>
+#endif
 #define FOR(i,n) for (i = 0;i < n;++i)
 #define sv static void
 
@@ -15,7 +21,6 @@ static const u8
 static const gf
   gf0,
   gf1 = {1},
-  _121665 = {0xDB41,1},
   D = {0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070, 0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203},
   D2 = {0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0, 0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406},
   X = {0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c, 0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169},
@@ -34,9 +39,9 @@ static u32 ld32(const u8 *x)
 
 static u64 dl64(const u8 *x)
 {
-  u64 i,u=0;
-  FOR(i,8) u=(u<<8)|x[i];
-  return u;
+  u32 h = (u32) x[0] << 24 | (u32) x[1] << 16 | (u32) x[2] << 8 | x[3];
+  u32 l = (u32) x[4] << 24 | (u32) x[5] << 16 | (u32) x[6] << 8 | x[7];
+  return (u64) h << 32 | l;
 }
 
 sv st32(u8 *x,u32 u)
@@ -68,44 +73,73 @@ int crypto_verify_32(const u8 *x,const u8 *y)
   return vn(x,y,32);
 }
 
+#define QR(a,b,c,d) \
+  b ^= L32(a+d, 7); \
+  c ^= L32(b+a, 9); \
+  d ^= L32(c+b,13); \
+  a ^= L32(d+c,18)
+
 sv core(u8 *out,const u8 *in,const u8 *k,const u8 *c,int h)
 {
-  u32 w[16],x[16],y[16],t[4];
-  int i,j,m;
-
-  FOR(i,4) {
-    x[5*i] = ld32(c+4*i);
-    x[1+i] = ld32(k+4*i);
-    x[6+i] = ld32(in+4*i);
-    x[11+i] = ld32(k+16+4*i);
-  }
-
-  FOR(i,16) y[i] = x[i];
+  u32 x0,x1,x2,x3,x4,x5,x6,x7,x8,x9,x10,x11,x12,x13,x14,x15;
+  u32 j0,j1,j2,j3,j4,j5,j6,j7,j8,j9,j10,j11,j12,j13,j14,j15;
+  int i;
 
-  FOR(i,20) {
-    FOR(j,4) {
-      FOR(m,4) t[m] = x[(5*j+4*m)%16];
-      t[1] ^= L32(t[0]+t[3], 7);
-      t[2] ^= L32(t[1]+t[0], 9);
-      t[3] ^= L32(t[2]+t[1],13);
-      t[0] ^= L32(t[3]+t[2],18);
-      FOR(m,4) w[4*j+(j+m)%4] = t[m];
-    }
-    FOR(m,16) x[m] = w[m];
+  j0 = x0 = ld32(c);
+  j1 = x1 = ld32(k);
+  j2 = x2 = ld32(k+4);
+  j3 = x3 = ld32(k+8);
+  j4 = x4 = ld32(k+12);
+  j5 = x5 = ld32(c+4);
+  j6 = x6 = ld32(in);
+  j7 = x7 = ld32(in+4);
+  j8 = x8 = ld32(in+8);
+  j9 = x9 = ld32(in+12);
+  j10 = x10 = ld32(c+8);
+  j11 = x11 = ld32(k+16);
+  j12 = x12 = ld32(k+20);
+  j13 = x13 = ld32(k+24);
+  j14 = x14 = ld32(k+28);
+  j15 = x15 = ld32(c+12);
+
+  for (i = 0;i < 20;i += 2) {
+    QR(x0,x4,x8,x12);
+    QR(x5,x9,x13,x1);
+    QR(x10,x14,x2,x6);
+    QR(x15,x3,x7,x11);
+    QR(x0,x1,x2,x3);
+    QR(x5,x6,x7,x4);
+    QR(x10,x11,x8,x9);
+    QR(x15,x12,x13,x14);
   }
 
   if (h) {
-    FOR(i,16) x[i] += y[i];
-    FOR(i,4) {
-      x[5*i] -= ld32(c+4*i);
-      x[6+i] -= ld32(in+4*i);
-    }
-    FOR(i,4) {
-      st32(out+4*i,x[5*i]);
-      st32(out+16+4*i,x[6+i]);
-    }
-  } else
-    FOR(i,16) st32(out + 4 * i,x[i] + y[i]);
+    st32(out,x0);
+    st32(out+4,x5);
+    st32(out+8,x10);
+    st32(out+12,x15);
+    st32(out+16,x6);
+    st32(out+20,x7);
+    st32(out+24,x8);
+    st32(out+28,x9);
+  } else {
+    st32(out,x0+j0);
+    st32(out+4,x1+j1);
+    st32(out+8,x2+j2);
+    st32(out+12,x3+j3);
+    st32(out+16,x4+j4);
+    st32(out+20,x5+j5);
+    st32(out+24,x6+j6);
+    st32(out+28,x7+j7);
+    st32(out+32,x8+j8);
+    st32(out+36,x9+j9);
+    st32(out+40,x10+j10);
+    st32(out+44,x11+j11);
+    st32(out+48,x12+j12);
+    st32(out+52,x13+j13);
+    st32(out+56,x14+j14);
+    st32(out+60,x15+j15);
+  }
 }
 
 int crypto_core_salsa20(u8 *out,const u8 *in,const u8 *k,const u8 *c)
@@ -168,70 +202,97 @@ int crypto_stream_xor(u8 *c,const u8 *m,u64 d,const u8 *n,const u8 *k)
   return crypto_stream_salsa20_xor(c,m,d,n+16,s);
 }
 
-sv add1305(u32 *h,const u32 *c)
-{
-  u32 j,u = 0;
-  FOR(j,17) {
-    u += h[j] + c[j];
-    h[j] = u & 255;
-    u >>= 8;
-  }
-}
-
-static const u32 minusp[17] = {
-  5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 252
-} ;
-
+/* Poly1305 with five 26-bit limbs (poly1305-donna, 32-bit) */
 int crypto_onetimeauth(u8 *out,const u8 *m,u64 n,const u8 *k)
 {
-  u32 s,i,j,u,x[17],r[17],h[17],c[17],g[17];
+  u32 r0,r1,r2,r3,r4,s1,s2,s3,s4;
+  u32 h0 = 0,h1 = 0,h2 = 0,h3 = 0,h4 = 0;
+  u32 g0,g1,g2,g3,g4,c,mask,hibit;
+  u64 d0,d1,d2,d3,d4,f;
+  u8 b[16];
+  const u8 *p;
+  int i;
 
-  FOR(j,17) r[j]=h[j]=0;
-  FOR(j,16) r[j]=k[j];
-  r[3]&=15;
-  r[4]&=252;
-  r[7]&=15;
-  r[8]&=252;
-  r[11]&=15;
-  r[12]&=252;
-  r[15]&=15;
+  r0 = ld32(k) & 0x3ffffff;
+  r1 = (ld32(k+3) >> 2) & 0x3ffff03;
+  r2 = (ld32(k+6) >> 4) & 0x3ffc0ff;
+  r3 = (ld32(k+9) >> 6) & 0x3f03fff;
+  r4 = (ld32(k+12) >> 8) & 0x00fffff;
+  s1 = r1 * 5;
+  s2 = r2 * 5;
+  s3 = r3 * 5;
+  s4 = r4 * 5;
 
   while (n > 0) {
-    FOR(j,17) c[j] = 0;
-    for (j = 0;(j < 16) && (j < n);++j) c[j] = m[j];
-    c[j] = 1;
-    m += j; n -= j;
-    add1305(h,c);
-    FOR(i,17) {
-      x[i] = 0;
-      FOR(j,17) x[i] += h[j] * ((j <= i) ? r[i - j] : 320 * r[i + 17 - j]);
-    }
-    FOR(i,17) h[i] = x[i];
-    u = 0;
-    FOR(j,16) {
-      u += h[j];
-      h[j] = u & 255;
-      u >>= 8;
+    if (n >= 16) {
+      p = m;
+      hibit = 1 << 24;
+      m += 16; n -= 16;
+    } else {
+      FOR(i,16) b[i] = (u64) i < n ? m[i] : 0;
+      b[n] = 1;
+      p = b;
+      hibit = 0;
+      n = 0;
     }
-    u += h[16]; h[16] = u & 3;
-    u = 5 * (u >> 2);
-    FOR(j,16) {
-      u += h[j];
-      h[j] = u & 255;
-      u >>= 8;
-    }
-    u += h[16]; h[16] = u;
-  }
 
-  FOR(j,17) g[j] = h[j];
-  add1305(h,minusp);
-  s = -(h[16] >> 7);
-  FOR(j,17) h[j] ^= s & (g[j] ^ h[j]);
+    h0 += ld32(p) & 0x3ffffff;
+    h1 += (ld32(p+3) >> 2) & 0x3ffffff;
+    h2 += (ld32(p+6) >> 4) & 0x3ffffff;
+    h3 += (ld32(p+9) >> 6) & 0x3ffffff;
+    h4 += (ld32(p+12) >> 8) | hibit;
+
+    d0 = (u64)h0*r0 + (u64)h1*s4 + (u64)h2*s3 + (u64)h3*s2 + (u64)h4*s1;
+    d1 = (u64)h0*r1 + (u64)h1*r0 + (u64)h2*s4 + (u64)h3*s3 + (u64)h4*s2;
+    d2 = (u64)h0*r2 + (u64)h1*r1 + (u64)h2*r0 + (u64)h3*s4 + (u64)h4*s3;
+    d3 = (u64)h0*r3 + (u64)h1*r2 + (u64)h2*r1 + (u64)h3*r0 + (u64)h4*s4;
+    d4 = (u64)h0*r4 + (u64)h1*r3 + (u64)h2*r2 + (u64)h3*r1 + (u64)h4*r0;
+
+    c = d0 >> 26; h0 = d0 & 0x3ffffff;
+    d1 += c; c = d1 >> 26; h1 = d1 & 0x3ffffff;
+    d2 += c; c = d2 >> 26; h2 = d2 & 0x3ffffff;
+    d3 += c; c = d3 >> 26; h3 = d3 & 0x3ffffff;
+    d4 += c; c = d4 >> 26; h4 = d4 & 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+  }
 
-  FOR(j,16) c[j] = k[j + 16];
-  c[16] = 0;
-  add1305(h,c);
-  FOR(j,16) out[j] = h[j];
+  c = h1 >> 26; h1 &= 0x3ffffff;
+  h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+  h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+  h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+  h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+  h1 += c;
+
+  /* h - p, selected in constant time if h >= p */
+  g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+  g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+  g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+  g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+  g4 = (h4 + c - (1 << 26)) & 0xffffffff;
+
+  mask = ((g4 >> 31) & 1) - 1;
+  g0 &= mask;
+  g1 &= mask;
+  g2 &= mask;
+  g3 &= mask;
+  g4 &= mask;
+  mask = ~mask;
+  h0 = (h0 & mask) | g0;
+  h1 = (h1 & mask) | g1;
+  h2 = (h2 & mask) | g2;
+  h3 = (h3 & mask) | g3;
+  h4 = (h4 & mask) | g4;
+
+  h0 = (h0 | (h1 << 26)) & 0xffffffff;
+  h1 = ((h1 >> 6) | (h2 << 20)) & 0xffffffff;
+  h2 = ((h2 >> 12) | (h3 << 14)) & 0xffffffff;
+  h3 = ((h3 >> 18) | (h4 << 8)) & 0xffffffff;
+
+  f = (u64)h0 + ld32(k+16); st32(out,f);
+  f = (u64)h1 + ld32(k+20) + (f >> 32); st32(out+4,f);
+  f = (u64)h2 + ld32(k+24) + (f >> 32); st32(out+8,f);
+  f = (u64)h3 + ld32(k+28) + (f >> 32); st32(out+12,f);
   return 0;
 }
 
@@ -391,54 +452,224 @@ sv pow2523(gf o,const gf i)
   FOR(a,16) o[a]=c[a];
 }
 
+/* X25519 field elements: ten signed limbs alternating 26 and 25 bits */
+typedef int i32;
+typedef i32 fe[10];
+
+sv fe_carry(fe h,i64 t[10])
+{
+  i64 c;
+  int i;
+  c = (t[0] + (1<<25)) >> 26; t[1] += c; t[0] -= c << 26;
+  c = (t[4] + (1<<25)) >> 26; t[5] += c; t[4] -= c << 26;
+  c = (t[1] + (1<<24)) >> 25; t[2] += c; t[1] -= c << 25;
+  c = (t[5] + (1<<24)) >> 25; t[6] += c; t[5] -= c << 25;
+  c = (t[2] + (1<<25)) >> 26; t[3] += c; t[2] -= c << 26;
+  c = (t[6] + (1<<25)) >> 26; t[7] += c; t[6] -= c << 26;
+  c = (t[3] + (1<<24)) >> 25; t[4] += c; t[3] -= c << 25;
+  c = (t[7] + (1<<24)) >> 25; t[8] += c; t[7] -= c << 25;
+  c = (t[4] + (1<<25)) >> 26; t[5] += c; t[4] -= c << 26;
+  c = (t[8] + (1<<25)) >> 26; t[9] += c; t[8] -= c << 26;
+  c = (t[9] + (1<<24)) >> 25; t[0] += c * 19; t[9] -= c << 25;
+  c = (t[0] + (1<<25)) >> 26; t[1] += c; t[0] -= c << 26;
+  FOR(i,10) h[i] = t[i];
+}
+
+sv fe_frombytes(fe h,const u8 *s)
+{
+  i64 t[10],a = 0;
+  int i,j = 0,n = 0;
+  FOR(i,10) {
+    int w = 26 - (i & 1);
+    while (n < w && j < 32) { a |= (i64) s[j++] << n; n += 8; }
+    t[i] = a & ((1 << w) - 1);
+    a >>= w;
+    n -= w;
+  }
+  t[9] &= (1 << 25) - 1;
+  fe_carry(h,t);
+}
+
+sv fe_tobytes(u8 *s,const fe f)
+{
+  i32 h[10],q;
+  u64 a = 0;
+  int i,j = 0,n = 0;
+  FOR(i,10) h[i] = f[i];
+  q = (19 * h[9] + (1 << 24)) >> 25;
+  FOR(i,10) q = (h[i] + q) >> (26 - (i & 1));
+  h[0] += 19 * q;
+  FOR(i,9) {
+    q = h[i] >> (26 - (i & 1));
+    h[i+1] += q;
+    h[i] -= q << (26 - (i & 1));
+  }
+  h[9] &= (1 << 25) - 1;
+  FOR(i,10) {
+    a |= (u64) h[i] << n;
+    n += 26 - (i & 1);
+    while (n >= 8 && j < 32) { s[j++] = a; a >>= 8; n -= 8; }
+  }
+  s[31] = a;
+}
+
+sv fe_add(fe h,const fe f,const fe g)
+{
+  int i;
+  FOR(i,10) h[i] = f[i] + g[i];
+}
+
+sv fe_sub(fe h,const fe f,const fe g)
+{
+  int i;
+  FOR(i,10) h[i] = f[i] - g[i];
+}
+
+sv fe_cswap(fe f,fe g,i32 b)
+{
+  i32 i,t;
+  b = -b;
+  FOR(i,10) {
+    t = b & (f[i] ^ g[i]);
+    f[i] ^= t;
+    g[i] ^= t;
+  }
+}
+
+sv fe_mul(fe h,const fe f,const fe g)
+{
+  i32 f0 = f[0],f1 = f[1],f2 = f[2],f3 = f[3],f4 = f[4],f5 = f[5],f6 = f[6],f7 = f[7],f8 = f[8],f9 = f[9];
+  i32 g0 = g[0],g1 = g[1],g2 = g[2],g3 = g[3],g4 = g[4],g5 = g[5],g6 = g[6],g7 = g[7],g8 = g[8],g9 = g[9];
+  i32 g1_19 = 19 * g1,g2_19 = 19 * g2,g3_19 = 19 * g3,g4_19 = 19 * g4,g5_19 = 19 * g5,g6_19 = 19 * g6,g7_19 = 19 * g7,g8_19 = 19 * g8,g9_19 = 19 * g9;
+  i32 f1_2 = 2 * f1,f3_2 = 2 * f3,f5_2 = 2 * f5,f7_2 = 2 * f7,f9_2 = 2 * f9;
+  i64 t[10];
+  t[0] = f0*(i64)g0 + f1_2*(i64)g9_19 + f2*(i64)g8_19 + f3_2*(i64)g7_19 + f4*(i64)g6_19 + f5_2*(i64)g5_19 + f6*(i64)g4_19 + f7_2*(i64)g3_19 + f8*(i64)g2_19 + f9_2*(i64)g1_19;
+  t[1] = f0*(i64)g1 + f1*(i64)g0 + f2*(i64)g9_19 + f3*(i64)g8_19 + f4*(i64)g7_19 + f5*(i64)g6_19 + f6*(i64)g5_19 + f7*(i64)g4_19 + f8*(i64)g3_19 + f9*(i64)g2_19;
+  t[2] = f0*(i64)g2 + f1_2*(i64)g1 + f2*(i64)g0 + f3_2*(i64)g9_19 + f4*(i64)g8_19 + f5_2*(i64)g7_19 + f6*(i64)g6_19 + f7_2*(i64)g5_19 + f8*(i64)g4_19 + f9_2*(i64)g3_19;
+  t[3] = f0*(i64)g3 + f1*(i64)g2 + f2*(i64)g1 + f3*(i64)g0 + f4*(i64)g9_19 + f5*(i64)g8_19 + f6*(i64)g7_19 + f7*(i64)g6_19 + f8*(i64)g5_19 + f9*(i64)g4_19;
+  t[4] = f0*(i64)g4 + f1_2*(i64)g3 + f2*(i64)g2 + f3_2*(i64)g1 + f4*(i64)g0 + f5_2*(i64)g9_19 + f6*(i64)g8_19 + f7_2*(i64)g7_19 + f8*(i64)g6_19 + f9_2*(i64)g5_19;
+  t[5] = f0*(i64)g5 + f1*(i64)g4 + f2*(i64)g3 + f3*(i64)g2 + f4*(i64)g1 + f5*(i64)g0 + f6*(i64)g9_19 + f7*(i64)g8_19 + f8*(i64)g7_19 + f9*(i64)g6_19;
+  t[6] = f0*(i64)g6 + f1_2*(i64)g5 + f2*(i64)g4 + f3_2*(i64)g3 + f4*(i64)g2 + f5_2*(i64)g1 + f6*(i64)g0 + f7_2*(i64)g9_19 + f8*(i64)g8_19 + f9_2*(i64)g7_19;
+  t[7] = f0*(i64)g7 + f1*(i64)g6 + f2*(i64)g5 + f3*(i64)g4 + f4*(i64)g3 + f5*(i64)g2 + f6*(i64)g1 + f7*(i64)g0 + f8*(i64)g9_19 + f9*(i64)g8_19;
+  t[8] = f0*(i64)g8 + f1_2*(i64)g7 + f2*(i64)g6 + f3_2*(i64)g5 + f4*(i64)g4 + f5_2*(i64)g3 + f6*(i64)g2 + f7_2*(i64)g1 + f8*(i64)g0 + f9_2*(i64)g9_19;
+  t[9] = f0*(i64)g9 + f1*(i64)g8 + f2*(i64)g7 + f3*(i64)g6 + f4*(i64)g5 + f5*(i64)g4 + f6*(i64)g3 + f7*(i64)g2 + f8*(i64)g1 + f9*(i64)g0;
+  fe_carry(h,t);
+}
+
+sv fe_sq(fe h,const fe f)
+{
+  i32 f0 = f[0],f1 = f[1],f2 = f[2],f3 = f[3],f4 = f[4],f5 = f[5],f6 = f[6],f7 = f[7],f8 = f[8],f9 = f[9];
+  i32 f0_2 = 2 * f0,f1_2 = 2 * f1,f2_2 = 2 * f2,f3_2 = 2 * f3,f4_2 = 2 * f4,f5_2 = 2 * f5,f6_2 = 2 * f6,f7_2 = 2 * f7,f8_2 = 2 * f8,f9_2 = 2 * f9;
+  i32 f5_19 = 19 * f5,f6_19 = 19 * f6,f7_19 = 19 * f7,f8_19 = 19 * f8,f9_19 = 19 * f9;
+  i32 f7_38 = 38 * f7,f9_38 = 38 * f9;
+  i64 t[10];
+  t[0] = f0*(i64)f0 + f1_2*(i64)f9_38 + f2_2*(i64)f8_19 + f3_2*(i64)f7_38 + f4_2*(i64)f6_19 + f5_2*(i64)f5_19;
+  t[1] = f0_2*(i64)f1 + f2_2*(i64)f9_19 + f3_2*(i64)f8_19 + f4_2*(i64)f7_19 + f5_2*(i64)f6_19;
+  t[2] = f0_2*(i64)f2 + f1_2*(i64)f1 + f3_2*(i64)f9_38 + f4_2*(i64)f8_19 + f5_2*(i64)f7_38 + f6*(i64)f6_19;
+  t[3] = f0_2*(i64)f3 + f1_2*(i64)f2 + f4_2*(i64)f9_19 + f5_2*(i64)f8_19 + f6_2*(i64)f7_19;
+  t[4] = f0_2*(i64)f4 + f1_2*(i64)f3_2 + f2*(i64)f2 + f5_2*(i64)f9_38 + f6_2*(i64)f8_19 + f7_2*(i64)f7_19;
+  t[5] = f0_2*(i64)f5 + f1_2*(i64)f4 + f2_2*(i64)f3 + f6_2*(i64)f9_19 + f7_2*(i64)f8_19;
+  t[6] = f0_2*(i64)f6 + f1_2*(i64)f5_2 + f2_2*(i64)f4 + f3_2*(i64)f3 + f7_2*(i64)f9_38 + f8*(i64)f8_19;
+  t[7] = f0_2*(i64)f7 + f1_2*(i64)f6 + f2_2*(i64)f5 + f3_2*(i64)f4 + f8_2*(i64)f9_19;
+  t[8] = f0_2*(i64)f8 + f1_2*(i64)f7_2 + f2_2*(i64)f6 + f3_2*(i64)f5_2 + f4*(i64)f4 + f9_2*(i64)f9_19;
+  t[9] = f0_2*(i64)f9 + f1_2*(i64)f8 + f2_2*(i64)f7 + f3_2*(i64)f6 + f4_2*(i64)f5;
+  fe_carry(h,t);
+}
+
+
+sv fe_mul121666(fe h,const fe f)
+{
+  i64 t[10];
+  int i;
+  FOR(i,10) t[i] = f[i] * (i64) 121666;
+  fe_carry(h,t);
+}
+
+sv fe_sqn(fe h,const fe f,int n)
+{
+  fe_sq(h,f);
+  while (--n > 0) fe_sq(h,h);
+}
+
+/* z^(p-2) by the standard 254-squaring, 11-multiply addition chain */
+sv fe_invert(fe o,const fe z)
+{
+  fe t0,t1,t2,t3;
+  fe_sq(t0,z);
+  fe_sqn(t1,t0,2);
+  fe_mul(t1,z,t1);
+  fe_mul(t0,t0,t1);
+  fe_sq(t2,t0);
+  fe_mul(t1,t1,t2);
+  fe_sqn(t2,t1,5);
+  fe_mul(t1,t2,t1);
+  fe_sqn(t2,t1,10);
+  fe_mul(t2,t2,t1);
+  fe_sqn(t3,t2,20);
+  fe_mul(t2,t3,t2);
+  fe_sqn(t2,t2,10);
+  fe_mul(t1,t2,t1);
+  fe_sqn(t2,t1,50);
+  fe_mul(t2,t2,t1);
+  fe_sqn(t3,t2,100);
+  fe_mul(t2,t3,t2);
+  fe_sqn(t2,t2,50);
+  fe_mul(t1,t2,t1);
+  fe_sqn(t1,t1,5);
+  fe_mul(o,t1,t0);
+}
+
+/* one merged differential add-and-double step: (x2:z2) <- 2(x2:z2), (x3:z3) <- (x2:z2)+(x3:z3) */
+sv ladderstep(fe x2,fe z2,fe x3,fe z3,const fe x1)
+{
+  fe t0,t1;
+  fe_sub(t0,x3,z3);
+  fe_sub(t1,x2,z2);
+  fe_add(x2,x2,z2);
+  fe_add(z2,x3,z3);
+  fe_mul(z3,t0,x2);
+  fe_mul(z2,z2,t1);
+  fe_sq(t0,t1);
+  fe_sq(t1,x2);
+  fe_add(x3,z3,z2);
+  fe_sub(z2,z3,z2);
+  fe_mul(x2,t1,t0);
+  fe_sub(t1,t1,t0);
+  fe_sq(z2,z2);
+  fe_mul121666(z3,t1);
+  fe_sq(x3,x3);
+  fe_add(t0,t0,z3);
+  fe_mul(z3,x1,z2);
+  fe_mul(z2,t1,t0);
+}
+
 int crypto_scalarmult(u8 *q,const u8 *n,const u8 *p)
 {
   u8 z[32];
-  i64 x[80],r,i;
-  gf a,b,c,d,e,f;
+  fe x1,x2,z2,x3,z3;
+  i32 i,b,s = 0;
   FOR(i,31) z[i]=n[i];
   z[31]=(n[31]&127)|64;
   z[0]&=248;
-  unpack25519(x,p);
-  FOR(i,16) {
-    b[i]=x[i];
-    d[i]=a[i]=c[i]=0;
+  fe_frombytes(x1,p);
+  FOR(i,10) {
+    x3[i]=x1[i];
+    x2[i]=z2[i]=z3[i]=0;
   }
-  a[0]=d[0]=1;
+  x2[0]=z3[0]=1;
   for(i=254;i>=0;--i) {
-    r=(z[i>>3]>>(i&7))&1;
-    sel25519(a,b,r);
-    sel25519(c,d,r);
-    A(e,a,c);
-    Z(a,a,c);
-    A(c,b,d);
-    Z(b,b,d);
-    S(d,e);
-    S(f,a);
-    M(a,c,a);
-    M(c,b,e);
-    A(e,a,c);
-    Z(a,a,c);
-    S(b,a);
-    Z(c,d,f);
-    M(a,c,_121665);
-    A(a,a,d);
-    M(c,c,a);
-    M(a,d,f);
-    M(d,b,x);
-    S(b,e);
-    sel25519(a,b,r);
-    sel25519(c,d,r);
+    b=(z[i>>3]>>(i&7))&1;
+    s^=b;
+    fe_cswap(x2,x3,s);
+    fe_cswap(z2,z3,s);
+    s=b;
+    ladderstep(x2,z2,x3,z3,x1);
   }
-  FOR(i,16) {
-    x[i+16]=a[i];
-    x[i+32]=c[i];
-    x[i+48]=b[i];
-    x[i+64]=d[i];
-  }
-  inv25519(x+32,x+32);
-  M(x+16,x+16,x+32);
-  pack25519(q,x+16);
+  fe_cswap(x2,x3,s);
+  fe_cswap(z2,z3,s);
+  fe_invert(z2,z2);
+  fe_mul(x2,x2,z2);
+  fe_tobytes(q,x2);
   return 0;
 }
 
@@ -485,8 +716,8 @@ int crypto_box_open(u8 *m,const u8 *c,u64 d,const u8 *n,const u8 *y,const u8 *x)
 }
 
 static u64 R(u64 x,int c) { return (x >> c) | (x << (64 - c)); }
-static u64 Ch(u64 x,u64 y,u64 z) { return (x & y) ^ (~x & z); }
-static u64 Maj(u64 x,u64 y,u64 z) { return (x & y) ^ (x & z) ^ (y & z); }
+static u64 Ch(u64 x,u64 y,u64 z) { return ((y ^ z) & x) ^ z; }
+static u64 Maj(u64 x,u64 y,u64 z) { return (x & y) | (z & (x | y)); }
 static u64 Sigma0(u64 x) { return R(x,28) ^ R(x,34) ^ R(x,39); }
 static u64 Sigma1(u64 x) { return R(x,14) ^ R(x,18) ^ R(x,41); }
 static u64 sigma0(u64 x) { return R(x, 1) ^ R(x, 8) ^ (x >> 7); }
@@ -516,28 +747,42 @@ static const u64 K[80] =
   0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
 };
 
+#define RND(a,b,c,d,e,f,g,h,i) \
+  h += Sigma1(e) + Ch(e,f,g) + k[i] + w[i]; \
+  d += h; \
+  h += Sigma0(a) + Maj(a,b,c);
+
+#define RND8(i) \
+  RND(a,b,c,d,e,f,g,h,i)   RND(h,a,b,c,d,e,f,g,i+1) \
+  RND(g,h,a,b,c,d,e,f,i+2) RND(f,g,h,a,b,c,d,e,i+3) \
+  RND(e,f,g,h,a,b,c,d,i+4) RND(d,e,f,g,h,a,b,c,i+5) \
+  RND(c,d,e,f,g,h,a,b,i+6) RND(b,c,d,e,f,g,h,a,i+7)
+
+#define MSG(i) w[i] += sigma1(w[(i+14)&15]) + w[(i+9)&15] + sigma0(w[(i+1)&15]);
+
+#define MSG8(i) MSG(i) MSG(i+1) MSG(i+2) MSG(i+3) MSG(i+4) MSG(i+5) MSG(i+6) MSG(i+7)
+
 int crypto_hashblocks(u8 *x,const u8 *m,u64 n)
 {
-  u64 z[8],b[8],a[8],w[16],t;
-  int i,j;
+  u64 z[8],w[16],a,b,c,d,e,f,g,h;
+  const u64 *k;
+  int i;
 
-  FOR(i,8) z[i] = a[i] = dl64(x + 8 * i);
+  FOR(i,8) z[i] = dl64(x + 8 * i);
 
   while (n >= 128) {
     FOR(i,16) w[i] = dl64(m + 8 * i);
+    a = z[0]; b = z[1]; c = z[2]; d = z[3];
+    e = z[4]; f = z[5]; g = z[6]; h = z[7];
 
-    FOR(i,80) {
-      FOR(j,8) b[j] = a[j];
-      t = a[7] + Sigma1(a[4]) + Ch(a[4],a[5],a[6]) + K[i] + w[i%16];
-      b[7] = t + Sigma0(a[0]) + Maj(a[0],a[1],a[2]);
-      b[3] += t;
-      FOR(j,8) a[(j+1)%8] = b[j];
-      if (i%16 == 15)
-	FOR(j,16)
-	  w[j] += w[(j+9)%16] + sigma0(w[(j+1)%16]) + sigma1(w[(j+14)%16]);
+    for (k = K;;k += 16) {
+      RND8(0) RND8(8)
+      if (k == K + 64) break;
+      MSG8(0) MSG8(8)
     }
 
-    FOR(i,8) { a[i] += z[i]; z[i] = a[i]; }
+    z[0] += a; z[1] += b; z[2] += c; z[3] += d;
+    z[4] += e; z[5] += f; z[6] += g; z[7] += h;
 
     m += 128;
     n -= 128;
@@ -585,9 +830,53 @@ int crypto_hash(u8 *out,const u8 *m,u64 n)
   return 0;
 }
 
+void crypto_hash_init(crypto_hash_state *s)
+{
+  int i;
+  FOR(i,64) s->h[i] = iv[i];
+  s->n = 0;
+}
+
+void crypto_hash_update(crypto_hash_state *s,const u8 *m,u64 n)
+{
+  u64 i,r = s->n & 127,k;
+
+  s->n += n;
+  if (r) {
+    k = 128 - r;
+    if (k > n) k = n;
+    FOR(i,k) s->x[r+i] = m[i];
+    m += k;
+    n -= k;
+    if (r + k < 128) return;
+    crypto_hashblocks(s->h,s->x,128);
+  }
+  k = n & ~(u64)127;
+  if (k) crypto_hashblocks(s->h,m,k);
+  FOR(i,n-k) s->x[i] = m[k+i];
+}
+
+void crypto_hash_final(crypto_hash_state *s,u8 *out)
+{
+  u64 i,n = s->n & 127;
+
+  s->x[n++] = 128;
+  if (n > 112) {
+    for (i = n;i < 128;++i) s->x[i] = 0;
+    crypto_hashblocks(s->h,s->x,128);
+    n = 0;
+  }
+  for (i = n;i < 112;++i) s->x[i] = 0;
+  ts64(s->x+112,s->n >> 61);
+  ts64(s->x+120,s->n<<3);
+  crypto_hashblocks(s->h,s->x,128);
+
+  FOR(i,64) out[i] = s->h[i];
+}
+
 sv add(gf p[4],gf q[4])
 {
-  gf a,b,c,d,t,e,f,g,h;
+  gf a,b,c,d,t;
   
   Z(a, p[1], p[0]);
   Z(t, q[1], q[0]);
@@ -599,15 +888,15 @@ sv add(gf p[4],gf q[4])
   M(c, c, D2);
   M(d, p[2], q[2]);
   A(d, d, d);
-  Z(e, b, a);
-  Z(f, d, c);
-  A(g, d, c);
-  A(h, b, a);
-
-  M(p[0], e, f);
-  M(p[1], h, g);
-  M(p[2], g, f);
-  M(p[3], e, h);
+  Z(t, b, a);
+  A(b, b, a);
+  Z(a, d, c);
+  A(d, d, c);
+
+  M(p[0], t, a);
+  M(p[1], b, d);
+  M(p[2], d, a);
+  M(p[3], t, b);
 }
 
 sv cswap(gf p[4],gf q[4],u8 b)
@@ -643,23 +932,28 @@ sv scalarmult(gf p[4],gf q[4],const u8 *s)
   }
 }
 
-sv scalarbase(gf p[4],const u8 *s)
+sv setbase(gf q[4])
 {
-  gf q[4];
   set25519(q[0],X);
   set25519(q[1],Y);
   set25519(q[2],gf1);
   M(q[3],X,Y);
+}
+
+sv scalarbase(gf p[4],const u8 *s)
+{
+  gf q[4];
+  setbase(q);
   scalarmult(p,q,s);
 }
 
-int crypto_sign_keypair(u8 *pk, u8 *sk)
+int crypto_sign_seed_keypair(u8 *pk, u8 *sk, const u8 *seed)
 {
   u8 d[64];
   gf p[4];
   int i;
 
-  randombytes(sk, 32);
+  FOR(i,32) sk[i] = seed[i];
   crypto_hash(d, sk, 32);
   d[0] &= 248;
   d[31] &= 127;
@@ -672,6 +966,74 @@ int crypto_sign_keypair(u8 *pk, u8 *sk)
   return 0;
 }
 
+int crypto_sign_keypair(u8 *pk, u8 *sk)
+{
+  randombytes(sk, 32);
+  return crypto_sign_seed_keypair(pk,sk,sk);
+}
+
+int crypto_sign_pack_batch(u8 *r,gf (*p)[4],u64 n)
+{
+  gf t,zi,tx,ty;
+  u64 i;
+
+  if (!n) return 0;
+
+  set25519(p[0][3],p[0][2]);
+  for (i = 1;i < n;++i) M(p[i][3],p[i-1][3],p[i][2]);
+  inv25519(t,p[n-1][3]);
+
+  for (i = n;i-- > 0;) {
+    if (i) {
+      M(zi,t,p[i-1][3]);
+      M(t,t,p[i][2]);
+    } else set25519(zi,t);
+    M(tx,p[i][0],zi);
+    M(ty,p[i][1],zi);
+    pack25519(r + 32 * i,ty);
+    r[32 * i + 31] ^= par25519(tx) << 7;
+  }
+  return 0;
+}
+
+static int keypairs(u8 *pk,u8 *sk,const u8 *seed,u64 stride,u64 n)
+{
+  u8 d[64];
+  gf p[crypto_sign_BATCH][4];
+  u64 i,j,k;
+
+  for (i = 0;i < n;i += k) {
+    k = n - i < crypto_sign_BATCH ? n - i : crypto_sign_BATCH;
+    FOR(j,k) {
+      crypto_hash(d,seed + stride * (i + j),32);
+      d[0] &= 248;
+      d[31] &= 127;
+      d[31] |= 64;
+      scalarbase(p[j],d);
+    }
+    crypto_sign_pack_batch(pk + 32 * i,p,k);
+  }
+
+  FOR(i,n) FOR(j,32) {
+    sk[64 * i + j] = seed[stride * i + j];
+    sk[64 * i + 32 + j] = pk[32 * i + j];
+  }
+  FOR(i,64) d[i] = 0;
+  return 0;
+}
+
+int crypto_sign_seed_keypair_batch(u8 *pk,u8 *sk,const u8 *seed,u64 n)
+{
+  return keypairs(pk,sk,seed,32,n);
+}
+
+int crypto_sign_keypair_batch(u8 *pk,u8 *sk,u64 n)
+{
+  u64 i;
+  FOR(i,n) randombytes(sk + 64 * i,32);
+  return keypairs(pk,sk,sk,64,n);
+}
+
 static const u64 L[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10};
 
 sv modL(u8 *r,i64 x[64])
@@ -700,49 +1062,86 @@ sv modL(u8 *r,i64 x[64])
   }
 }
 
-sv reduce(u8 *r)
+sv reducex(u8 *r,i64 x[64])
 {
-  i64 x[64],i;
+  int i;
   FOR(i,64) x[i] = (u64) r[i];
   FOR(i,64) r[i] = 0;
   modL(r,x);
 }
 
-int crypto_sign(u8 *sm,u64 *smlen,const u8 *m,u64 n,const u8 *sk)
+sv reduce(u8 *r)
 {
-  u8 d[64],h[64],r[64];
-  i64 i,j,x[64];
-  gf p[4];
+  i64 x[64];
+  reducex(r,x);
+}
 
-  crypto_hash(d, sk, 32);
-  d[0] &= 248;
-  d[31] &= 127;
-  d[31] |= 64;
+#ifdef CONFIG_TWEETNACL_SMALL_STACK
+#define SCRATCH(w) crypto_sign_scratch *w = malloc(sizeof(crypto_sign_scratch)); if (!w) return -1
+#define UNSCRATCH(w) free(w)
+#else
+#define SCRATCH(w) crypto_sign_scratch w##_,*w = &w##_
+#define UNSCRATCH(w)
+#endif
 
-  *smlen = n+64;
-  FOR(i,n) sm[64 + i] = m[i];
-  FOR(i,32) sm[32 + i] = d[32 + i];
+sv hram(u8 *h,const u8 *sig,const u8 *m,u64 n,const u8 *pk,crypto_hash_state *s)
+{
+  crypto_hash_init(s);
+  crypto_hash_update(s,sig,32);
+  crypto_hash_update(s,pk,32);
+  crypto_hash_update(s,m,n);
+  crypto_hash_final(s,h);
+}
 
-  crypto_hash(r, sm+32, n+32);
-  reduce(r);
-  scalarbase(p,r);
-  pack(sm,p);
+int crypto_sign_detached_scratch(u8 *sig,const u8 *m,u64 n,const u8 *sk,crypto_sign_scratch *w)
+{
+  int i,j;
 
-  FOR(i,32) sm[i+32] = sk[i+32];
-  crypto_hash(h,sm,n + 64);
-  reduce(h);
+  crypto_hash_init(&w->s);
+  crypto_hash_update(&w->s,sk,32);
+  crypto_hash_final(&w->s,w->d);
+  w->d[0] &= 248;
+  w->d[31] &= 127;
+  w->d[31] |= 64;
+
+  crypto_hash_init(&w->s);
+  crypto_hash_update(&w->s,w->d + 32,32);
+  crypto_hash_update(&w->s,m,n);
+  crypto_hash_final(&w->s,w->r);
+  reducex(w->r,w->x);
+  setbase(w->q);
+  scalarmult(w->p,w->q,w->r);
+  pack(sig,w->p);
+
+  hram(w->h,sig,m,n,sk + 32,&w->s);
+  reducex(w->h,w->x);
+
+  FOR(i,64) w->x[i] = 0;
+  FOR(i,32) w->x[i] = (u64) w->r[i];
+  FOR(i,32) FOR(j,32) w->x[i+j] += w->h[i] * (u64) w->d[j];
+  modL(sig + 32,w->x);
+
+  FOR(i,64) w->d[i] = w->r[i] = 0;
+  FOR(i,64) w->x[i] = 0;
+  return 0;
+}
 
-  FOR(i,64) x[i] = 0;
-  FOR(i,32) x[i] = (u64) r[i];
-  FOR(i,32) FOR(j,32) x[i+j] += h[i] * (u64) d[j];
-  modL(sm + 32,x);
+int crypto_sign(u8 *sm,u64 *smlen,const u8 *m,u64 n,const u8 *sk)
+{
+  u64 i;
+  SCRATCH(w);
 
+  *smlen = n+64;
+  for (i = n;i-- > 0;) sm[64 + i] = m[i];
+  crypto_sign_detached_scratch(sm,sm + 64,n,sk,w);
+
+  UNSCRATCH(w);
   return 0;
 }
 
 int unpackneg(gf r[4],const u8 p[32])
 {
-  gf t, chk, num, den, den2, den4, den6;
+  gf t, chk, num, den, den2;
   set25519(r[2],gf1);
   unpack25519(r[1],p);
   S(num,r[1]);
@@ -751,9 +1150,9 @@ int unpackneg(gf r[4],const u8 p[32])
   A(den,r[2],den);
 
   S(den2,den);
-  S(den4,den2);
-  M(den6,den4,den2);
-  M(t,den6,num);
+  S(t,den2);
+  M(t,t,den2);
+  M(t,t,num);
   M(t,t,den);
 
   pow2523(t,t);
@@ -776,32 +1175,214 @@ int unpackneg(gf r[4],const u8 p[32])
   return 0;
 }
 
+int crypto_sign_verify_detached_scratch(const u8 *sig,const u8 *m,u64 n,const u8 *pk,crypto_sign_scratch *w)
+{
+  if (unpackneg(w->q,pk)) return -1;
+
+  hram(w->h,sig,m,n,pk,&w->s);
+  reducex(w->h,w->x);
+  scalarmult(w->p,w->q,w->h);
+
+  setbase(w->t);
+  scalarmult(w->q,w->t,sig + 32);
+  add(w->p,w->q);
+  pack(w->d,w->p);
+
+  return crypto_verify_32(sig, w->d);
+}
+
+int crypto_sign_verify_detached(const u8 *sig,const u8 *m,u64 n,const u8 *pk)
+{
+  int r;
+  SCRATCH(w);
+
+  r = crypto_sign_verify_detached_scratch(sig,m,n,pk,w);
+
+  UNSCRATCH(w);
+  return r;
+}
+
 int crypto_sign_open(u8 *m,u64 *mlen,const u8 *sm,u64 n,const u8 *pk)
 {
-  int i;
-  u8 t[32],h[64];
-  gf p[4],q[4];
+  u64 i;
 
   *mlen = -1;
   if (n < 64) return -1;
 
-  if (unpackneg(q,pk)) return -1;
+  n -= 64;
+  if (crypto_sign_verify_detached(sm,sm + 64,n,pk)) return -1;
 
-  FOR(i,n) m[i] = sm[i];
-  FOR(i,32) m[i+32] = pk[i];
-  crypto_hash(h,m,n);
-  reduce(h);
-  scalarmult(p,q,h);
+  FOR(i,n) m[i] = sm[i + 64];
+  *mlen = n;
+  return 0;
+}
 
-  scalarbase(q,sm + 32);
+sv cpypt(gf r[4],gf p[4])
+{
+  int i;
+  FOR(i,4) set25519(r[i],p[i]);
+}
+
+sv dbl(gf p[4])
+{
+  gf a,b,c,e,f,g,h;
+
+  S(a,p[0]);
+  S(b,p[1]);
+  S(c,p[2]);
+  A(c,c,c);
+  A(e,p[0],p[1]);
+  S(e,e);
+  Z(e,e,a);
+  Z(e,e,b);
+  Z(g,b,a);
+  Z(f,g,c);
+  A(h,a,b);
+  Z(h,gf0,h);
+
+  M(p[0],e,f);
+  M(p[1],g,h);
+  M(p[2],f,g);
+  M(p[3],e,h);
+}
+
+/* odd multiples p, 3p, 5p, 7p */
+sv oddmul(gf t[4][4],gf p[4])
+{
+  gf d[4];
+  int i;
+  cpypt(t[0],p);
+  cpypt(d,p);
+  dbl(d);
+  for (i = 1;i < 4;++i) {
+    cpypt(t[i],t[i-1]);
+    add(t[i],d);
+  }
+}
+
+/* signed odd digits in [-7,7], at most one nonzero per four positions */
+sv slide(signed char *r,const u8 *a)
+{
+  int i,b,k;
+  FOR(i,256) r[i] = 1 & (a[i>>3] >> (i&7));
+  r[256] = 0;
+  FOR(i,256) {
+    if (!r[i]) continue;
+    for (b = 1;b <= 4 && i + b < 256;++b) {
+      if (!r[i+b]) continue;
+      if (r[i] + (r[i+b] << b) <= 7) {
+        r[i] += r[i+b] << b;
+        r[i+b] = 0;
+      } else if (r[i] - (r[i+b] << b) >= -7) {
+        r[i] -= r[i+b] << b;
+        for (k = i + b;k <= 256;++k) {
+          if (!r[k]) { r[k] = 1; break; }
+          r[k] = 0;
+        }
+      } else
+        break;
+    }
+  }
+}
+
+sv addd(gf p[4],gf t[4][4],int d)
+{
+  gf q[4];
+  if (d > 0) cpypt(q,t[d>>1]);
+  else {
+    d = -d;
+    Z(q[0],gf0,t[d>>1][0]);
+    set25519(q[1],t[d>>1][1]);
+    set25519(q[2],t[d>>1][2]);
+    Z(q[3],gf0,t[d>>1][3]);
+  }
   add(p,q);
+}
+
+/* p = a*P + b*Q, variable time; only for public scalars and points */
+sv dsm(gf p[4],const u8 *a,gf ta[4][4],const u8 *b,gf tb[4][4])
+{
+  signed char sa[257],sb[257];
+  int i;
+  slide(sa,a);
+  slide(sb,b);
+  set25519(p[0],gf0);
+  set25519(p[1],gf1);
+  set25519(p[2],gf1);
+  set25519(p[3],gf0);
+  for (i = 256;i >= 0 && !sa[i] && !sb[i];--i);
+  for (;i >= 0;--i) {
+    dbl(p);
+    if (sa[i]) addd(p,ta,sa[i]);
+    if (sb[i]) addd(p,tb,sb[i]);
+  }
+}
+
+void crypto_sign_keycache_init(crypto_sign_keycache *c)
+{
+  u8 *p = (u8 *) c;
+  u64 i;
+  FOR(i,sizeof(*c)) p[i] = 0;
+}
+
+static crypto_sign_keycache_entry *keycache_get(crypto_sign_keycache *c,const u8 *pk)
+{
+  crypto_sign_keycache_entry *e,*v = c->e;
+  gf q[4];
+  int i,j;
+
+  FOR(i,crypto_sign_KEYCACHE_ENTRIES) {
+    e = &c->e[i];
+    if (e->stamp) {
+      FOR(j,32) if (e->pk[j] != pk[j]) break;
+      if (j == 32) {
+        e->stamp = ++c->clock;
+        return e;
+      }
+    }
+    if (e->stamp < v->stamp) v = e;
+  }
+
+  v->stamp = 0;
+  if (unpackneg(q,pk)) return 0;
+  oddmul(v->a,q);
+  FOR(j,32) v->pk[j] = pk[j];
+  v->stamp = ++c->clock;
+  return v;
+}
+
+int crypto_sign_verify_detached_cached(const u8 *sig,const u8 *m,u64 n,const u8 *pk,crypto_sign_keycache *c)
+{
+  u8 t[32],h[64];
+  gf p[4];
+  crypto_hash_state s;
+  crypto_sign_keycache_entry *e;
+
+  if (!c->clock) {
+    setbase(p);
+    oddmul(c->b,p);
+  }
+
+  e = keycache_get(c,pk);
+  if (!e) return -1;
+
+  hram(h,sig,m,n,pk,&s);
+  reduce(h);
+  dsm(p,h,e->a,sig + 32,c->b);
   pack(t,p);
 
+  return crypto_verify_32(sig, t);
+}
+
+int crypto_sign_open_cached(u8 *m,u64 *mlen,const u8 *sm,u64 n,const u8 *pk,crypto_sign_keycache *c)
+{
+  u64 i;
+
+  *mlen = -1;
+  if (n < 64) return -1;
+
   n -= 64;
-  if (crypto_verify_32(sm, t)) {
-    FOR(i,n) m[i] = 0;
-    return -1;
-  }
+  if (crypto_sign_verify_detached_cached(sm,sm + 64,n,pk,c)) return -1;
 
   FOR(i,n) m[i] = sm[i + 64];
   *mlen = n;
@@ -271,4 +271,40 @@ extern int crypto_verify_32_tweet(const unsigned char *,const unsigned char *);
 #define crypto_verify_32_IMPLEMENTATION "crypto_verify/32/tweet"
 typedef long long gf[16];
 extern int unpackneg(gf r[4],const unsigned char p[32]);
+#define crypto_sign_KEYCACHE_ENTRIES 4
+typedef struct {
+  unsigned char pk[32];
+  unsigned long stamp;
+  gf a[4][4];
+} crypto_sign_keycache_entry;
+typedef struct {
+  crypto_sign_keycache_entry e[crypto_sign_KEYCACHE_ENTRIES];
+  gf b[4][4];
+  unsigned long clock;
+} crypto_sign_keycache;
+extern void crypto_sign_keycache_init(crypto_sign_keycache *);
+extern int crypto_sign_open_cached(unsigned char *,unsigned long long *,const unsigned char *,unsigned long long,const unsigned char *,crypto_sign_keycache *);
+typedef struct {
+  unsigned char h[64];
+  unsigned char x[128];
+  unsigned long long n;
+} crypto_hash_state;
+extern void crypto_hash_init(crypto_hash_state *);
+extern void crypto_hash_update(crypto_hash_state *,const unsigned char *,unsigned long long);
+extern void crypto_hash_final(crypto_hash_state *,unsigned char *);
+extern int crypto_sign_verify_detached(const unsigned char *,const unsigned char *,unsigned long long,const unsigned char *);
+extern int crypto_sign_verify_detached_cached(const unsigned char *,const unsigned char *,unsigned long long,const unsigned char *,crypto_sign_keycache *);
+typedef struct {
+  gf p[4],q[4];
+  union { long long x[64]; gf t[4]; };
+  unsigned char d[64],h[64],r[64];
+  crypto_hash_state s;
+} crypto_sign_scratch;
+extern int crypto_sign_detached_scratch(unsigned char *,const unsigned char *,unsigned long long,const unsigned char *,crypto_sign_scratch *);
+extern int crypto_sign_verify_detached_scratch(const unsigned char *,const unsigned char *,unsigned long long,const unsigned char *,crypto_sign_scratch *);
+#define crypto_sign_BATCH 8
+extern int crypto_sign_pack_batch(unsigned char *,gf (*)[4],unsigned long long);
+extern int crypto_sign_seed_keypair(unsigned char *,unsigned char *,const unsigned char *);
+extern int crypto_sign_keypair_batch(unsigned char *,unsigned char *,unsigned long long);
+extern int crypto_sign_seed_keypair_batch(unsigned char *,unsigned char *,const unsigned char *,unsigned long long);
 #endif
@@ -0,0 +1,373 @@
+#include "x402_cache.h"
+#include "x402_client.h"
+#include "bulk_mem.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sync_util.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static const char *TAG = "x402_cache";
+
+/**
+ * @brief One cached GET response
+ */
+typedef struct {
+    char *url;                      // NULL = free slot
+    uint8_t payer[32];              // Wallet that paid for it; only it is served
+    char *vary_names;               // Response Vary value (NULL if none)
+    char *vary_values;              // Request header values for vary_names
+    char *headers;
+    char *body;
+    size_t body_len;
+    char etag[X402_CACHE_MAX_VALIDATOR_LEN];
+    char last_modified[X402_CACHE_MAX_VALIDATOR_LEN];
+    int64_t fresh_until_us;
+    int64_t last_used_us;
+    size_t size;                    // Bytes charged against X402_CACHE_MAX_BYTES
+} cache_entry_t;
+
+static cache_entry_t s_entries[X402_CACHE_MAX_ENTRIES];
+static x402_cache_stats_t s_stats;
+static sync_mutex_t s_lock = SYNC_MUTEX_INIT;
+
+/**
+ * @brief Take the cache mutex (bodies are copied under it, so no spinlock)
+ */
+static void cache_lock(void) {
+    sync_mutex_take(&s_lock);
+}
+
+static void cache_unlock(void) {
+    sync_mutex_give(&s_lock);
+}
+
+/**
+ * @brief Allocate entry storage, in PSRAM when there is some
+ */
+static char *cache_alloc(size_t size) {
+    return bulk_alloc(size);
+}
+
+static char *cache_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *copy = cache_alloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+/**
+ * @brief Cache-Control directives that matter to a private cache
+ */
+static void parse_cache_control(const char *headers, bool *no_store, bool *no_cache, long *max_age) {
+    *no_store = false;
+    *no_cache = false;
+    *max_age = -1;
+
+    char value[256];
+    if (!x402_extract_header(headers, "Cache-Control", value, sizeof(value))) {
+        return;
+    }
+    char *save = NULL;
+    for (char *token = strtok_r(value, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        while (*token == ' ' || *token == '\t') token++;
+        if (strncasecmp(token, "no-store", 8) == 0) {
+            *no_store = true;
+        } else if (strncasecmp(token, "no-cache", 8) == 0) {
+            *no_cache = true;
+        } else if (strncasecmp(token, "max-age=", 8) == 0) {
+            *max_age = strtol(token + 8, NULL, 10);
+        }
+    }
+}
+
+/**
+ * @brief Values of the request headers named by Vary, one per line
+ */
+static void vary_values(const char *names, const char *request_headers, char *out, size_t max_len) {
+    size_t len = 0;
+    out[0] = '\0';
+    const char *p = names;
+    while (*p) {
+        p += strspn(p, " \t,");
+        size_t name_len = strcspn(p, " \t,");
+        if (name_len == 0) {
+            break;
+        }
+        char name[64];
+        char value[128] = "";
+        if (name_len < sizeof(name)) {
+            memcpy(name, p, name_len);
+            name[name_len] = '\0';
+            x402_extract_header(request_headers, name, value, sizeof(value));
+        }
+        len += snprintf(out + len, max_len - len, "%s\n", value);
+        if (len >= max_len) {
+            out[max_len - 1] = '\0';
+            return;
+        }
+        p += name_len;
+    }
+}
+
+static void entry_free(cache_entry_t *e) {
+    if (!e->url) {
+        return;
+    }
+    s_stats.bytes -= e->size;
+    s_stats.entries--;
+    free(e->url);
+    free(e->vary_names);
+    free(e->vary_values);
+    free(e->headers);
+    free(e->body);
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Entry paid by payer for url whose Vary headers match request_headers
+ */
+static cache_entry_t *entry_find(const uint8_t *payer, const char *url, const char *request_headers) {
+    for (int i = 0; i < X402_CACHE_MAX_ENTRIES; i++) {
+        cache_entry_t *e = &s_entries[i];
+        if (!e->url || memcmp(e->payer, payer, sizeof(e->payer)) != 0 || strcmp(e->url, url) != 0) {
+            continue;
+        }
+        if (e->vary_names) {
+            char values[X402_CACHE_MAX_VARY_LEN];
+            vary_values(e->vary_names, request_headers, values, sizeof(values));
+            if (strcmp(values, e->vary_values) != 0) {
+                continue;
+            }
+        }
+        return e;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Freshness lifetime from Cache-Control: 0 if it must be revalidated
+ *
+ * @return false if the response may not be stored
+ */
+static bool response_lifetime(const char *headers, int64_t *lifetime_us) {
+    bool no_store, no_cache;
+    long max_age;
+    parse_cache_control(headers, &no_store, &no_cache, &max_age);
+    *lifetime_us = (no_cache || max_age <= 0) ? 0 : max_age * 1000000LL;
+    return !no_store;
+}
+
+/**
+ * @brief Copy an entry into a caller-owned response
+ */
+static esp_err_t entry_copy(const cache_entry_t *e, x402_response_t *response_out) {
+    memset(response_out, 0, sizeof(*response_out));
+    response_out->headers = e->headers ? strdup(e->headers) : NULL;
+    response_out->body = bulk_alloc(e->body_len + 1);
+    if ((e->headers && !response_out->headers) || !response_out->body) {
+        x402_response_free(response_out);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(response_out->body, e->body, e->body_len);
+    response_out->body[e->body_len] = '\0';
+    response_out->body_len = e->body_len;
+    response_out->status_code = 200;
+    response_out->from_cache = true;
+    return ESP_OK;
+}
+
+esp_err_t x402_cache_get(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    x402_response_t *response_out,
+    char **validators_out
+) {
+    *validators_out = NULL;
+    if (X402_CACHE_MAX_BYTES == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    int64_t now = esp_timer_get_time();
+    cache_lock();
+    cache_entry_t *e = entry_find(payer, url, request_headers);
+    if (e && now < e->fresh_until_us) {
+        err = entry_copy(e, response_out);
+        if (err == ESP_OK) {
+            e->last_used_us = now;
+            s_stats.hits++;
+        }
+    } else if (e && (e->etag[0] || e->last_modified[0])) {
+        if (asprintf(validators_out, "%s%s%s%s%s",
+                     e->etag[0] ? "If-None-Match: " : "", e->etag,
+                     e->etag[0] && e->last_modified[0] ? "\r\n" : "",
+                     e->last_modified[0] ? "If-Modified-Since: " : "", e->last_modified) < 0) {
+            *validators_out = NULL;
+        }
+        err = *validators_out ? ESP_ERR_INVALID_STATE : ESP_ERR_NO_MEM;
+    } else {
+        if (e) {
+            entry_free(e);      // Expired and nothing to revalidate with
+        }
+        s_stats.misses++;
+    }
+    cache_unlock();
+    return err;
+}
+
+esp_err_t x402_cache_revalidated(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    const char *headers_304,
+    x402_response_t *response_out
+) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    int64_t now = esp_timer_get_time();
+    cache_lock();
+    cache_entry_t *e = entry_find(payer, url, request_headers);
+    if (e) {
+        // A 304 may renew the lifetime and validators; otherwise keep the stored ones
+        char value[8];
+        int64_t lifetime_us;
+        const char *source = x402_extract_header(headers_304, "Cache-Control", value, sizeof(value))
+                             ? headers_304 : e->headers;
+        response_lifetime(source, &lifetime_us);
+        e->fresh_until_us = now + lifetime_us;
+        e->last_used_us = now;
+        x402_extract_header(headers_304, "ETag", e->etag, sizeof(e->etag));
+        x402_extract_header(headers_304, "Last-Modified", e->last_modified, sizeof(e->last_modified));
+        err = entry_copy(e, response_out);
+        if (err == ESP_OK) {
+            s_stats.revalidated++;
+        }
+    }
+    cache_unlock();
+    return err;
+}
+
+void x402_cache_put(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    const x402_response_t *response
+) {
+    if (X402_CACHE_MAX_BYTES == 0 || response->status_code != 200 || !response->body) {
+        return;
+    }
+
+    int64_t lifetime_us;
+    if (!response_lifetime(response->headers, &lifetime_us)) {
+        return;     // no-store
+    }
+    char etag[X402_CACHE_MAX_VALIDATOR_LEN] = "";
+    char last_modified[X402_CACHE_MAX_VALIDATOR_LEN] = "";
+    x402_extract_header(response->headers, "ETag", etag, sizeof(etag));
+    x402_extract_header(response->headers, "Last-Modified", last_modified, sizeof(last_modified));
+    if (lifetime_us == 0 && !etag[0] && !last_modified[0]) {
+        return;     // Could never be reused
+    }
+
+    char vary[128] = "";
+    x402_extract_header(response->headers, "Vary", vary, sizeof(vary));
+    if (strchr(vary, '*')) {
+        return;
+    }
+    char values[X402_CACHE_MAX_VARY_LEN] = "";
+    if (vary[0]) {
+        vary_values(vary, request_headers, values, sizeof(values));
+    }
+
+    size_t size = strlen(url) + 1 + response->body_len +
+                  (response->headers ? strlen(response->headers) + 1 : 0) +
+                  (vary[0] ? strlen(vary) + strlen(values) + 2 : 0);
+    if (size > X402_CACHE_MAX_BYTES) {
+        ESP_LOGD(TAG, "Not caching %s (%zu bytes)", url, size);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    cache_lock();
+    cache_entry_t *e = entry_find(payer, url, request_headers);
+    if (e) {
+        entry_free(e);
+    }
+    // Evict least recently used entries until it fits
+    for (;;) {
+        cache_entry_t *free_slot = NULL;
+        cache_entry_t *lru = NULL;
+        for (int i = 0; i < X402_CACHE_MAX_ENTRIES; i++) {
+            cache_entry_t *c = &s_entries[i];
+            if (!c->url) {
+                free_slot = free_slot ? free_slot : c;
+            } else if (!lru || c->last_used_us < lru->last_used_us) {
+                lru = c;
+            }
+        }
+        if (free_slot && s_stats.bytes + size <= X402_CACHE_MAX_BYTES) {
+            e = free_slot;
+            break;
+        }
+        ESP_LOGD(TAG, "Evicting %s", lru->url);
+        entry_free(lru);
+        s_stats.evicted++;
+    }
+
+    e->url = cache_strdup(url);
+    e->headers = response->headers ? cache_strdup(response->headers) : NULL;
+    e->body = cache_alloc(response->body_len);
+    if (vary[0]) {
+        e->vary_names = cache_strdup(vary);
+        e->vary_values = cache_strdup(values);
+    }
+    if (!e->url || (response->headers && !e->headers) || !e->body ||
+        (vary[0] && (!e->vary_names || !e->vary_values))) {
+        free(e->url);
+        free(e->headers);
+        free(e->body);
+        free(e->vary_names);
+        free(e->vary_values);
+        memset(e, 0, sizeof(*e));
+        cache_unlock();
+        ESP_LOGW(TAG, "No memory to cache %s", url);
+        return;
+    }
+    memcpy(e->payer, payer, sizeof(e->payer));
+    memcpy(e->body, response->body, response->body_len);
+    e->body_len = response->body_len;
+    strcpy(e->etag, etag);
+    strcpy(e->last_modified, last_modified);
+    e->fresh_until_us = now + lifetime_us;
+    e->last_used_us = now;
+    e->size = size;
+    s_stats.bytes += size;
+    s_stats.entries++;
+    s_stats.stored++;
+    cache_unlock();
+
+    ESP_LOGI(TAG, "Cached %s (%zu bytes, fresh for %lld s)", url, size, lifetime_us / 1000000);
+}
+
+void x402_cache_clear(void) {
+    cache_lock();
+    for (int i = 0; i < X402_CACHE_MAX_ENTRIES; i++) {
+        entry_free(&s_entries[i]);
+    }
+    cache_unlock();
+}
+
+esp_err_t x402_cache_get_stats(x402_cache_stats_t *stats_out) {
+    if (!stats_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cache_lock();
+    *stats_out = s_stats;
+    cache_unlock();
+    return ESP_OK;
+}
@@ -0,0 +1,104 @@
+#ifndef X402_CACHE_H
+#define X402_CACHE_H
+
+#include "x402_types.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Paid-response cache counters
+ */
+typedef struct {
+    uint32_t hits;                  // Served fresh, no request at all
+    uint32_t revalidated;           // Served after an unpaid 304
+    uint32_t misses;                // No usable entry
+    uint32_t stored;                // Paid responses stored
+    uint32_t evicted;               // Entries dropped to make room
+    size_t bytes;                   // Bytes held now
+    size_t entries;                 // Entries held now
+} x402_cache_stats_t;
+
+/**
+ * @brief Look up a GET response
+ *
+ * Entries follow the response's Cache-Control (max-age, no-cache,
+ * no-store), ETag / Last-Modified and Vary, matched against the request
+ * headers the entry was stored with. Only the wallet that paid for an entry
+ * is served from it.
+ *
+ * @param payer Public key of the paying wallet (32 bytes)
+ * @param url Request URL
+ * @param request_headers Caller's request headers (for Vary), can be NULL
+ * @param response_out Output on a fresh hit: copy of the cached response
+ * @param validators_out Output on a stale hit: allocated "If-None-Match" /
+ *                       "If-Modified-Since" header lines (caller must free)
+ * @return ESP_OK on a fresh hit, ESP_ERR_INVALID_STATE if stale but
+ *         revalidatable, ESP_ERR_NOT_FOUND otherwise
+ */
+esp_err_t x402_cache_get(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    x402_response_t *response_out,
+    char **validators_out
+);
+
+/**
+ * @brief Refresh an entry from a 304 and serve it
+ *
+ * @param payer Public key of the paying wallet (32 bytes)
+ * @param url Request URL
+ * @param request_headers Caller's request headers (for Vary), can be NULL
+ * @param headers_304 Headers of the 304 response (new Cache-Control, ETag,
+ *                    Last-Modified)
+ * @param response_out Output: copy of the cached response
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the entry was evicted
+ */
+esp_err_t x402_cache_revalidated(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    const char *headers_304,
+    x402_response_t *response_out
+);
+
+/**
+ * @brief Store a paid GET response if its headers allow it
+ *
+ * Bodies go to PSRAM when available. The store is bounded by
+ * X402_CACHE_MAX_BYTES and X402_CACHE_MAX_ENTRIES, evicting least recently
+ * used entries.
+ *
+ * @param payer Public key of the wallet that paid for it (32 bytes)
+ * @param url Request URL
+ * @param request_headers Caller's request headers (for Vary), can be NULL
+ * @param response Response to store (status 200)
+ */
+void x402_cache_put(
+    const uint8_t *payer,
+    const char *url,
+    const char *request_headers,
+    const x402_response_t *response
+);
+
+/**
+ * @brief Drop all entries
+ */
+void x402_cache_clear(void);
+
+/**
+ * @brief Get cache counters
+ *
+ * @param stats_out Output: counters
+ * @return ESP_OK on success
+ */
+esp_err_t x402_cache_get_stats(x402_cache_stats_t *stats_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // X402_CACHE_H
@@ -2,160 +2,168 @@
 #include "x402_requirements.h"
 #include "x402_payment.h"
 #include "x402_encoding.h"
+#include "x402_cache.h"
+#include "x402_facilitator.h"
 #include "esp_log.h"
-#include "esp_http_client.h"
+#include "http_transport.h"
+#include "bulk_mem.h"
+#include "sync_util.h"
 #include "mbedtls/base64.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <strings.h>
 
 static const char *TAG = "x402_client";
 
+static x402_probe_t s_body_probe = X402_BODY_PROBE;
+static uint32_t s_no_probe[X402_PROBE_CACHE_SIZE];  // URL hashes whose probe gave no (usable) requirements
+static size_t s_no_probe_next;
+static portMUX_TYPE s_probe_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /**
- * @brief HTTP response buffer structure
+ * @brief FNV-1a hash of a URL without its query string
  */
-typedef struct {
-    char *data;
-    size_t len;
-    size_t capacity;
-} http_buffer_t;
+static uint32_t url_hash(const char *url) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = url; *p && *p != '?'; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash ? hash : 1;     // 0 marks an empty slot
+}
 
 /**
- * @brief HTTP event handler for capturing response
+ * @brief Probe to use for a request with a body to this URL
  */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
-    http_buffer_t *buffer = (http_buffer_t *)evt->user_data;
-    
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            // Allocate or expand buffer
-            if (buffer->data == NULL) {
-                buffer->capacity = 4096;
-                buffer->data = malloc(buffer->capacity);
-                buffer->len = 0;
-            }
-            
-            // Check if we need to expand
-            if (buffer->len + evt->data_len >= buffer->capacity) {
-                buffer->capacity *= 2;
-                buffer->data = realloc(buffer->data, buffer->capacity);
-            }
-            
-            // Copy data
-            if (buffer->data) {
-                memcpy(buffer->data + buffer->len, evt->data, evt->data_len);
-                buffer->len += evt->data_len;
-                buffer->data[buffer->len] = '\0';
-            }
-            break;
-            
-        default:
-            break;
+static x402_probe_t probe_for(const char *url) {
+    uint32_t hash = url_hash(url);
+    x402_probe_t probe;
+    portENTER_CRITICAL(&s_probe_lock);
+    probe = s_body_probe;
+    for (size_t i = 0; i < X402_PROBE_CACHE_SIZE && probe != X402_PROBE_FULL; i++) {
+        if (s_no_probe[i] == hash) {
+            probe = X402_PROBE_FULL;
+        }
     }
-    
-    return ESP_OK;
+    portEXIT_CRITICAL(&s_probe_lock);
+    return probe;
+}
+
+/**
+ * @brief Remember that probing this URL does not work
+ */
+static void probe_unsupported(const char *url) {
+    uint32_t hash = url_hash(url);
+    portENTER_CRITICAL(&s_probe_lock);
+    s_no_probe[s_no_probe_next] = hash;
+    s_no_probe_next = (s_no_probe_next + 1) % X402_PROBE_CACHE_SIZE;
+    portEXIT_CRITICAL(&s_probe_lock);
+}
+
+/**
+ * @brief Where a follower of an in-flight fetch wants its result
+ *
+ * The leader fills every follower's copy before waking any of them. The
+ * slot is reused once every follower has woken.
+ */
+typedef struct {
+    x402_response_t *out;
+    esp_err_t err;
+} fetch_follower_t;
+
+// Slots keyed by a hash of wallet, method, URL, headers and body
+static sync_flight_t s_flights[X402_MAX_INFLIGHT];
+static portMUX_TYPE s_flight_lock = portMUX_INITIALIZER_UNLOCKED;
+static sync_once_t s_flight_once = SYNC_ONCE_INIT;
+
+_Static_assert(X402_MAX_FOLLOWERS <= SYNC_FLIGHT_MAX_FOLLOWERS, "too many followers per fetch");
+
+static void flight_init(void *arg) {
+    sync_flight_init(s_flights, X402_MAX_INFLIGHT, X402_MAX_FOLLOWERS);
+}
+
+static void flight_release(sync_flight_t *flight) {
+    portENTER_CRITICAL(&s_flight_lock);
+    sync_flight_release(flight);
+    portEXIT_CRITICAL(&s_flight_lock);
+}
+
+static uint64_t fnv1a64(uint64_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void x402_set_body_probe(x402_probe_t probe) {
+    portENTER_CRITICAL(&s_probe_lock);
+    s_body_probe = probe;
+    memset(s_no_probe, 0, sizeof(s_no_probe));
+    portEXIT_CRITICAL(&s_probe_lock);
+}
+
+static esp_http_client_method_t parse_method(const char *method) {
+    if (strcmp(method, "POST") == 0) {
+        return HTTP_METHOD_POST;
+    } else if (strcmp(method, "PUT") == 0) {
+        return HTTP_METHOD_PUT;
+    } else if (strcmp(method, "DELETE") == 0) {
+        return HTTP_METHOD_DELETE;
+    } else if (strcmp(method, "HEAD") == 0) {
+        return HTTP_METHOD_HEAD;
+    }
+    return HTTP_METHOD_GET;
 }
 
 /**
  * @brief Internal HTTP request function
+ *
+ * @param written_out Output: whether the request left the device, also on an error
  */
 static esp_err_t http_request(
     const char *url,
     const char *method,
     const char *headers,
-    const char *body,
+    const x402_body_t *body,
     int *status_out,
     char **headers_out,
     char **body_out,
-    size_t *body_len_out
+    size_t *body_len_out,
+    bool *written_out
 ) {
-    esp_err_t err;
+    esp_http_client_method_t http_method = parse_method(method);
+    
+    ESP_LOGD(TAG, "Request headers: %.160s", headers ? headers : "");
     
-    // Setup HTTP client
-    esp_http_client_config_t config = {
+    // The 402 probe and the paid retry go to the same origin, so the retry
+    // reuses the pooled connection (or resumes its TLS session)
+    http_transport_request_t request = {
         .url = url,
-        .method = HTTP_METHOD_GET,
-        .event_handler = http_event_handler,
+        .method = http_method,
+        .headers = headers,
+        .body = body ? (const char *)body->data : NULL,
+        .body_len = body ? body->len : 0,
+        .body_reader = body ? body->read : NULL,
+        .body_reader_ctx = body ? body->read_ctx : NULL,
         .timeout_ms = 10000,
-        .buffer_size = 4096,
-        .buffer_size_tx = 4096,
+        .accept_encoding = X402_ACCEPT_ENCODING,
     };
-    
-    // Parse method
-    if (strcmp(method, "POST") == 0) {
-        config.method = HTTP_METHOD_POST;
-    } else if (strcmp(method, "PUT") == 0) {
-        config.method = HTTP_METHOD_PUT;
-    } else if (strcmp(method, "DELETE") == 0) {
-        config.method = HTTP_METHOD_DELETE;
-    }
-    
-    http_buffer_t response_buffer = {0};
-    config.user_data = &response_buffer;
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
-    }
-    
-    // Set custom headers
-    if (headers) {
-        // Parse and set each header
-        char *headers_copy = strdup(headers);
-        char *line = strtok(headers_copy, "\r\n");
-        while (line) {
-            char *colon = strchr(line, ':');
-            if (colon) {
-                *colon = '\0';
-                char *value = colon + 1;
-                while (*value == ' ') value++; // Skip spaces
-                ESP_LOGI(TAG, "Setting header: '%s' = '%.80s%s'", 
-                         line, value, strlen(value) > 80 ? "..." : "");
-                esp_http_client_set_header(client, line, value);
-            }
-            line = strtok(NULL, "\r\n");
-        }
-        free(headers_copy);
-    }
-    
-    // Set body if present
-    if (body && body[0]) {
-        esp_http_client_set_post_field(client, body, strlen(body));
-    }
-    
-    // Perform request
-    err = esp_http_client_perform(client);
+    http_transport_response_t response;
+    esp_err_t err = http_transport_perform(&request, &response);
+    *written_out = response.sent;
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        if (response_buffer.data) free(response_buffer.data);
+        http_transport_response_free(&response);
         return err;
     }
     
-    // Get status code
-    *status_out = esp_http_client_get_status_code(client);
-    
-    // Get headers (simplified - just store all headers as string)
-    int content_length = esp_http_client_get_content_length(client);
-    *headers_out = malloc(1024);
-    if (*headers_out) {
-        snprintf(*headers_out, 1024, "Content-Length: %d\r\n", content_length);
-        
-        // Try to get X-PAYMENT-RESPONSE header
-        char *payment_response = NULL;
-        if (esp_http_client_get_header(client, X402_HEADER_PAYMENT_RESPONSE, 
-                                       &payment_response) == ESP_OK && payment_response) {
-            size_t current_len = strlen(*headers_out);
-            snprintf(*headers_out + current_len, 1024 - current_len,
-                     "%s: %s\r\n", X402_HEADER_PAYMENT_RESPONSE, payment_response);
-        }
-    }
-    
-    // Get body
-    *body_out = response_buffer.data;
-    *body_len_out = response_buffer.len;
-    
-    esp_http_client_cleanup(client);
+    *status_out = response.status_code;
+    *headers_out = response.headers;
+    *body_out = response.body;
+    *body_len_out = response.body_len;
     
     ESP_LOGD(TAG, "HTTP %s %s -> %d (%zu bytes)",
              method, url, *status_out, *body_len_out);
@@ -163,6 +171,118 @@ static esp_err_t http_request(
     return ESP_OK;
 }
 
+/**
+ * @brief http_request, sent again while the API fails transiently
+ *
+ * Transport errors and 502/503/504 back off with jitter, but only for
+ * idempotent methods or requests that never left the device: the server may
+ * have acted on anything else. A 429 waits for its Retry-After, whatever the
+ * method. The last outcome is returned either way, with its class.
+ */
+static esp_err_t http_request_retry(
+    const char *url,
+    const char *method,
+    const char *headers,
+    const x402_body_t *body,
+    int *status_out,
+    char **headers_out,
+    char **body_out,
+    size_t *body_len_out,
+    x402_error_class_t *class_out,
+    int *sent
+) {
+    bool idempotent = http_transport_method_idempotent(parse_method(method));
+    for (int attempt = 1; ; attempt++) {
+        *headers_out = NULL;
+        *body_out = NULL;
+        bool written = false;
+        esp_err_t err = http_request(url, method, headers, body,
+                                     status_out, headers_out, body_out, body_len_out, &written);
+        (*sent)++;
+        
+        x402_error_class_t error_class = X402_ERROR_NONE;
+        bool retry = true;
+        uint32_t delay_ms = solana_rpc_backoff_ms(attempt - 1);
+        if (err != ESP_OK || *status_out == 502 || *status_out == 503 || *status_out == 504) {
+            error_class = X402_ERROR_TRANSPORT;
+            retry = idempotent || (err != ESP_OK && !written);
+        } else if (*status_out == 429) {
+            error_class = X402_ERROR_RATE_LIMITED;
+            char value[16];
+            if (x402_extract_header(*headers_out, "Retry-After", value, sizeof(value))) {
+                unsigned long seconds = strtoul(value, NULL, 10);   // HTTP dates: keep the backoff
+                if (seconds) {
+                    delay_ms = seconds > X402_RETRY_AFTER_MAX_MS / 1000
+                               ? X402_RETRY_AFTER_MAX_MS : (uint32_t)seconds * 1000;
+                }
+            }
+        }
+        *class_out = error_class;
+        if (error_class == X402_ERROR_NONE || !retry || attempt >= X402_MAX_ATTEMPTS) {
+            return err;
+        }
+        
+        ESP_LOGW(TAG, "%s %s: attempt %d failed (%s), retrying in %lu ms", method, url, attempt,
+                 err != ESP_OK ? esp_err_to_name(err) : "busy", (unsigned long)delay_ms);
+        if (err == ESP_OK) {
+            free(*headers_out);
+            free(*body_out);
+        }
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    }
+}
+
+/**
+ * @brief Class of a payment the facilitator turned down (402 on the paid leg)
+ */
+static x402_error_class_t classify_rejection(const char *body) {
+    switch (solana_rpc_classify_text(body)) {
+    case SOLANA_RPC_ERROR_BLOCKHASH_EXPIRED:
+        return X402_ERROR_BLOCKHASH_EXPIRED;
+    case SOLANA_RPC_ERROR_INSUFFICIENT_FUNDS:
+        return X402_ERROR_INSUFFICIENT_FUNDS;
+    default:
+        return X402_ERROR_FACILITATOR_REJECTED;
+    }
+}
+
+/**
+ * @brief Payment requirements of a 402: from its body, or from the
+ *        PAYMENT-REQUIRED header when it has none (HEAD, newer servers)
+ */
+static esp_err_t parse_requirements(
+    const char *headers,
+    const char *body,
+    x402_payment_requirements_t *requirements
+) {
+    if (body && body[0]) {
+        return x402_parse_payment_requirements(body, requirements);
+    }
+    
+    char *encoded = bulk_alloc(HTTP_TRANSPORT_MAX_HEADERS_LEN);
+    if (!encoded) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_FAIL;
+    if (x402_extract_header(headers, X402_HEADER_PAYMENT_REQUIRED,
+                            encoded, HTTP_TRANSPORT_MAX_HEADERS_LEN)) {
+        size_t json_len = 0;
+        unsigned char *json = bulk_alloc(HTTP_TRANSPORT_MAX_HEADERS_LEN);
+        if (!json) {
+            err = ESP_ERR_NO_MEM;
+        } else if (mbedtls_base64_decode(json, HTTP_TRANSPORT_MAX_HEADERS_LEN - 1, &json_len,
+                                         (const unsigned char *)encoded, strlen(encoded)) == 0) {
+            json[json_len] = '\0';
+            err = x402_parse_payment_requirements((const char *)json, requirements);
+        }
+        free(json);
+    } else {
+        ESP_LOGE(TAG, "402 response has no payment requirements");
+    }
+    free(encoded);
+    return err;
+}
+
 bool x402_extract_header(
     const char *headers,
     const char *header_name,
@@ -173,17 +293,22 @@ bool x402_extract_header(
         return false;
     }
     
-    // Search for header
-    char search_str[128];
-    snprintf(search_str, sizeof(search_str), "%s:", header_name);
-    
-    const char *header_pos = strstr(headers, search_str);
-    if (!header_pos) {
+    // Search for header (names are case-insensitive and start a line)
+    size_t name_len = strlen(header_name);
+    const char *header_pos = headers;
+    while (*header_pos) {
+        if (strncasecmp(header_pos, header_name, name_len) == 0 && header_pos[name_len] == ':') {
+            break;
+        }
+        header_pos += strcspn(header_pos, "\r\n");
+        header_pos += strspn(header_pos, "\r\n");
+    }
+    if (!*header_pos) {
         return false;
     }
     
     // Skip header name and colon
-    header_pos += strlen(search_str);
+    header_pos += name_len + 1;
     
     // Skip whitespace
     while (*header_pos == ' ' || *header_pos == '\t') {
@@ -208,70 +333,155 @@ esp_err_t x402_fetch(
     const char *body,
     x402_response_t *response_out
 ) {
-    if (!wallet || !url || !method || !response_out) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    memset(response_out, 0, sizeof(x402_response_t));
-    
+    x402_body_t text = {
+        .data = (const uint8_t *)body,
+        .len = body ? strlen(body) : 0,
+    };
+    return x402_fetch_body(wallet, url, method, headers, body ? &text : NULL, response_out);
+}
+
+/**
+ * @brief The x402 flow for one caller (arguments already checked)
+ *
+ * @param may_probe Probe a request with a body first, and redo the flow once
+ *                  if the payment is rejected (false for that redo)
+ */
+static esp_err_t fetch_once(
+    solana_wallet_t *wallet,
+    const char *url,
+    const char *method,
+    const char *headers,
+    const x402_body_t *body,
+    bool may_probe,
+    x402_response_t *response_out
+) {
     esp_err_t err;
     
     ESP_LOGI(TAG, "=== x402 Fetch: %s %s ===", method, url);
     
-    // Step 1: Initial request (no payment)
+    // Step 0: Paid-response cache (GET). A fresh entry costs no payment and
+    // no round trip; a stale one is revalidated by the unpaid first request.
+    // Entries belong to the wallet that paid for them.
+    uint8_t payer[32];
+    bool cacheable = !body && strcmp(method, "GET") == 0 &&
+                     solana_wallet_get_pubkey(wallet, payer) == ESP_OK;
+    char *conditional_headers = NULL;
+    if (cacheable) {
+        char *validators = NULL;
+        err = x402_cache_get(payer, url, headers, response_out, &validators);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Served from cache, no payment");
+            return ESP_OK;
+        }
+        if (validators) {
+            bool extra = headers && headers[0];
+            if (asprintf(&conditional_headers, "%s%s%s", extra ? headers : "",
+                         extra ? "\r\n" : "", validators) < 0) {
+                conditional_headers = NULL;
+            }
+            free(validators);
+        }
+    }
+    
+    // Step 1: Initial request (no payment). A request with a body is probed
+    // without it first, so a paid request puts its body on the link once.
     int status_code;
     char *resp_headers = NULL;
     char *resp_body = NULL;
     size_t resp_body_len;
-    
-    ESP_LOGI(TAG, "Step 1: Initial request (no payment)");
-    err = http_request(url, method, headers, body,
-                      &status_code, &resp_headers, &resp_body, &resp_body_len);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Initial request failed");
-        return err;
-    }
-    
-    ESP_LOGI(TAG, "Response: %d", status_code);
-    
-    // Step 2: Check if payment required
-    if (!x402_is_payment_required(status_code)) {
-        ESP_LOGI(TAG, "No payment required, returning response");
-        response_out->status_code = status_code;
-        response_out->headers = resp_headers;
-        response_out->body = resp_body;
-        response_out->body_len = resp_body_len;
-        response_out->payment_made = false;
-        return ESP_OK;
+    x402_error_class_t error_class;
+    int probes = 0;
+    x402_payment_requirements_t requirements;
+    bool have_requirements = false;
+    
+    x402_probe_t probe = body && may_probe ? probe_for(url) : X402_PROBE_FULL;
+    if (probe != X402_PROBE_FULL) {
+        ESP_LOGI(TAG, "Step 1: Probe without body (%s)", probe == X402_PROBE_HEAD ? "HEAD" : "empty");
+        err = http_request_retry(url, probe == X402_PROBE_HEAD ? "HEAD" : method, headers, NULL,
+                                 &status_code, &resp_headers, &resp_body, &resp_body_len,
+                                 &error_class, &probes);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Probe request failed");
+            response_out->error_class = error_class;
+            return err;
+        }
+        
+        have_requirements = x402_is_payment_required(status_code) &&
+                            parse_requirements(resp_headers, resp_body, &requirements) == ESP_OK;
+        free(resp_headers);
+        free(resp_body);
+        resp_headers = NULL;
+        resp_body = NULL;
+        
+        if (!have_requirements) {
+            // Fall back to the full request, and skip the probe next time
+            ESP_LOGW(TAG, "Probe got %d without requirements, sending full request", status_code);
+            probe_unsupported(url);
+        }
     }
     
-    ESP_LOGI(TAG, "Step 2: 402 Payment Required detected");
-    
-    // Step 3: Parse payment requirements from response body
-    if (!resp_body) {
-        ESP_LOGE(TAG, "402 response has no body");
-        if (resp_headers) free(resp_headers);
-        return ESP_FAIL;
+    if (!have_requirements) {
+        ESP_LOGI(TAG, "Step 1: Initial request (no payment)");
+        err = http_request_retry(url, method, conditional_headers ? conditional_headers : headers, body,
+                                 &status_code, &resp_headers, &resp_body, &resp_body_len,
+                                 &error_class, &probes);
+        free(conditional_headers);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Initial request failed");
+            response_out->error_class = error_class;
+            return err;
+        }
+        
+        ESP_LOGI(TAG, "Response: %d", status_code);
+        
+        // Still valid: served from cache without paying again
+        if (status_code == 304 && cacheable &&
+            x402_cache_revalidated(payer, url, headers, resp_headers, response_out) == ESP_OK) {
+            ESP_LOGI(TAG, "Cached response revalidated, no payment");
+            free(resp_headers);
+            free(resp_body);
+            return ESP_OK;
+        }
+        
+        // Step 2: Check if payment required
+        if (!x402_is_payment_required(status_code)) {
+            ESP_LOGI(TAG, "No payment required, returning response");
+            response_out->status_code = status_code;
+            response_out->headers = resp_headers;
+            response_out->body = resp_body;
+            response_out->body_len = resp_body_len;
+            response_out->payment_made = false;
+            response_out->error_class = error_class;
+            return ESP_OK;
+        }
+        
+        ESP_LOGI(TAG, "Step 2: 402 Payment Required detected");
+        
+        // Step 3: Parse payment requirements from response
+        ESP_LOGI(TAG, "Parsing payment requirements");
+        err = parse_requirements(resp_headers, resp_body, &requirements);
+        
+        // Free initial response (we'll make a new one)
+        free(resp_headers);
+        free(resp_body);
+        resp_headers = NULL;
+        resp_body = NULL;
+        
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to parse payment requirements");
+            return err;
+        }
     }
     
-    ESP_LOGI(TAG, "Parsing payment requirements from body");
-    
-    x402_payment_requirements_t requirements;
-    err = x402_parse_payment_requirements(resp_body, &requirements);
-    
-    // Free initial response (we'll make a new one)
-    free(resp_headers);
-    free(resp_body);
-    resp_headers = NULL;
-    resp_body = NULL;
+    ESP_LOGI(TAG, "Step 3: Payment requirements parsed");
     
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to parse payment requirements");
-        return err;
+    // No fee payer in the requirements: ask the facilitator (cached)
+    const char *facilitator_url = x402_get_facilitator_url(&requirements);
+    if (!requirements.facilitator.fee_payer[0] && facilitator_url) {
+        x402_query_fee_payer(facilitator_url, requirements.network, requirements.facilitator.fee_payer,
+                             sizeof(requirements.facilitator.fee_payer));
     }
     
-    ESP_LOGI(TAG, "Step 3: Payment requirements parsed");
-    
     // Step 4: Create payment
     ESP_LOGI(TAG, "Step 4: Creating payment...");
     x402_payment_payload_t payload;
@@ -283,55 +493,102 @@ esp_err_t x402_fetch(
     
     ESP_LOGI(TAG, "Payment created successfully");
     
-    // Step 5: Encode payment payload (JSON → Base64)
-    char *payment_encoded = malloc(8192);
-    if (!payment_encoded) {
+    // Steps 5-7: Encode, send, and recover from what can be recovered without
+    // redoing the flow: transient API failures resend the same payment (when
+    // the request itself may be repeated), an expired blockhash re-signs it.
+    // The payment cannot be charged twice: same transaction, same signature,
+    // so it can only settle once.
+    char *retry_headers = bulk_alloc(16384);
+    if (!retry_headers) {
         x402_payment_free(&payload);
         return ESP_ERR_NO_MEM;
     }
     
-    err = x402_encode_payment_payload(&payload, payment_encoded, 8192);
-    x402_payment_free(&payload);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to encode payment");
-        free(payment_encoded);
-        return err;
-    }
-    
-    ESP_LOGI(TAG, "Step 5: Payment encoded");
-    ESP_LOGI(TAG, "X-PAYMENT header (first 100 chars): %.100s", payment_encoded);
-    ESP_LOGI(TAG, "X-PAYMENT header length: %zu bytes", strlen(payment_encoded));
-    
-    // Step 6: Build retry headers with X-PAYMENT
-    char *retry_headers = malloc(16384);
-    if (!retry_headers) {
+    for (int attempt = 1; ; attempt++) {
+        // Step 5: Encode payment payload (JSON → Base64)
+        char *payment_encoded = bulk_alloc(8192);
+        if (!payment_encoded) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        
+        err = x402_encode_payment_payload(&payload, payment_encoded, 8192);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to encode payment");
+            free(payment_encoded);
+            break;
+        }
+        
+        ESP_LOGI(TAG, "Step 5: Payment encoded");
+        ESP_LOGI(TAG, "X-PAYMENT header (first 100 chars): %.100s", payment_encoded);
+        ESP_LOGI(TAG, "X-PAYMENT header length: %zu bytes", strlen(payment_encoded));
+        
+        // Step 6: Build retry headers with X-PAYMENT
+        if (headers && headers[0]) {
+            snprintf(retry_headers, 16384, "%s\r\n%s: %s",
+                    headers, X402_HEADER_PAYMENT, payment_encoded);
+        } else {
+            snprintf(retry_headers, 16384, "%s: %s",
+                    X402_HEADER_PAYMENT, payment_encoded);
+        }
+        
         free(payment_encoded);
-        return ESP_ERR_NO_MEM;
-    }
-    
-    if (headers && headers[0]) {
-        snprintf(retry_headers, 16384, "%s\r\n%s: %s",
-                headers, X402_HEADER_PAYMENT, payment_encoded);
-    } else {
-        snprintf(retry_headers, 16384, "%s: %s",
-                X402_HEADER_PAYMENT, payment_encoded);
+        
+        // Step 7: Retry request with payment
+        ESP_LOGI(TAG, "Step 6: Retrying request with payment...");
+        err = http_request_retry(url, method, retry_headers, body,
+                                 &status_code, &resp_headers, &resp_body, &resp_body_len,
+                                 &error_class, &response_out->attempts);
+        if (err != ESP_OK || status_code != X402_STATUS_PAYMENT_REQUIRED) {
+            break;
+        }
+        
+        error_class = classify_rejection(resp_body);
+        if (error_class != X402_ERROR_BLOCKHASH_EXPIRED || attempt >= X402_MAX_ATTEMPTS) {
+            break;
+        }
+        
+        ESP_LOGW(TAG, "Payment rejected: blockhash expired, re-signing");
+        free(resp_headers);
+        free(resp_body);
+        resp_headers = NULL;
+        resp_body = NULL;
+        err = x402_payment_refresh_blockhash(wallet, &payload);
+        if (err != ESP_OK) {
+            break;
+        }
     }
     
-    free(payment_encoded);
-    
-    // Step 7: Retry request with payment
-    ESP_LOGI(TAG, "Step 6: Retrying request with payment...");
-    err = http_request(url, method, retry_headers, body,
-                      &status_code, &resp_headers, &resp_body, &resp_body_len);
-    
     free(retry_headers);
+    x402_payment_free(&payload);
+    response_out->error_class = error_class;
     
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Retry request failed");
         return err;
     }
     
+    // Rejected for a reason re-signing cannot fix, and nothing was settled.
+    // What is cached of the facilitator (fee payer, kinds) may be out of
+    // date: refresh it before paying again. Requirements from the body-less
+    // probe may not hold for the real request (e.g. priced by body): stop
+    // probing this URL. Either way, redo the flow once. Expired blockhashes
+    // and missing funds are neither's fault.
+    if (status_code == X402_STATUS_PAYMENT_REQUIRED && may_probe &&
+        error_class == X402_ERROR_FACILITATOR_REJECTED) {
+        bool refreshed = facilitator_url && x402_facilitator_refresh(facilitator_url) == ESP_OK;
+        if (have_requirements) {
+            probe_unsupported(url);
+        }
+        if (refreshed || have_requirements) {
+            ESP_LOGW(TAG, "Payment rejected, redoing with %s",
+                     refreshed ? "a refreshed facilitator" : "the full request");
+            free(resp_headers);
+            free(resp_body);
+            return fetch_once(wallet, url, method, headers, body, false, response_out);
+        }
+    }
+    
     ESP_LOGI(TAG, "Retry response: %d", status_code);
     
     // Log response headers for debugging
@@ -378,6 +635,10 @@ esp_err_t x402_fetch(
     response_out->body = resp_body;
     response_out->body_len = resp_body_len;
     
+    if (cacheable && response_out->payment_made) {
+        x402_cache_put(payer, url, headers, response_out);
+    }
+    
     if (status_code == 200) {
         ESP_LOGI(TAG, "=== ✓ x402 fetch successful! ===");
     } else if (status_code == 402) {
@@ -390,6 +651,108 @@ esp_err_t x402_fetch(
     return ESP_OK;
 }
 
+/**
+ * @brief Copy a response into a follower's (caller-owned) response
+ */
+static esp_err_t response_copy(const x402_response_t *src, x402_response_t *dst) {
+    *dst = *src;
+    dst->headers = NULL;
+    dst->body = NULL;
+    dst->coalesced = true;
+    if (src->headers && !(dst->headers = strdup(src->headers))) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (src->body) {
+        dst->body = bulk_alloc(src->body_len + 1);
+        if (!dst->body) {
+            x402_response_free(dst);
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(dst->body, src->body, src->body_len);
+        dst->body[src->body_len] = '\0';
+    }
+    return ESP_OK;
+}
+
+esp_err_t x402_fetch_body(
+    solana_wallet_t *wallet,
+    const char *url,
+    const char *method,
+    const char *headers,
+    const x402_body_t *body,
+    x402_response_t *response_out
+) {
+    if (!wallet || !url || !method || !response_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (body && !body->read && !body->len) {
+        body = NULL;    // Empty body: nothing to send or probe for
+    }
+    if (body && !body->read && !body->data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memset(response_out, 0, sizeof(x402_response_t));
+    
+    // Streamed bodies cannot be hashed, and only idempotent methods may
+    // answer several callers with one request (and one payment)
+    bool coalesce = !(body && body->read) &&
+                    (strcmp(method, "GET") == 0 || strcmp(method, "HEAD") == 0 ||
+                     strcmp(method, "PUT") == 0 || strcmp(method, "DELETE") == 0);
+    if (!coalesce) {
+        return fetch_once(wallet, url, method, headers, body, true, response_out);
+    }
+    sync_once(&s_flight_once, flight_init, NULL);
+    
+    // Per wallet: one payer's response must not answer (or charge) another
+    uint8_t pubkey[32];
+    if (solana_wallet_get_pubkey(wallet, pubkey) != ESP_OK) {
+        return fetch_once(wallet, url, method, headers, body, true, response_out);
+    }
+    uint64_t key = fnv1a64(0xcbf29ce484222325ULL, pubkey, sizeof(pubkey));
+    key = fnv1a64(key, method, strlen(method) + 1);
+    key = fnv1a64(key, url, strlen(url) + 1);
+    key = fnv1a64(key, headers ? headers : "", headers ? strlen(headers) + 1 : 1);
+    key = body ? fnv1a64(key, body->data, body->len) : key;
+    key = key ? key : 1;
+    
+    fetch_follower_t follower = { .out = response_out, .err = ESP_OK };
+    bool follow;
+    portENTER_CRITICAL(&s_flight_lock);
+    int slot = sync_flight_join(s_flights, X402_MAX_INFLIGHT, X402_MAX_FOLLOWERS, key, &follower, &follow);
+    portEXIT_CRITICAL(&s_flight_lock);
+    
+    if (follow) {
+        ESP_LOGI(TAG, "Joining identical in-flight fetch: %s %s", method, url);
+        sync_flight_wait(&s_flights[slot]);
+        flight_release(&s_flights[slot]);
+        return follower.err;
+    }
+    
+    // No slot free: fetch uncoalesced
+    esp_err_t err = fetch_once(wallet, url, method, headers, body, true, response_out);
+    
+    if (slot >= 0) {
+        sync_flight_t *leader = &s_flights[slot];
+        portENTER_CRITICAL(&s_flight_lock);
+        int followers = sync_flight_finish(leader);    // No more joins
+        portEXIT_CRITICAL(&s_flight_lock);
+        
+        // Fill every follower before waking any: they take tokens in any order
+        for (int i = 0; i < followers; i++) {
+            fetch_follower_t *f = (fetch_follower_t *)leader->follower_arg[i];
+            esp_err_t copy_err = response_copy(response_out, f->out);
+            f->err = err != ESP_OK ? err : copy_err;
+        }
+        sync_flight_wake(leader, followers);
+        if (followers) {
+            ESP_LOGI(TAG, "Response shared with %d identical fetches", followers);
+        }
+        flight_release(leader);
+    }
+    return err;
+}
+
 void x402_response_free(x402_response_t *response) {
     if (!response) {
         return;
@@ -22,11 +22,30 @@ extern "C" {
  * 7. Parse X-PAYMENT-RESPONSE header
  * 8. Return final response
  * 
+ * Failures are recovered with the least work that fixes them: transport
+ * errors, 502/503/504 and 429 (after Retry-After) resend only the failed
+ * request, with jittered backoff; a payment rejected for an expired
+ * blockhash is re-signed with a fresh one and resent. Up to
+ * X402_MAX_ATTEMPTS tries each; response_out->error_class tells what
+ * finally failed.
+ * 
+ * A request with a body is first probed without it (see
+ * x402_set_body_probe()), so a paid request uploads its body once. When the
+ * probe does not produce payment requirements, or the payment made for them
+ * is rejected with another 402, the full request is sent as before (and
+ * paid for again in the second case) and the URL is not probed again.
+ * 
+ * Identical concurrent fetches (same wallet, method, URL, headers and
+ * body) of an idempotent method share one request and one payment: later
+ * callers wait for the first and get a copy of its response, with
+ * coalesced set.
+ * 
  * @param wallet User wallet for signing payments
  * @param url API endpoint URL
  * @param method HTTP method ("GET", "POST", etc.)
  * @param headers Optional additional headers (can be NULL)
- * @param body Optional request body (can be NULL)
+ * @param body Optional request body, NUL-terminated text (can be NULL;
+ *             see x402_fetch_body() for binary or streamed bodies)
  * @param response_out Output: complete x402 response
  * @return ESP_OK on success
  */
@@ -39,6 +58,42 @@ esp_err_t x402_fetch(
     x402_response_t *response_out
 );
 
+/**
+ * @brief x402_fetch with a binary or streamed request body
+ * 
+ * Same flow as x402_fetch(). The body may contain zero bytes, and with
+ * body->read it is pulled in pieces while it is sent, so it does not have
+ * to fit in contiguous heap and upload can start before capture finishes.
+ * A streamed body is read once per request sent; with the body-less probe
+ * a paid fetch normally sends it once.
+ * 
+ * @param wallet User wallet for signing payments
+ * @param url API endpoint URL
+ * @param method HTTP method ("GET", "POST", etc.)
+ * @param headers Optional additional headers (can be NULL)
+ * @param body Optional request body (can be NULL)
+ * @param response_out Output: complete x402 response
+ * @return ESP_OK on success
+ */
+esp_err_t x402_fetch_body(
+    solana_wallet_t *wallet,
+    const char *url,
+    const char *method,
+    const char *headers,
+    const x402_body_t *body,
+    x402_response_t *response_out
+);
+
+/**
+ * @brief Choose how x402_fetch probes requests that have a body
+ * 
+ * X402_PROBE_EMPTY reaches the handler with an empty body if the endpoint
+ * turns out to be free, so use it only for endpoints known to be paid.
+ * 
+ * @param probe Probe kind (default X402_BODY_PROBE)
+ */
+void x402_set_body_probe(x402_probe_t probe);
+
 /**
  * @brief Free x402 response resources
  * 
@@ -0,0 +1,495 @@
+#include "x402_facilitator.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "http_transport.h"
+#include "sync_util.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cJSON.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "x402_facilitator";
+
+/**
+ * @brief Kinds of one facilitator (also the NVS blob)
+ */
+typedef struct {
+    char url[X402_FACILITATOR_MAX_URL_LEN];     // "" = unused
+    uint32_t count;
+    x402_facilitator_info_t kinds[X402_FACILITATOR_MAX_KINDS];
+} facilitator_kinds_t;
+
+/**
+ * @brief Cached /supported answer for one facilitator
+ */
+typedef struct {
+    facilitator_kinds_t data;
+    int64_t expires_us;         // 0 after a restore: usable, refreshed at once
+    int64_t last_used_us;
+} facilitator_entry_t;
+
+typedef esp_err_t (*entry_fn_t)(const facilitator_kinds_t *kinds, void *arg);
+
+static facilitator_entry_t s_entries[X402_FACILITATOR_CACHE_SIZE];
+static x402_facilitator_stats_t s_stats;
+static TaskHandle_t s_refresh_task;
+static bool s_refresh_starting;
+static sync_once_t s_restore_once = SYNC_ONCE_INIT;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief GET <url>/supported and collect its kinds
+ */
+static esp_err_t fetch_supported(const char *facilitator_url, facilitator_kinds_t *out) {
+    char *url;
+    if (asprintf(&url, "%s/supported", facilitator_url) < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Content-Length is not required: chunked bodies are collected the same way
+    http_transport_request_t request = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 10000,
+        .max_response = X402_FACILITATOR_MAX_RESPONSE,
+    };
+    http_transport_response_t http_response;
+    esp_err_t err = http_transport_perform(&request, &http_response);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "GET %s failed: %s", url, esp_err_to_name(err));
+        http_transport_response_free(&http_response);
+        free(url);
+        return err;
+    }
+    if (http_response.status_code != 200 || !http_response.body) {
+        ESP_LOGE(TAG, "%s returned status %d", url, http_response.status_code);
+        http_transport_response_free(&http_response);
+        free(url);
+        return ESP_FAIL;
+    }
+    free(url);
+
+    // Expected: {"kinds":[{"x402Version":1,"scheme":"exact","network":"solana-devnet","extra":{"feePayer":"..."}}]}
+    cJSON *root = cJSON_ParseWithLength(http_response.body, http_response.body_len);
+    http_transport_response_free(&http_response);
+    cJSON *kinds = root ? cJSON_GetObjectItem(root, "kinds") : NULL;
+    if (!cJSON_IsArray(kinds)) {
+        ESP_LOGE(TAG, "No kinds in /supported response");
+        cJSON_Delete(root);
+        return ESP_FAIL;
+    }
+
+    memset(out, 0, sizeof(*out));
+    snprintf(out->url, sizeof(out->url), "%s", facilitator_url);     // Not stored if truncated
+    cJSON *kind = NULL;
+    cJSON_ArrayForEach(kind, kinds) {
+        if (out->count == X402_FACILITATOR_MAX_KINDS) {
+            ESP_LOGW(TAG, "%s supports more than %d kinds, keeping the first",
+                     facilitator_url, X402_FACILITATOR_MAX_KINDS);
+            break;
+        }
+        cJSON *version = cJSON_GetObjectItem(kind, "x402Version");
+        cJSON *scheme = cJSON_GetObjectItem(kind, "scheme");
+        cJSON *network = cJSON_GetObjectItem(kind, "network");
+        cJSON *extra = cJSON_GetObjectItem(kind, "extra");
+        cJSON *fee_payer = extra ? cJSON_GetObjectItem(extra, "feePayer") : NULL;
+        if (!cJSON_IsString(network)) {
+            continue;
+        }
+        x402_facilitator_info_t *info = &out->kinds[out->count++];
+        info->x402_version = cJSON_IsNumber(version) ? version->valueint : X402_VERSION;
+        snprintf(info->scheme, sizeof(info->scheme), "%s",
+                 cJSON_IsString(scheme) ? scheme->valuestring : "");
+        snprintf(info->network, sizeof(info->network), "%s", network->valuestring);
+        snprintf(info->fee_payer, sizeof(info->fee_payer), "%s",
+                 cJSON_IsString(fee_payer) ? fee_payer->valuestring : "");
+    }
+    cJSON_Delete(root);
+
+    ESP_LOGI(TAG, "%s supports %lu kinds", facilitator_url, (unsigned long)out->count);
+    return ESP_OK;
+}
+
+static void persist(int slot, const facilitator_kinds_t *kinds) {
+    nvs_handle_t nvs;
+    if (nvs_open(X402_FACILITATOR_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;     // NVS not initialized: RAM only
+    }
+    char key[8];
+    snprintf(key, sizeof(key), "f%d", slot);
+    if (nvs_set_blob(nvs, key, kinds, sizeof(*kinds)) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+static void forget(int slot) {
+    nvs_handle_t nvs;
+    if (nvs_open(X402_FACILITATOR_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    char key[8];
+    snprintf(key, sizeof(key), "f%d", slot);
+    if (nvs_erase_key(nvs, key) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+/**
+ * @brief Load persisted entries; they are served at once and refreshed
+ *
+ * @return Number of entries restored
+ */
+static int restore(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(X402_FACILITATOR_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return 0;
+    }
+    facilitator_kinds_t *blob = malloc(sizeof(*blob));
+    int restored = 0;
+    for (int i = 0; blob && i < X402_FACILITATOR_CACHE_SIZE; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "f%d", i);
+        size_t len = sizeof(*blob);
+        if (nvs_get_blob(nvs, key, blob, &len) != ESP_OK || len != sizeof(*blob) ||
+            !blob->url[0] || blob->count > X402_FACILITATOR_MAX_KINDS) {
+            continue;   // Missing, or written by a build with other limits
+        }
+        blob->url[sizeof(blob->url) - 1] = '\0';
+        portENTER_CRITICAL(&s_lock);
+        s_entries[i].data = *blob;
+        s_entries[i].expires_us = 0;
+        s_stats.restored++;
+        portEXIT_CRITICAL(&s_lock);
+        restored++;
+    }
+    free(blob);
+    nvs_close(nvs);
+    return restored;
+}
+
+static facilitator_entry_t *entry_find(const char *url) {
+    for (int i = 0; i < X402_FACILITATOR_CACHE_SIZE; i++) {
+        if (strcmp(s_entries[i].data.url, url) == 0) {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find or take over (empty, then least recently used) an entry
+ */
+static facilitator_entry_t *entry_claim(const char *url) {
+    facilitator_entry_t *e = entry_find(url);
+    if (e) {
+        return e;
+    }
+    e = &s_entries[0];
+    for (int i = 0; i < X402_FACILITATOR_CACHE_SIZE; i++) {
+        if (!s_entries[i].data.url[0]) {
+            e = &s_entries[i];
+            break;
+        }
+        if (s_entries[i].last_used_us < e->last_used_us) {
+            e = &s_entries[i];
+        }
+    }
+    return e;
+}
+
+/**
+ * @brief Fetch a facilitator's kinds and store them (RAM and NVS)
+ *
+ * @param refresh Only update an entry that still exists (not flushed or evicted)
+ */
+static esp_err_t fetch_and_store(const char *url, bool refresh) {
+    facilitator_kinds_t *kinds = malloc(sizeof(*kinds));
+    if (!kinds) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = fetch_supported(url, kinds);
+    int64_t now = esp_timer_get_time();
+    int slot = -1;
+
+    portENTER_CRITICAL(&s_lock);
+    facilitator_entry_t *e = refresh ? entry_find(url) : entry_claim(url);
+    if (err != ESP_OK) {
+        s_stats.failures++;
+        if (e && refresh) {
+            // Keep the last known kinds; try again after X402_FACILITATOR_RETRY_MS
+            e->expires_us = now + (X402_FACILITATOR_REFRESH_AHEAD_MS + X402_FACILITATOR_RETRY_MS) * 1000LL;
+        }
+    } else if (e) {
+        // Flash is only written when the kinds changed (refreshes mostly
+        // bring back what is already stored)
+        if (memcmp(&e->data, kinds, sizeof(*kinds)) != 0) {
+            slot = e - s_entries;
+        }
+        e->data = *kinds;
+        e->expires_us = now + X402_FACILITATOR_TTL_MS * 1000LL;
+        e->last_used_us = refresh ? e->last_used_us : now;
+        if (refresh) {
+            s_stats.refreshes++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (slot >= 0) {
+        persist(slot, kinds);
+    }
+    free(kinds);
+    return err;
+}
+
+/**
+ * @brief Re-fetch entries that are about to expire (or were restored)
+ */
+static void refresh_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(X402_FACILITATOR_RETRY_MS));
+
+        for (int i = 0; i < X402_FACILITATOR_CACHE_SIZE; i++) {
+            char url[X402_FACILITATOR_MAX_URL_LEN];
+            bool due;
+
+            portENTER_CRITICAL(&s_lock);
+            facilitator_entry_t *e = &s_entries[i];
+            due = e->data.url[0] &&
+                  esp_timer_get_time() >= e->expires_us - X402_FACILITATOR_REFRESH_AHEAD_MS * 1000LL;
+            strcpy(url, e->data.url);
+            portEXIT_CRITICAL(&s_lock);
+
+            if (due) {
+                ESP_LOGD(TAG, "Refreshing %s", url);
+                fetch_and_store(url, true);
+            }
+        }
+    }
+}
+
+static void refresh_task_wake(bool notify) {
+    bool start = false;
+    portENTER_CRITICAL(&s_lock);
+    if (!s_refresh_task && !s_refresh_starting) {
+        s_refresh_starting = true;
+        start = true;
+    }
+    TaskHandle_t task = s_refresh_task;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (start) {
+        TaskHandle_t created = NULL;
+        if (xTaskCreate(refresh_task, "x402_fac", X402_FACILITATOR_TASK_STACK_SIZE,
+                        NULL, tskIDLE_PRIORITY + 1, &created) != pdPASS) {
+            ESP_LOGW(TAG, "Refresh task unavailable, entries refresh on expiry only");
+            created = NULL;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_refresh_task = created;
+        s_refresh_starting = false;
+        portEXIT_CRITICAL(&s_lock);
+        task = created;
+    }
+
+    if (notify && task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void restore_init(void *arg) {
+    int restored = restore();
+    if (restored) {
+        ESP_LOGI(TAG, "Restored %d facilitators from flash", restored);
+        refresh_task_wake(true);
+    }
+}
+
+/**
+ * @brief Run fn on freshly fetched kinds of a URL too long to cache
+ */
+static esp_err_t with_uncached(const char *url, entry_fn_t fn, void *arg) {
+    facilitator_kinds_t *kinds = malloc(sizeof(*kinds));
+    if (!kinds) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = fetch_supported(url, kinds);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.misses++;
+    if (err != ESP_OK) {
+        s_stats.failures++;
+    } else {
+        err = fn(kinds, arg);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    free(kinds);
+    return err;
+}
+
+/**
+ * @brief Run fn on the kinds of url under the lock, fetching them first if needed
+ *
+ * fn runs in a critical section: copy what is needed and return.
+ */
+static esp_err_t with_entry(const char *url, entry_fn_t fn, void *arg) {
+    if (strlen(url) >= X402_FACILITATOR_MAX_URL_LEN) {
+        return with_uncached(url, fn, arg);
+    }
+    sync_once(&s_restore_once, restore_init, NULL);
+
+    for (int pass = 0; ; pass++) {
+        int64_t now = esp_timer_get_time();
+        esp_err_t err = ESP_ERR_NOT_FOUND;
+        bool found = false;
+        bool wake = false;
+
+        portENTER_CRITICAL(&s_lock);
+        facilitator_entry_t *e = entry_find(url);
+        if (e) {
+            found = true;
+            e->last_used_us = now;
+            wake = now >= e->expires_us - X402_FACILITATOR_REFRESH_AHEAD_MS * 1000LL;
+            err = fn(&e->data, arg);
+            if (pass == 0) {
+                s_stats.hits++;
+            }
+        } else if (pass == 0) {
+            s_stats.misses++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (found || pass == 1) {
+            if (wake) {
+                refresh_task_wake(true);
+            }
+            return err;     // pass 1 and not found: evicted right after storing
+        }
+
+        esp_err_t fetch_err = fetch_and_store(url, false);
+        if (fetch_err != ESP_OK) {
+            return fetch_err;
+        }
+        refresh_task_wake(false);
+    }
+}
+
+typedef struct {
+    x402_facilitator_info_t *out;
+    size_t max;
+    size_t *count;
+} copy_kinds_arg_t;
+
+static esp_err_t copy_kinds(const facilitator_kinds_t *kinds, void *arg) {
+    copy_kinds_arg_t *a = (copy_kinds_arg_t *)arg;
+    size_t n = kinds->count < a->max ? kinds->count : a->max;
+    memcpy(a->out, kinds->kinds, n * sizeof(x402_facilitator_info_t));
+    *a->count = n;
+    return ESP_OK;
+}
+
+esp_err_t x402_facilitator_get_kinds(
+    const char *facilitator_url,
+    x402_facilitator_info_t *kinds_out,
+    size_t max_kinds,
+    size_t *count_out
+) {
+    if (!facilitator_url || !kinds_out || !count_out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count_out = 0;
+    copy_kinds_arg_t arg = { kinds_out, max_kinds, count_out };
+    return with_entry(facilitator_url, copy_kinds, &arg);
+}
+
+typedef struct {
+    const char *scheme;
+    const char *network;
+    char *out;
+    size_t max_len;
+} fee_payer_arg_t;
+
+static esp_err_t find_fee_payer(const facilitator_kinds_t *kinds, void *arg) {
+    fee_payer_arg_t *a = (fee_payer_arg_t *)arg;
+    for (uint32_t i = 0; i < kinds->count; i++) {
+        const x402_facilitator_info_t *k = &kinds->kinds[i];
+        if (strcmp(k->network, a->network) == 0 && k->fee_payer[0] &&
+            (!a->scheme || strcmp(k->scheme, a->scheme) == 0)) {
+            snprintf(a->out, a->max_len, "%s", k->fee_payer);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t x402_facilitator_get_fee_payer(
+    const char *facilitator_url,
+    const char *scheme,
+    const char *network,
+    char *fee_payer_out,
+    size_t max_len
+) {
+    if (!facilitator_url || !network || !fee_payer_out || !max_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fee_payer_arg_t arg = { scheme, network, fee_payer_out, max_len };
+    esp_err_t err = with_entry(facilitator_url, find_fee_payer, &arg);
+    if (err == ESP_ERR_NOT_FOUND) {
+        ESP_LOGE(TAG, "Network %s not supported by %s", network, facilitator_url);
+    }
+    return err;
+}
+
+esp_err_t x402_facilitator_refresh(const char *facilitator_url) {
+    if (!facilitator_url) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(facilitator_url) >= X402_FACILITATOR_MAX_URL_LEN) {
+        return ESP_OK;      // Never cached: every lookup fetches anyway
+    }
+    sync_once(&s_restore_once, restore_init, NULL);
+
+    esp_err_t err = fetch_and_store(facilitator_url, false);
+    int slot = -1;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.forced++;
+    facilitator_entry_t *e = err != ESP_OK ? entry_find(facilitator_url) : NULL;
+    if (e) {
+        slot = e - s_entries;
+        memset(e, 0, sizeof(*e));
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (slot >= 0) {
+        ESP_LOGW(TAG, "Dropped %s: %s", facilitator_url, esp_err_to_name(err));
+        forget(slot);
+    } else if (err == ESP_OK) {
+        refresh_task_wake(false);
+    }
+    return err;
+}
+
+void x402_facilitator_get_stats(x402_facilitator_stats_t *stats_out) {
+    if (!stats_out) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats_out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void x402_facilitator_flush(void) {
+    portENTER_CRITICAL(&s_lock);
+    memset(s_entries, 0, sizeof(s_entries));
+    portEXIT_CRITICAL(&s_lock);
+
+    nvs_handle_t nvs;
+    if (nvs_open(X402_FACILITATOR_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_all(nvs);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef X402_FACILITATOR_H
+#define X402_FACILITATOR_H
+
+#include "x402_types.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define X402_FACILITATOR_CACHE_SIZE 4               // Facilitators remembered
+#define X402_FACILITATOR_MAX_KINDS 8                // (scheme, network, feePayer) tuples each
+#define X402_FACILITATOR_MAX_URL_LEN 128            // Longer facilitator URLs are not cached
+#define X402_FACILITATOR_MAX_RESPONSE 16384         // /supported body limit
+#define X402_FACILITATOR_TTL_MS 3600000             // Entry lifetime
+#define X402_FACILITATOR_REFRESH_AHEAD_MS 300000    // Refresh this long before expiry
+#define X402_FACILITATOR_RETRY_MS 60000             // Wait after a failed refresh
+#define X402_FACILITATOR_TASK_STACK_SIZE 8192       // Background refresh task (does TLS)
+#define X402_FACILITATOR_NVS_NAMESPACE "x402_fac"   // Persisted entries
+
+/**
+ * @brief Facilitator cache counters
+ */
+typedef struct {
+    uint32_t hits;          // Answered from RAM
+    uint32_t misses;        // Lookups that blocked on /supported (uncached URLs included)
+    uint32_t refreshes;     // Background refreshes that succeeded
+    uint32_t failures;      // Fetches (blocking or background) that failed
+    uint32_t restored;      // Entries loaded from flash at startup
+    uint32_t forced;        // Refreshes forced by x402_facilitator_refresh
+} x402_facilitator_stats_t;
+
+/**
+ * @brief Get every kind a facilitator supports
+ *
+ * The first lookup of a facilitator fetches <url>/supported (chunked or not)
+ * and keeps all of its (scheme, network, feePayer) tuples. Later lookups are
+ * answered from RAM: a background task refreshes entries before they expire
+ * and keeps the last known kinds if a refresh fails. Entries are saved to
+ * NVS (when nvs_flash is initialized), so after a reboot they are served
+ * at once and refreshed in the background. URLs of X402_FACILITATOR_MAX_URL_LEN
+ * characters or more are fetched on every lookup instead of cached.
+ *
+ * @param facilitator_url Facilitator base URL
+ * @param kinds_out Output: supported kinds
+ * @param max_kinds Capacity of kinds_out
+ * @param count_out Output: number of kinds written
+ * @return ESP_OK on success, or the error of the /supported request
+ */
+esp_err_t x402_facilitator_get_kinds(
+    const char *facilitator_url,
+    x402_facilitator_info_t *kinds_out,
+    size_t max_kinds,
+    size_t *count_out
+);
+
+/**
+ * @brief Look up the fee payer a facilitator uses for a network
+ *
+ * @param facilitator_url Facilitator base URL
+ * @param scheme Payment scheme (e.g. "exact"), or NULL for any
+ * @param network Network name (e.g. "solana-devnet")
+ * @param fee_payer_out Output: fee payer address (Base58)
+ * @param max_len Size of fee_payer_out
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the facilitator does not
+ *         support the network or names no fee payer for it
+ */
+esp_err_t x402_facilitator_get_fee_payer(
+    const char *facilitator_url,
+    const char *scheme,
+    const char *network,
+    char *fee_payer_out,
+    size_t max_len
+);
+
+/**
+ * @brief Re-fetch a facilitator's kinds now, ignoring its TTL
+ *
+ * For a facilitator that rejected a payment: what is cached for it (fee
+ * payer, kinds) may be out of date. The entry is replaced by a fresh
+ * /supported answer; if that fetch fails it is dropped, in RAM and in NVS,
+ * so the next lookup fetches again instead of serving the old kinds.
+ *
+ * @param facilitator_url Facilitator base URL
+ * @return ESP_OK on success, or the error of the /supported request
+ */
+esp_err_t x402_facilitator_refresh(const char *facilitator_url);
+
+/**
+ * @brief Get facilitator cache counters
+ *
+ * @param stats_out Output: counters since boot
+ */
+void x402_facilitator_get_stats(x402_facilitator_stats_t *stats_out);
+
+/**
+ * @brief Drop all entries, in RAM and in NVS
+ */
+void x402_facilitator_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // X402_FACILITATOR_H
@@ -4,14 +4,17 @@
 #include "spl_token.h"
 #include "base58.h"
 #include "solana_rpc.h"
+#include "solana_tx.h"
+#include "bulk_mem.h"
 #include "esp_log.h"
 #include "mbedtls/base64.h"
-#include <cJSON.h>
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "x402_payment";
 
+#define TX_BASE64_SIZE 4096     // payload.transaction buffer
+
 // Global RPC client for blockhash queries
 static solana_rpc_handle_t g_rpc_client = NULL;
 
@@ -63,49 +66,13 @@ esp_err_t x402_build_payment_transaction(
         return err;
     }
     
-    solana_rpc_response_t rpc_response;
-    err = solana_rpc_get_latest_blockhash(g_rpc_client, &rpc_response);
-    if (err != ESP_OK || !rpc_response.success) {
-        ESP_LOGE(TAG, "Failed to get recent blockhash");
-        if (err == ESP_OK) {
-            solana_rpc_free_response(&rpc_response);
-        }
-        return ESP_FAIL;
-    }
-    
-    // Parse blockhash from JSON response
-    cJSON *root = cJSON_Parse(rpc_response.data);
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse blockhash response");
-        solana_rpc_free_response(&rpc_response);
-        return ESP_FAIL;
-    }
-    
-    cJSON *result = cJSON_GetObjectItem(root, "result");
-    cJSON *value = cJSON_GetObjectItem(result, "value");
-    cJSON *blockhash_json = cJSON_GetObjectItem(value, "blockhash");
-    
-    if (!cJSON_IsString(blockhash_json)) {
-        ESP_LOGE(TAG, "Invalid blockhash in response");
-        cJSON_Delete(root);
-        solana_rpc_free_response(&rpc_response);
-        return ESP_FAIL;
-    }
-    
-    // Decode blockhash from Base58
     uint8_t blockhash[32];
-    size_t blockhash_len;
-    if (!base58_decode(blockhash_json->valuestring, blockhash, &blockhash_len, sizeof(blockhash)) || 
-        blockhash_len != 32) {
-        ESP_LOGE(TAG, "Failed to decode blockhash");
-        cJSON_Delete(root);
-        solana_rpc_free_response(&rpc_response);
-        return ESP_FAIL;
+    err = solana_rpc_get_blockhash(g_rpc_client, blockhash, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to get recent blockhash");
+        return err;
     }
     
-    cJSON_Delete(root);
-    solana_rpc_free_response(&rpc_response);
-    
     ESP_LOGI(TAG, "Building SPL token transfer transaction...");
     
     // Build SPL token transfer transaction with fee payer
@@ -280,14 +247,14 @@ esp_err_t x402_create_solana_payment(
     ESP_LOGI(TAG, "Transaction signed successfully");
     
     // Step 8: Base64 encode transaction
-    char *tx_b64 = malloc(4096);
+    char *tx_b64 = bulk_alloc(TX_BASE64_SIZE);
     if (!tx_b64) {
         ESP_LOGE(TAG, "Failed to allocate base64 buffer");
         return ESP_ERR_NO_MEM;
     }
     
     size_t tx_b64_len;
-    err = x402_base64_encode(tx_data, tx_len, tx_b64, 4096, &tx_b64_len);
+    err = x402_base64_encode(tx_data, tx_len, tx_b64, TX_BASE64_SIZE, &tx_b64_len);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to encode transaction");
         free(tx_b64);
@@ -311,6 +278,77 @@ esp_err_t x402_create_solana_payment(
     return ESP_OK;
 }
 
+esp_err_t x402_payment_refresh_blockhash(
+    solana_wallet_t *wallet,
+    x402_payment_payload_t *payload
+) {
+    if (!wallet || !payload || !payload->payload.transaction) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t err = ensure_rpc_client();
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    uint8_t tx_data[2048];
+    size_t tx_len;
+    const char *tx_b64 = payload->payload.transaction;
+    if (mbedtls_base64_decode(tx_data, sizeof(tx_data), &tx_len,
+                              (const unsigned char *)tx_b64, strlen(tx_b64)) != 0) {
+        ESP_LOGE(TAG, "Failed to decode payment transaction");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    solana_tx_wire_layout_t layout;
+    err = solana_tx_wire_parse(tx_data, tx_len, &layout);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Malformed payment transaction");
+        return err;
+    }
+    
+    // Find our signature slot among the signers
+    uint8_t wallet_pubkey[32];
+    solana_wallet_get_pubkey(wallet, wallet_pubkey);
+    size_t slot = 0;
+    while (slot < layout.required_signatures &&
+           memcmp(tx_data + layout.accounts_offset + slot * 32, wallet_pubkey, 32) != 0) {
+        slot++;
+    }
+    if (slot == layout.required_signatures) {
+        ESP_LOGE(TAG, "Wallet is not a signer of the payment transaction");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint8_t blockhash[32];
+    err = solana_rpc_get_blockhash(g_rpc_client, blockhash, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to get recent blockhash");
+        return err;
+    }
+    
+    // New message: every signature is void, the fee payer signs at settlement
+    memcpy(tx_data + layout.blockhash_offset, blockhash, 32);
+    memset(tx_data + layout.signatures_offset, 0, layout.signature_count * 64);
+    err = solana_wallet_sign(wallet, tx_data + layout.message_offset, tx_len - layout.message_offset,
+                             tx_data + layout.signatures_offset + slot * 64);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to sign transaction");
+        return err;
+    }
+    
+    // Same length, so it fits the buffer it came from
+    size_t tx_b64_len;
+    err = x402_base64_encode(tx_data, tx_len, payload->payload.transaction, TX_BASE64_SIZE, &tx_b64_len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to encode transaction");
+        return err;
+    }
+    
+    ESP_LOGI(TAG, "✓ Payment re-signed with a fresh blockhash");
+    return ESP_OK;
+}
+
 void x402_payment_free(x402_payment_payload_t *payload) {
     if (payload && payload->payload.transaction) {
         free(payload->payload.transaction);
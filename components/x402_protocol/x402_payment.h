@@ -56,6 +56,22 @@ esp_err_t x402_build_payment_transaction(
     size_t max_tx_len
 );
 
+/**
+ * @brief Give a payment a fresh blockhash and sign it again
+ * 
+ * Recovery for a facilitator that rejected the payment because its
+ * blockhash expired: only the blockhash and our signature change, so the
+ * mint lookup, ATA derivation and transaction build are not repeated.
+ * 
+ * @param wallet Wallet that signed the payment
+ * @param payload Payment payload from x402_create_solana_payment (updated in place)
+ * @return ESP_OK on success
+ */
+esp_err_t x402_payment_refresh_blockhash(
+    solana_wallet_t *wallet,
+    x402_payment_payload_t *payload
+);
+
 /**
  * @brief Free resources allocated for payment payload
  * 
@@ -1,6 +1,6 @@
 #include "x402_requirements.h"
 #include "esp_log.h"
-#include "esp_http_client.h"
+#include "x402_facilitator.h"
 #include <cJSON.h>
 #include <string.h>
 #include <stdlib.h>
@@ -94,6 +94,15 @@ esp_err_t x402_parse_payment_requirements(
         }
     }
     
+    // Parse "facilitator.url" (optional: lets the client ask the facilitator
+    // for the fee payer, and refresh what it knows of it after a rejection)
+    cJSON *facilitator = cJSON_GetObjectItem(root, "facilitator");
+    cJSON *facilitatorUrl = cJSON_IsObject(facilitator) ? cJSON_GetObjectItem(facilitator, "url") : NULL;
+    if (facilitatorUrl && cJSON_IsString(facilitatorUrl)) {
+        strncpy(requirements_out->facilitator.url, facilitatorUrl->valuestring,
+                sizeof(requirements_out->facilitator.url) - 1);
+    }
+    
     cJSON_Delete(root);
     
     requirements_out->valid = true;
@@ -112,6 +121,9 @@ esp_err_t x402_parse_payment_requirements(
     if (requirements_out->facilitator.fee_payer[0]) {
         ESP_LOGI(TAG, "  Fee Payer: %s", requirements_out->facilitator.fee_payer);
     }
+    if (requirements_out->facilitator.url[0]) {
+        ESP_LOGI(TAG, "  Facilitator: %s", requirements_out->facilitator.url);
+    }
     
     return ESP_OK;
 }
@@ -162,116 +174,14 @@ esp_err_t x402_query_fee_payer(
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGI(TAG, "Querying facilitator /supported for fee payer...");
-    
-    // Build supported endpoint URL
-    char url[512];
-    snprintf(url, sizeof(url), "%s/supported", facilitator_url);
-    
-    // Setup HTTP client
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_GET,
-        .timeout_ms = 10000,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
-    }
-    
-    // Perform request
-    esp_err_t err = esp_http_client_perform(client);
+    // Answered from the facilitator cache; /supported is only fetched on a miss
+    esp_err_t err = x402_facilitator_get_fee_payer(facilitator_url, NULL, network,
+                                                   fee_payer_out, max_len);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP GET failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        return err;
-    }
-    
-    int status = esp_http_client_get_status_code(client);
-    if (status != 200) {
-        ESP_LOGE(TAG, "/supported returned status %d", status);
-        esp_http_client_cleanup(client);
-        return ESP_FAIL;
+        return err == ESP_ERR_NOT_FOUND ? ESP_FAIL : err;
     }
     
-    // Read response
-    int content_length = esp_http_client_get_content_length(client);
-    if (content_length <= 0 || content_length > 4096) {
-        ESP_LOGE(TAG, "Invalid content length: %d", content_length);
-        esp_http_client_cleanup(client);
-        return ESP_FAIL;
-    }
-    
-    char *response = malloc(content_length + 1);
-    if (!response) {
-        esp_http_client_cleanup(client);
-        return ESP_ERR_NO_MEM;
-    }
-    
-    int read_len = esp_http_client_read(client, response, content_length);
-    esp_http_client_cleanup(client);
-    
-    if (read_len != content_length) {
-        ESP_LOGW(TAG, "Read length mismatch: %d != %d", read_len, content_length);
-    }
-    response[read_len] = '\0';
-    
-    ESP_LOGD(TAG, "/supported response: %s", response);
-    
-    // Parse JSON response
-    // Expected: {"kinds":[{"x402Version":1,"scheme":"exact","network":"solana-devnet","extra":{"feePayer":"..."}}]}
-    cJSON *root = cJSON_Parse(response);
-    free(response);
-    
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse /supported JSON");
-        return ESP_FAIL;
-    }
-    
-    cJSON *kinds = cJSON_GetObjectItem(root, "kinds");
-    if (!cJSON_IsArray(kinds) || cJSON_GetArraySize(kinds) == 0) {
-        ESP_LOGE(TAG, "No kinds in /supported response");
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
-    
-    // Find matching kind for our network
-    bool found = false;
-    cJSON *kind = NULL;
-    cJSON_ArrayForEach(kind, kinds) {
-        cJSON *kind_network = cJSON_GetObjectItem(kind, "network");
-        if (cJSON_IsString(kind_network) && 
-            strcmp(kind_network->valuestring, network) == 0) {
-            found = true;
-            break;
-        }
-    }
-    
-    if (!found) {
-        ESP_LOGE(TAG, "Network %s not supported by facilitator", network);
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
-    
-    // Extract feePayer from extra
-    cJSON *extra = cJSON_GetObjectItem(kind, "extra");
-    cJSON *fee_payer_json = cJSON_GetObjectItem(extra, "feePayer");
-    
-    if (!cJSON_IsString(fee_payer_json)) {
-        ESP_LOGE(TAG, "No feePayer in /supported response");
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
-    
-    // Copy fee payer address
-    strncpy(fee_payer_out, fee_payer_json->valuestring, max_len - 1);
-    fee_payer_out[max_len - 1] = '\0';
-    
-    cJSON_Delete(root);
-    
-    ESP_LOGI(TAG, "Fee payer from /supported: %s", fee_payer_out);
+    ESP_LOGD(TAG, "Fee payer for %s: %s", network, fee_payer_out);
     
     return ESP_OK;
 }
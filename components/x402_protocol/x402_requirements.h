@@ -64,7 +64,8 @@ esp_err_t x402_parse_price_to_amount(
  * @brief Query facilitator /supported endpoint for fee payer
  * 
  * Queries the facilitator's /supported endpoint to get the fee payer address
- * that will be used to pay transaction fees.
+ * that will be used to pay transaction fees. Answers come from the
+ * facilitator cache (see x402_facilitator.h) after the first query.
  * 
  * @param facilitator_url Facilitator base URL
  * @param network Network name (e.g., "solana-devnet")
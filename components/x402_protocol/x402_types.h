@@ -15,7 +15,19 @@ extern "C" {
 #define X402_VERSION 1
 #define X402_HEADER_PAYMENT "X-PAYMENT"
 #define X402_HEADER_PAYMENT_RESPONSE "X-PAYMENT-RESPONSE"
+#define X402_HEADER_PAYMENT_REQUIRED "PAYMENT-REQUIRED"   // Base64 requirements (body-less 402)
 #define X402_STATUS_PAYMENT_REQUIRED 402
+#define X402_ACCEPT_ENCODING false   // Ask servers for gzip/deflate bodies (inflated on receipt)
+#define X402_MAX_ATTEMPTS 3          // Tries per leg on transient failures / expired blockhash
+#define X402_RETRY_AFTER_MAX_MS 10000    // Longest Retry-After waited for before a leg is retried
+#define X402_BODY_PROBE X402_PROBE_HEAD  // Default probe for requests with a body
+#define X402_PROBE_CACHE_SIZE 8          // URLs remembered as not answering the probe
+#define X402_MAX_INFLIGHT 4              // Distinct fetches that can be coalesced at once
+#define X402_MAX_FOLLOWERS 8             // Callers that can join one in-flight fetch
+#define X402_CACHE_MAX_BYTES 65536       // Paid-response cache size (0 = disabled)
+#define X402_CACHE_MAX_ENTRIES 8         // Paid-response cache entries
+#define X402_CACHE_MAX_VALIDATOR_LEN 128 // Longest ETag / Last-Modified kept
+#define X402_CACHE_MAX_VARY_LEN 256      // Request header values a Vary entry is keyed on
 
 #define X402_SCHEME_EXACT "exact"
 #define X402_SCHEME_SPONSORED "sponsored"
@@ -24,6 +36,34 @@ extern "C" {
 #define X402_NETWORK_SOLANA_DEVNET "solana-devnet"
 #define X402_NETWORK_SOLANA_MAINNET "solana-mainnet"
 
+/**
+ * @brief How x402_fetch looks for a 402 before sending a request body
+ */
+typedef enum {
+    X402_PROBE_FULL = 0,    // Send the full request unpaid (body goes out twice if paid)
+    X402_PROBE_HEAD,        // HEAD: no side effects, needs requirements in a header
+    X402_PROBE_EMPTY,       // Same method, empty body: for endpoints known to be paid
+} x402_probe_t;
+
+/**
+ * @brief Pull callback for a streamed request body
+ * 
+ * Same contract as http_transport_body_reader_t: fill buf from offset,
+ * return bytes written, 0 at end of body, -1 on error. Every request of a
+ * fetch (fallback, paid leg, retries) reads again from offset 0.
+ */
+typedef int (*x402_body_reader_t)(void *ctx, size_t offset, uint8_t *buf, size_t max_len);
+
+/**
+ * @brief Request body: contiguous bytes, or pulled through a callback
+ */
+typedef struct {
+    const uint8_t *data;            // Contiguous body (binary-safe), or NULL to use read
+    size_t len;                     // Body length; with read, 0 = unknown (sent chunked)
+    x402_body_reader_t read;        // Pull callback for flash, PSRAM or live capture
+    void *read_ctx;                 // Passed to read
+} x402_body_t;
+
 /**
  * @brief Network-specific payload (part of PaymentPayload)
  * This is generic and works for Solana, Ethereum, etc.
@@ -84,6 +124,18 @@ typedef struct {
     char network[64];               // Network identifier
 } x402_settlement_response_t;
 
+/**
+ * @brief Why an x402 fetch failed, and so what a retry has to redo
+ */
+typedef enum {
+    X402_ERROR_NONE = 0,
+    X402_ERROR_TRANSPORT,               // No answer or 502/503/504 from the API
+    X402_ERROR_RATE_LIMITED,            // 429 from the API
+    X402_ERROR_BLOCKHASH_EXPIRED,       // Payment rejected: blockhash too old
+    X402_ERROR_INSUFFICIENT_FUNDS,      // Payment rejected: wallet cannot pay
+    X402_ERROR_FACILITATOR_REJECTED,    // Payment rejected for another reason
+} x402_error_class_t;
+
 /**
  * @brief Complete x402 Response
  */
@@ -94,6 +146,10 @@ typedef struct {
     size_t body_len;                // Length of body
     bool payment_made;              // True if we made a payment
     x402_settlement_response_t settlement;  // Payment details (if payment_made)
+    x402_error_class_t error_class; // Last failure after recovery attempts (NONE on success)
+    int attempts;                   // Requests sent for the paid leg (0 if no payment)
+    bool from_cache;                // Served by the paid-response cache (no payment made now)
+    bool coalesced;                 // Copy of an identical concurrent fetch's response (it paid)
 } x402_response_t;
 
 /**
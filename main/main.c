@@ -6,10 +6,13 @@
  */
 
  #include <stdio.h>
+ #include <stdlib.h>
  #include <string.h>
  #include "freertos/FreeRTOS.h"
  #include "freertos/task.h"
  #include "esp_system.h"
+ #include "esp_timer.h"
+ #include "esp_random.h"
  #include "esp_log.h"
  #include "nvs_flash.h"
  #include "tweetnacl.h"
@@ -21,6 +24,9 @@
  #include "x402_client.h"
  #include "x402_types.h"
  #include "spl_token.h"
+ #include "http_transport.h"
+ #include "http_transport_dns.h"
+ #include "bulk_mem.h"
  #include "test_keypair.h"
  
  static const char *TAG = "SOLANA_WALLET";
@@ -95,14 +101,11 @@
      ESP_LOGI(TAG, "Signed message created (%llu bytes total)", signed_len);
      print_hex("Signature (64 bytes)", signed_msg, 64);
      
-     // Verify signature
-     uint8_t verified_msg[message_len + 64];
-     unsigned long long verified_len = 0;
-     
+     // Verify signature against the original message (no copy of sm needed)
      ESP_LOGI(TAG, "Verifying signature...");
-     result = crypto_sign_open(verified_msg, &verified_len, signed_msg, signed_len, pk);
+     result = crypto_sign_verify_detached(signed_msg, (const uint8_t *)message, message_len, pk);
      
-     if (result == 0 && verified_len == message_len && memcmp(verified_msg, message, message_len) == 0) {
+     if (result == 0) {
          ESP_LOGI(TAG, "✓ Signature verification SUCCESS!");
          ESP_LOGI(TAG, "✓ TweetNaCl Ed25519 is working perfectly on ESP32-S3!\n");
      } else {
@@ -110,6 +113,96 @@
      }
  }
  
+ /**
+  * Benchmark X25519 key agreement and secretbox sealing
+  */
+ static void test_crypto_performance(void)
+ {
+     ESP_LOGI(TAG, "=== Benchmarking TweetNaCl ===");
+     
+     const int iterations = 10;
+     uint8_t alice_pk[crypto_box_PUBLICKEYBYTES], alice_sk[crypto_box_SECRETKEYBYTES];
+     uint8_t bob_pk[crypto_box_PUBLICKEYBYTES], bob_sk[crypto_box_SECRETKEYBYTES];
+     uint8_t shared_a[crypto_box_BEFORENMBYTES], shared_b[crypto_box_BEFORENMBYTES];
+     
+     crypto_box_keypair(alice_pk, alice_sk);
+     crypto_box_keypair(bob_pk, bob_sk);
+     
+     // Ladder only (one variable-base scalar multiplication)
+     uint8_t point[crypto_scalarmult_BYTES];
+     int64_t start = esp_timer_get_time();
+     for (int i = 0; i < iterations; i++) {
+         crypto_scalarmult(point, alice_sk, bob_pk);
+     }
+     int64_t ladder_us = (esp_timer_get_time() - start) / iterations;
+     
+     // Full ECDH key agreement as used for provisioning / secure channels
+     start = esp_timer_get_time();
+     for (int i = 0; i < iterations; i++) {
+         crypto_box_beforenm(shared_a, bob_pk, alice_sk);
+     }
+     int64_t beforenm_us = (esp_timer_get_time() - start) / iterations;
+     
+     crypto_box_beforenm(shared_b, alice_pk, bob_sk);
+     
+     ESP_LOGI(TAG, "X25519 ladder: %lld us", ladder_us);
+     ESP_LOGI(TAG, "crypto_box_beforenm: %lld us", beforenm_us);
+     
+     if (memcmp(shared_a, shared_b, sizeof(shared_a)) == 0) {
+         ESP_LOGI(TAG, "✓ X25519 shared secrets match!");
+     } else {
+         ESP_LOGE(TAG, "✗ X25519 shared secret mismatch!");
+     }
+     
+     // Seal and open a 4 KB blob (keystore / journal page sized)
+     const size_t blob_len = crypto_secretbox_ZEROBYTES + 4096;
+     uint8_t *plain = calloc(1, blob_len);
+     uint8_t *sealed = calloc(1, blob_len);
+     uint8_t nonce[crypto_secretbox_NONCEBYTES];
+     if (!plain || !sealed) {
+         ESP_LOGE(TAG, "✗ Failed to allocate secretbox buffers\n");
+         free(plain);
+         free(sealed);
+         return;
+     }
+     esp_fill_random(plain + crypto_secretbox_ZEROBYTES, 4096);
+     esp_fill_random(nonce, sizeof(nonce));
+     
+     start = esp_timer_get_time();
+     for (int i = 0; i < iterations; i++) {
+         crypto_secretbox(sealed, plain, blob_len, nonce, shared_a);
+     }
+     int64_t seal_us = (esp_timer_get_time() - start) / iterations;
+     
+     start = esp_timer_get_time();
+     int open_result = 0;
+     for (int i = 0; i < iterations; i++) {
+         open_result |= crypto_secretbox_open(plain, sealed, blob_len, nonce, shared_a);
+     }
+     int64_t open_us = (esp_timer_get_time() - start) / iterations;
+     
+     ESP_LOGI(TAG, "secretbox seal 4 KB: %lld us", seal_us);
+     ESP_LOGI(TAG, "secretbox open 4 KB: %lld us", open_us);
+     
+     if (open_result == 0) {
+         ESP_LOGI(TAG, "✓ secretbox round-trip SUCCESS!\n");
+     } else {
+         ESP_LOGE(TAG, "✗ secretbox authentication FAILED!\n");
+     }
+     
+     // SHA-512 throughput (dominates Ed25519 signing of large messages)
+     uint8_t digest[crypto_hash_BYTES];
+     start = esp_timer_get_time();
+     for (int i = 0; i < iterations; i++) {
+         crypto_hash(digest, plain, blob_len);
+     }
+     int64_t hash_us = (esp_timer_get_time() - start) / iterations;
+     ESP_LOGI(TAG, "SHA-512 4 KB: %lld us\n", hash_us);
+     
+     free(plain);
+     free(sealed);
+ }
+ 
  /**
   * Test Base58 encoding/decoding
   */
@@ -289,16 +382,18 @@
              ESP_LOGI(TAG, "Transaction fee: ~5000 lamports, Transfer: 100 lamports");
              ESP_LOGI(TAG, "Net cost: ~5000 lamports (fee only, transfer stays in wallet)");
              
-             char signature[128];
-             esp_err_t err = solana_wallet_send_sol(wallet, TEST_RECIPIENT, 100, 
-                                                     signature, sizeof(signature));
+             solana_wallet_send_result_t sent;
+             esp_err_t err = solana_wallet_send_sol_confirmed(wallet, TEST_RECIPIENT, 100,
+                                                              SOLANA_RPC_COMMITMENT_CONFIRMED, 0, &sent);
              
              if (err == ESP_OK) {
-                 ESP_LOGI(TAG, "✓ Transaction successful!");
-                 ESP_LOGI(TAG, "✓ Signature: %s", signature);
+                 ESP_LOGI(TAG, "✓ Transaction confirmed in %lu ms (%d broadcasts)",
+                          (unsigned long)sent.latency_ms, sent.broadcasts);
+                 ESP_LOGI(TAG, "✓ Signature: %s", sent.signature);
                  ESP_LOGI(TAG, "✓ View on Solana Explorer:");
-                 ESP_LOGI(TAG, "   https://explorer.solana.com/tx/%s?cluster=devnet", signature);
-                 ESP_LOGI(TAG, "   (Transaction will appear in ~10-30 seconds)");
+                 ESP_LOGI(TAG, "   https://explorer.solana.com/tx/%s?cluster=devnet", sent.signature);
+             } else if (sent.expired) {
+                 ESP_LOGW(TAG, "✗ Blockhash expired before confirmation; safe to send again");
              } else {
                  ESP_LOGE(TAG, "✗ Transaction failed: %s", esp_err_to_name(err));
              }
@@ -379,6 +474,7 @@
      x402_response_t response;
      memset(&response, 0, sizeof(response));
      
+     int64_t fetch_start = esp_timer_get_time();
      err = x402_fetch(
          wallet,
          X402_API_URL,
@@ -387,12 +483,18 @@
          NULL,  // No body
          &response
      );
+     int64_t fetch_us = esp_timer_get_time() - fetch_start;
+     size_t response_len = response.body_len;
      
      if (err == ESP_OK) {
          ESP_LOGI(TAG, "");
          ESP_LOGI(TAG, "✅ x402 Request Successful!");
          ESP_LOGI(TAG, "");
          ESP_LOGI(TAG, "Status Code: %d", response.status_code);
+         if (response.error_class != X402_ERROR_NONE) {
+             ESP_LOGW(TAG, "Failure class: %d (after %d paid attempts)",
+                      response.error_class, response.attempts);
+         }
          
          if (response.body) {
              ESP_LOGI(TAG, "Response Body: %s", response.body);
@@ -448,6 +550,47 @@
      x402_response_free(&response);
      solana_wallet_destroy(wallet);
      
+     // Connection reuse across RPC, facilitator and API requests
+     http_transport_stats_t stats;
+     if (http_transport_get_stats(NULL, &stats) == ESP_OK) {
+         ESP_LOGI(TAG, "HTTP: %lu requests, %lu reused, %lu plain, %lu TLS full (%lu ms), %lu TLS resumed (%lu ms), %lu TLS session offered",
+                  (unsigned long)stats.requests, (unsigned long)stats.reused,
+                  (unsigned long)stats.plain_connects,
+                  (unsigned long)stats.tls_full, (unsigned long)(stats.last_full_us / 1000),
+                  (unsigned long)stats.tls_resumed, (unsigned long)(stats.last_resumed_us / 1000),
+                  (unsigned long)stats.tls_offered);
+         ESP_LOGI(TAG, "HTTP: %lu body bytes received for %lu bytes of content",
+                  (unsigned long)stats.wire_bytes, (unsigned long)stats.body_bytes);
+     }
+     solana_rpc_stats_t rpc_stats;
+     solana_rpc_get_stats(&rpc_stats);
+     ESP_LOGI(TAG, "RPC: %lu calls, %lu joined an identical in-flight call, %lu retried",
+              (unsigned long)rpc_stats.calls, (unsigned long)rpc_stats.coalesced,
+              (unsigned long)rpc_stats.retries);
+     solana_rpc_limiter_stats_t limiter;
+     if (solana_rpc_get_limiter_stats(rpc_client, &limiter) == ESP_OK) {
+         ESP_LOGI(TAG, "RPC limiter: %lu.%03lu req/s, %lu throttled (429), %lu delayed (%lu ms), %lu shed",
+                  (unsigned long)(limiter.rate_milli / 1000), (unsigned long)(limiter.rate_milli % 1000),
+                  (unsigned long)limiter.throttled, (unsigned long)limiter.delayed,
+                  (unsigned long)limiter.delay_ms, (unsigned long)limiter.shed);
+     }
+     http_transport_dns_stats_t dns;
+     http_transport_dns_get_stats(&dns);
+     ESP_LOGI(TAG, "DNS: %lu cached, %lu stale, %lu blocking, %lu refreshed, %lu failed",
+              (unsigned long)dns.hits, (unsigned long)dns.stale_hits, (unsigned long)dns.misses,
+              (unsigned long)dns.refreshes, (unsigned long)dns.failures);
+     
+     // Internal RAM left to WiFi/lwIP/TLS with bulk buffers in PSRAM
+     bulk_mem_stats_t mem;
+     bulk_mem_get_stats(&mem);
+     ESP_LOGI(TAG, "x402_fetch: %lu ms, %lu bytes",
+              (unsigned long)(fetch_us / 1000), (unsigned long)response_len);
+     ESP_LOGI(TAG, "Internal RAM: %u free, %u low-water, %u largest block; PSRAM: %u free",
+              (unsigned)mem.internal_free, (unsigned)mem.internal_min_free,
+              (unsigned)mem.internal_largest, (unsigned)mem.psram_free);
+     ESP_LOGI(TAG, "Bulk buffers: %lu in PSRAM, %lu internal",
+              (unsigned long)mem.bulk_psram, (unsigned long)mem.bulk_internal);
+     
      ESP_LOGI(TAG, "");
      ESP_LOGI(TAG, "✓ x402 Protocol test complete\n");
  }
@@ -471,17 +614,28 @@
      // Test TweetNaCl Ed25519 signing
      test_tweetnacl();
      
+     // Benchmark X25519 key agreement and secretbox
+     test_crypto_performance();
+     
      // Test Base58 encoding/decoding
      test_base58();
      
      // Initialize and test WiFi connection
      test_wifi();
      
+     // Open the RPC and API connections while the rest initializes
+     if (wifi_manager_is_connected()) {
+         const char *origins[] = { SOLANA_RPC_URL, X402_API_URL };
+         http_transport_prewarm(origins, X402_ENABLE_TEST ? 2 : 1);
+     }
+     
      // Initialize Solana RPC client and fetch blockhash to verify connectivity
      solana_rpc_handle_t rpc_client = NULL;
      if (wifi_manager_is_connected()) {
          rpc_client = solana_rpc_init(SOLANA_RPC_URL);
          if (rpc_client) {
+             // Verbose RPC replies cross the WiFi link gzip-compressed
+             solana_rpc_set_compression(rpc_client, true);
              solana_rpc_response_t response;
              esp_err_t err = solana_rpc_get_latest_blockhash(rpc_client, &response);
              if (err == ESP_OK && response.success) {
@@ -0,0 +1,19 @@
+/**
+ * Host replacement for tweetnacl_esp32.c
+ *
+ * Provides randombytes() from /dev/urandom
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void randombytes(unsigned char *buf, unsigned long long len)
+{
+    static FILE *f;
+    if (!f) {
+        f = fopen("/dev/urandom", "rb");
+    }
+    if (!f || fread(buf, 1, (size_t)len, f) != len) {
+        abort();
+    }
+}
@@ -0,0 +1,146 @@
+/**
+ * Host mock of esp_http_client: the HTTP/1.1 path of http_transport without
+ * a network
+ *
+ * A handle "connects" on its first request and stays connected until closed.
+ * Every response is 200 with the body "<method> <url>". Setting
+ * host_http_fail_after_send makes the next request on an open connection
+ * fail after its headers were written, as on a keep-alive socket the server
+ * has just closed.
+ */
+
+#include "esp_http_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct esp_http_client {
+    http_event_handle_cb handler;
+    void *user_data;
+    esp_http_client_method_t method;
+    bool connected;
+    char url[256];
+};
+
+int host_http_inits;
+int host_http_sends;
+bool host_http_fail_after_send;
+
+static const char *method_names[] = {
+    "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD", "NOTIFY", "SUBSCRIBE", "UNSUBSCRIBE", "OPTIONS",
+};
+
+static void dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t id,
+                     char *key, char *value, void *data, int len) {
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+        .header_key = key,
+        .header_value = value,
+    };
+    client->handler(&evt);
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (!client) {
+        return NULL;
+    }
+    host_http_inits++;
+    client->handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->method = config->method;
+    snprintf(client->url, sizeof(client->url), "%s", config->url);
+    return client;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    bool was_connected = client->connected;
+    if (!client->connected) {
+        client->connected = true;
+        dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, NULL, NULL, 0);
+    }
+    host_http_sends++;
+    dispatch(client, HTTP_EVENT_HEADERS_SENT, NULL, NULL, NULL, 0);
+    if (was_connected && host_http_fail_after_send) {
+        host_http_fail_after_send = false;
+        client->connected = false;
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+
+    char body[300];
+    int len = snprintf(body, sizeof(body), "%s %s", method_names[client->method], client->url);
+    dispatch(client, HTTP_EVENT_ON_HEADER, "Content-Type", "text/plain", NULL, 0);
+    dispatch(client, HTTP_EVENT_ON_DATA, NULL, NULL, body, len);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    free(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+    client->connected = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url) {
+    snprintf(client->url, sizeof(client->url), "%s", url);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key) {
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len) {
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms) {
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data) {
+    client->user_data = data;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    return 200;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+    if (!client->connected) {
+        client->connected = true;
+        dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, NULL, NULL, 0);
+    }
+    host_http_sends++;
+    dispatch(client, HTTP_EVENT_HEADERS_SENT, NULL, NULL, NULL, 0);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len) {
+    return len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+    return 0;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len) {
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * Host shim: esp_timer, esp_err, heap_caps, the ROM CRC and miniz, and a
+ * resolver that maps every host name to 127.0.0.1 (the local test server)
+ */
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "miniz.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    static __thread char name[16];
+    snprintf(name, sizeof(name), "0x%x", code);
+    return name;
+}
+
+void *heap_caps_malloc_prefer(size_t size, size_t num, ...) {
+    (void)num;
+    return malloc(size);
+}
+
+void *heap_caps_realloc_prefer(void *ptr, size_t size, size_t num, ...) {
+    (void)num;
+    return realloc(ptr, size);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { (void)caps; return 0; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { (void)caps; return 0; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { (void)caps; return 0; }
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc32(crc, buf, len);
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *in, size_t *in_size,
+                              mz_uint8 *start, mz_uint8 *out, size_t *out_size, const mz_uint32 flags) {
+    if (!(flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) || out < start) {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    if (r->m_state == 0) {
+        memset(&r->zs, 0, sizeof(r->zs));
+        if (inflateInit2(&r->zs, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        r->m_state = 1;
+    }
+    if (r->m_state == 2) {
+        *in_size = 0;
+        *out_size = 0;
+        return TINFL_STATUS_DONE;
+    }
+    r->zs.next_in = (Bytef *)in;
+    r->zs.avail_in = *in_size;
+    r->zs.next_out = out;
+    r->zs.avail_out = *out_size;
+    int ret = *out_size ? inflate(&r->zs, Z_SYNC_FLUSH) : Z_BUF_ERROR;
+    *in_size -= r->zs.avail_in;
+    *out_size -= r->zs.avail_out;
+    if (ret == Z_STREAM_END) {
+        r->m_state = 2;
+        inflateEnd(&r->zs);
+        return TINFL_STATUS_DONE;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        return TINFL_STATUS_FAILED;
+    }
+    return r->zs.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res) {
+    (void)node;
+    (void)service;
+    (void)hints;
+    struct addrinfo *ai = calloc(1, sizeof(*ai));
+    struct sockaddr_in *sa = calloc(1, sizeof(*sa));
+    sa->sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &sa->sin_addr);
+    ai->ai_family = AF_INET;
+    ai->ai_addr = (struct sockaddr *)sa;
+    ai->ai_addrlen = sizeof(*sa);
+    *res = ai;
+    return 0;
+}
+
+void freeaddrinfo(struct addrinfo *ai) {
+    free(ai->ai_addr);
+    free(ai);
+}
@@ -0,0 +1,180 @@
+/**
+ * Host shim: esp_tls over OpenSSL
+ *
+ * Certificates are not verified (the test server is self-signed). After each
+ * handshake the negotiated version, ALPN protocol and master secret are copied
+ * into the mbedtls_ssl_context stand-in returned by esp_tls_get_ssl_context,
+ * and host_tls_handshakes / host_tls_resumptions count what OpenSSL did, so
+ * tests can check how http_transport classified the connection.
+ */
+
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "mbedtls/ssl.h"
+#include <openssl/ssl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct esp_tls {
+    int fd;
+    SSL *ssl;
+    mbedtls_ssl_context ctx;
+    mbedtls_ssl_session session;
+};
+
+struct esp_tls_client_session {
+    SSL_SESSION *session;
+};
+
+int host_tls_handshakes;
+int host_tls_resumptions;
+
+static SSL_CTX *s_ctx;
+static pthread_once_t s_ctx_once = PTHREAD_ONCE_INIT;
+
+static void ctx_init(void) {
+    s_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_session_cache_mode(s_ctx, SSL_SESS_CACHE_OFF);
+}
+
+esp_tls_t *esp_tls_init(void) {
+    esp_tls_t *tls = calloc(1, sizeof(*tls));
+    if (tls) {
+        tls->fd = -1;
+    }
+    return tls;
+}
+
+int esp_tls_conn_new_sync(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls) {
+    pthread_once(&s_ctx_once, ctx_init);
+
+    char host[64];
+    snprintf(host, sizeof(host), "%.*s", hostlen, hostname);
+    struct sockaddr_in sa = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) {
+        return -1;
+    }
+    tls->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (tls->fd < 0 || connect(tls->fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        return -1;
+    }
+
+    tls->ssl = SSL_new(s_ctx);
+    SSL_set_fd(tls->ssl, tls->fd);
+    if (cfg->common_name) {
+        SSL_set_tlsext_host_name(tls->ssl, cfg->common_name);
+    }
+    if (cfg->alpn_protos) {
+        unsigned char wire[64];
+        size_t n = 0;
+        for (const char **p = cfg->alpn_protos; *p; p++) {
+            size_t len = strlen(*p);
+            wire[n++] = (unsigned char)len;
+            memcpy(wire + n, *p, len);
+            n += len;
+        }
+        SSL_set_alpn_protos(tls->ssl, wire, (unsigned int)n);
+    }
+    if (cfg->client_session) {
+        SSL_set_session(tls->ssl, cfg->client_session->session);
+    }
+    if (SSL_connect(tls->ssl) != 1) {
+        return -1;
+    }
+
+    host_tls_handshakes++;
+    if (SSL_session_reused(tls->ssl)) {
+        host_tls_resumptions++;
+    }
+    tls->ctx.private_session = &tls->session;
+    tls->ctx.private_tls_version = SSL_version(tls->ssl) == TLS1_2_VERSION ?
+                                   MBEDTLS_SSL_VERSION_TLS1_2 : MBEDTLS_SSL_VERSION_TLS1_3;
+    SSL_SESSION_get_master_key(SSL_get_session(tls->ssl), tls->session.private_master,
+                               sizeof(tls->session.private_master));
+    const unsigned char *alpn;
+    unsigned int alpn_len;
+    SSL_get0_alpn_selected(tls->ssl, &alpn, &alpn_len);
+    snprintf(tls->ctx.alpn, sizeof(tls->ctx.alpn), "%.*s", (int)alpn_len, alpn);
+    return 1;
+}
+
+ssize_t esp_tls_conn_write(esp_tls_t *tls, const void *data, size_t datalen) {
+    int ret = SSL_write(tls->ssl, data, (int)datalen);
+    return ret > 0 ? ret : -1;
+}
+
+ssize_t esp_tls_conn_read(esp_tls_t *tls, void *data, size_t datalen) {
+    int ret = SSL_read(tls->ssl, data, (int)datalen);
+    if (ret > 0) {
+        return ret;
+    }
+    switch (SSL_get_error(tls->ssl, ret)) {
+        case SSL_ERROR_WANT_READ: return ESP_TLS_ERR_SSL_WANT_READ;
+        case SSL_ERROR_ZERO_RETURN: return 0;
+        default: return -1;
+    }
+}
+
+ssize_t esp_tls_get_bytes_avail(esp_tls_t *tls) {
+    return SSL_pending(tls->ssl);
+}
+
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t *tls, int *sockfd) {
+    *sockfd = tls->fd;
+    return ESP_OK;
+}
+
+int esp_tls_conn_destroy(esp_tls_t *tls) {
+    if (tls->ssl) {
+        SSL_shutdown(tls->ssl);
+        SSL_free(tls->ssl);
+    }
+    if (tls->fd >= 0) {
+        close(tls->fd);
+    }
+    free(tls);
+    return 0;
+}
+
+void *esp_tls_get_ssl_context(esp_tls_t *tls) {
+    return &tls->ctx;
+}
+
+esp_tls_client_session_t *esp_tls_get_client_session(esp_tls_t *tls) {
+    SSL_SESSION *session = SSL_get1_session(tls->ssl);
+    if (!session) {
+        return NULL;
+    }
+    esp_tls_client_session_t *out = malloc(sizeof(*out));
+    out->session = session;
+    return out;
+}
+
+void esp_tls_free_client_session(esp_tls_client_session_t *client_session) {
+    if (client_session) {
+        SSL_SESSION_free(client_session->session);
+        free(client_session);
+    }
+}
+
+const char *mbedtls_ssl_get_alpn_protocol(const mbedtls_ssl_context *ssl) {
+    return ssl->alpn[0] ? ssl->alpn : NULL;
+}
+
+mbedtls_ssl_protocol_version mbedtls_ssl_get_version_number(const mbedtls_ssl_context *ssl) {
+    return ssl->private_tls_version;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf) {
+    (void)conf;
+    return ESP_OK;
+}
@@ -0,0 +1,168 @@
+/**
+ * Host shim: FreeRTOS tasks, notifications and mutexes on pthreads
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <errno.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+struct host_task {
+    TaskFunction_t fn;
+    void *arg;
+    sem_t notify;
+};
+
+static __thread struct host_task *s_self;
+
+static void *task_main(void *arg) {
+    s_self = arg;
+    s_self->fn(s_self->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle_out) {
+    (void)name;
+    (void)stack;
+    (void)priority;
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return pdFALSE;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    sem_init(&task->notify, 0, 0);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_main, task) != 0) {
+        free(task);
+        return pdFALSE;
+    }
+    pthread_detach(thread);
+    if (handle_out) {
+        *handle_out = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle_out, BaseType_t core) {
+    (void)core;     // Threads float; the scheduler spreads them over the host's cores
+    return xTaskCreate(fn, name, stack, arg, priority, handle_out);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    (void)task;
+    return tskIDLE_PRIORITY;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return s_self ? 1 : 0;  // Test thread on core 0, tasks on core 1
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task;     // Only ever called with NULL (the calling task)
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    usleep(ticks ? ticks * 1000 : 100);
+}
+
+void taskYIELD(void) {
+    sched_yield();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    (void)clear;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (sem_timedwait(&s_self->notify, &ts) != 0) {
+        if (errno != EINTR) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    sem_post(&task->notify);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) {
+    pthread_mutex_init(&buf->mutex, NULL);
+    buf->counting = false;
+    buf->heap = false;
+    return buf;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t *buf) {
+    pthread_mutex_init(&buf->mutex, NULL);
+    pthread_cond_init(&buf->cond, NULL);
+    buf->counting = true;
+    buf->heap = false;
+    buf->count = initial;
+    return buf;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    StaticSemaphore_t *buf = calloc(1, sizeof(*buf));
+    if (!buf) {
+        return NULL;
+    }
+    xSemaphoreCreateCountingStatic(1, 0, buf);
+    buf->heap = true;
+    return buf;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (sem->counting) {
+        pthread_mutex_lock(&sem->mutex);
+        while (sem->count == 0 && ticks != 0) {
+            pthread_cond_wait(&sem->cond, &sem->mutex);     // Only used with portMAX_DELAY
+        }
+        BaseType_t taken = sem->count > 0 ? pdTRUE : pdFALSE;
+        sem->count -= taken == pdTRUE;
+        pthread_mutex_unlock(&sem->mutex);
+        return taken;
+    }
+    if (ticks == 0) {
+        return pthread_mutex_trylock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    pthread_mutex_lock(&sem->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->counting) {
+        pthread_mutex_lock(&sem->mutex);
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+        pthread_mutex_unlock(&sem->mutex);
+        return pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->mutex);
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    if (sem->counting) {
+        pthread_cond_destroy(&sem->cond);
+    }
+    pthread_mutex_destroy(&sem->mutex);
+    if (sem->heap) {
+        free(sem);
+    }
+}
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Local HTTP/2 test server for test_http_transport.c
+
+Usage: h2_server.py CERT KEY
+
+Listens on four ephemeral ports on 127.0.0.1 and prints
+"ready H2 H1 ABORT NORESUME" once they accept connections:
+
+  H2        TLS 1.2, ALPN h2 or http/1.1, sessions can be resumed
+  H1        TLS 1.2, ALPN http/1.1 only
+  ABORT     closes every connection before the TLS handshake
+  NORESUME  like H2, but every handshake is a full one
+
+Paths on the TLS ports:
+
+  /slow?ms=N    answer after N ms
+  /big?n=N      N bytes of 'x' (gzip if accepted), needs WINDOW_UPDATEs
+  /missing      404
+  /drop         reset the connection as soon as the request headers arrive
+  /stats        "conns=C max_active=A drops=D aborts=B" (B: connections to ABORT)
+  anything else "<method> <path> len=<body length> body=<first 32 bytes> hdrs=<headers>"
+
+Needs the h2 package (pip install h2).
+"""
+
+import asyncio
+import gzip
+import ssl
+import sys
+from urllib.parse import parse_qs, urlparse
+
+from h2.config import H2Configuration
+from h2.connection import H2Connection
+from h2.events import DataReceived, RequestReceived, StreamEnded, StreamReset, WindowUpdated
+
+stats = {'conns': 0, 'max_active': 0, 'drops': 0, 'aborts': 0}
+active = 0
+
+
+class H2Protocol(asyncio.Protocol):
+    def connection_made(self, transport):
+        stats['conns'] += 1
+        self.transport = transport
+        self.conn = H2Connection(H2Configuration(client_side=False))
+        self.conn.initiate_connection()
+        self.transport.write(self.conn.data_to_send())
+        self.requests = {}
+        self.pending = {}
+
+    def data_received(self, data):
+        for event in self.conn.receive_data(data):
+            if isinstance(event, RequestReceived):
+                headers = dict(event.headers)
+                if urlparse(headers[b':path'].decode()).path == '/drop':
+                    stats['drops'] += 1
+                    self.transport.abort()
+                    return
+                self.requests[event.stream_id] = (headers, bytearray())
+            elif isinstance(event, DataReceived):
+                self.requests[event.stream_id][1].extend(event.data)
+                self.conn.acknowledge_received_data(event.flow_controlled_length, event.stream_id)
+            elif isinstance(event, StreamEnded):
+                asyncio.ensure_future(self.respond(event.stream_id))
+            elif isinstance(event, StreamReset):
+                self.pending.pop(event.stream_id, None)
+            elif isinstance(event, WindowUpdated):
+                self.flush()
+        self.transport.write(self.conn.data_to_send())
+
+    async def respond(self, stream_id):
+        global active
+        headers, body = self.requests.pop(stream_id)
+        path = headers[b':path'].decode()
+        url = urlparse(path)
+        query = parse_qs(url.query)
+
+        active += 1
+        stats['max_active'] = max(stats['max_active'], active)
+        if 'ms' in query:
+            await asyncio.sleep(int(query['ms'][0]) / 1000)
+        active -= 1
+
+        status = '200'
+        extra = []
+        if url.path == '/stats':
+            out = 'conns={conns} max_active={max_active} drops={drops} aborts={aborts}'.format(**stats).encode()
+        elif url.path == '/big':
+            out = b'x' * int(query['n'][0])
+            if b'gzip' in headers.get(b'accept-encoding', b''):
+                out = gzip.compress(out)
+                extra = [('content-encoding', 'gzip')]
+        elif url.path == '/missing':
+            status = '404'
+            out = b'not found'
+        else:
+            hdrs = ';'.join('%s=%s' % (k.decode(), v.decode()) for k, v in headers.items()
+                            if not k.startswith(b':'))
+            out = ('%s %s len=%d body=%s hdrs=%s' % (headers[b':method'].decode(), path, len(body),
+                                                     body[:32].decode(), hdrs)).encode()
+
+        stream = self.conn.streams.get(stream_id)
+        if stream is None or stream.closed:
+            return
+        self.conn.send_headers(stream_id, [(':status', status), ('content-type', 'text/plain'),
+                                           ('x-payment-response', 'ok')] + extra)
+        self.pending[stream_id] = out
+        self.flush()
+
+    def flush(self):
+        for stream_id, data in list(self.pending.items()):
+            stream = self.conn.streams.get(stream_id)
+            if stream is None or stream.closed:
+                del self.pending[stream_id]
+                continue
+            while data:
+                n = min(len(data), self.conn.local_flow_control_window(stream_id),
+                        self.conn.max_outbound_frame_size)
+                if n <= 0:
+                    break
+                self.conn.send_data(stream_id, data[:n])
+                data = data[n:]
+            if data:
+                self.pending[stream_id] = data
+            else:
+                self.conn.end_stream(stream_id)
+                del self.pending[stream_id]
+        self.transport.write(self.conn.data_to_send())
+
+
+class NoResumeProtocol(asyncio.Protocol):
+    """TLS with a new context per connection: no shared session cache or ticket keys"""
+
+    def __init__(self, make_context):
+        self.make_context = make_context
+
+    def connection_made(self, transport):
+        asyncio.ensure_future(self.start_tls(transport))
+
+    async def start_tls(self, transport):
+        h2 = H2Protocol()
+        tls = await asyncio.get_running_loop().start_tls(transport, h2, self.make_context(), server_side=True)
+        h2.connection_made(tls)
+
+
+class AbortProtocol(asyncio.Protocol):
+    def connection_made(self, transport):
+        stats['aborts'] += 1
+        transport.abort()
+
+
+def tls_context(cert, key, alpn):
+    ctx = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+    ctx.load_cert_chain(cert, key)
+    ctx.set_alpn_protocols(alpn)
+    # The device speaks TLS 1.2, where resumption keeps the master secret
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    return ctx
+
+
+async def main(cert, key):
+    loop = asyncio.get_running_loop()
+
+    servers = [
+        await loop.create_server(H2Protocol, '127.0.0.1', 0, ssl=tls_context(cert, key, ['h2', 'http/1.1'])),
+        await loop.create_server(H2Protocol, '127.0.0.1', 0, ssl=tls_context(cert, key, ['http/1.1'])),
+        await loop.create_server(AbortProtocol, '127.0.0.1', 0),
+        await loop.create_server(lambda: NoResumeProtocol(lambda: tls_context(cert, key, ['h2', 'http/1.1'])),
+                                 '127.0.0.1', 0),
+    ]
+    print('ready', *(s.sockets[0].getsockname()[1] for s in servers), flush=True)
+    await asyncio.Event().wait()
+
+
+if __name__ == '__main__':
+    asyncio.run(main(sys.argv[1], sys.argv[2]))
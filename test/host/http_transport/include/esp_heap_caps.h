@@ -0,0 +1,14 @@
+#pragma once
+// Host shim: one heap, no PSRAM
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+void *heap_caps_malloc_prefer(size_t size, size_t num, ...);
+void *heap_caps_realloc_prefer(void *ptr, size_t size, size_t num, ...);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
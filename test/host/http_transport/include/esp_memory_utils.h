@@ -0,0 +1,4 @@
+#pragma once
+#include <stdbool.h>
+
+static inline bool esp_ptr_external_ram(const void *p) { (void)p; return false; }
@@ -0,0 +1,5 @@
+#pragma once
+// Host shim: monotonic clock in microseconds
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
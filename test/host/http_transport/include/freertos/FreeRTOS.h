@@ -0,0 +1,23 @@
+#pragma once
+// Host shim: FreeRTOS on pthreads (critical sections are a recursive mutex)
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) (ms)
+#define portNUM_PROCESSORS 2
+
+BaseType_t xPortGetCoreID(void);
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
@@ -0,0 +1,36 @@
+#pragma once
+// Host shim: mbedtls Base64 on OpenSSL's EVP block coder
+#include <stddef.h>
+#include <openssl/evp.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+static inline int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                                        const unsigned char *src, size_t slen) {
+    size_t needed = 4 * ((slen + 2) / 3) + 1;
+    if (dlen < needed) {
+        *olen = needed;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    *olen = (size_t)EVP_EncodeBlock(dst, src, (int)slen);
+    return 0;
+}
+
+static inline int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                                        const unsigned char *src, size_t slen) {
+    if (slen % 4) {
+        return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    size_t padding = (slen && src[slen - 1] == '=') + (slen > 1 && src[slen - 2] == '=');
+    size_t needed = slen / 4 * 3 - padding;
+    if (dlen < slen / 4 * 3) {      // EVP_DecodeBlock writes the padding bytes too
+        *olen = needed;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    if (EVP_DecodeBlock(dst, src, (int)slen) < 0) {
+        return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    *olen = needed;
+    return 0;
+}
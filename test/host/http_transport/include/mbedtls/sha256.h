@@ -0,0 +1,27 @@
+#pragma once
+// Host shim: mbedtls SHA-256 on OpenSSL's EVP interface
+#include <openssl/evp.h>
+
+typedef struct {
+    EVP_MD_CTX *md;
+} mbedtls_sha256_context;
+
+static inline void mbedtls_sha256_init(mbedtls_sha256_context *ctx) {
+    ctx->md = EVP_MD_CTX_new();
+}
+
+static inline int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224) {
+    return EVP_DigestInit_ex(ctx->md, is224 ? EVP_sha224() : EVP_sha256(), NULL) == 1 ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t len) {
+    return EVP_DigestUpdate(ctx->md, input, len) == 1 ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output) {
+    return EVP_DigestFinal_ex(ctx->md, output, NULL) == 1 ? 0 : -1;
+}
+
+static inline void mbedtls_sha256_free(mbedtls_sha256_context *ctx) {
+    EVP_MD_CTX_free(ctx->md);
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Host shim: the mbedtls_ssl_context members http_transport_h2.c reads,
+// filled in by the OpenSSL esp_tls shim after the handshake
+#include <stdint.h>
+
+#define MBEDTLS_PRIVATE(member) private_##member
+
+typedef enum {
+    MBEDTLS_SSL_VERSION_UNKNOWN,
+    MBEDTLS_SSL_VERSION_TLS1_2 = 0x0303,
+    MBEDTLS_SSL_VERSION_TLS1_3 = 0x0304,
+} mbedtls_ssl_protocol_version;
+
+typedef struct {
+    unsigned char MBEDTLS_PRIVATE(master)[48];
+} mbedtls_ssl_session;
+
+typedef struct mbedtls_ssl_context {
+    mbedtls_ssl_session *MBEDTLS_PRIVATE(session);
+    mbedtls_ssl_protocol_version MBEDTLS_PRIVATE(tls_version);
+    char alpn[32];
+} mbedtls_ssl_context;
+
+const char *mbedtls_ssl_get_alpn_protocol(const mbedtls_ssl_context *ssl);
+mbedtls_ssl_protocol_version mbedtls_ssl_get_version_number(const mbedtls_ssl_context *ssl);
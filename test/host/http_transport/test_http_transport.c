@@ -0,0 +1,419 @@
+/**
+ * http_transport against a local HTTP/2 server (h2_server.py) through the
+ * esp_tls (OpenSSL) and FreeRTOS (pthreads) shims, with the HTTP/1.1 path on
+ * the esp_http_client mock.
+ *
+ * Covers stream multiplexing, flow control, RST_STREAM, timeouts, TLS
+ * session resumption and its classification, ALPN fallback and the h2
+ * retry backoff, which failed requests are retried on a fresh connection,
+ * and capture / replay.
+ */
+
+#include "http_transport.h"
+#include "http_transport_capture.h"
+#include "http_transport_h2.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern int host_tls_handshakes;
+extern int host_tls_resumptions;
+extern int host_http_inits;
+extern int host_http_sends;
+extern bool host_http_fail_after_send;
+
+static int failures;
+static pid_t s_server;
+static char s_h2[64], s_h1[64], s_abort[64], s_noresume[64];    // Origins
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool server_start(void) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    s_server = fork();
+    if (s_server == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        execlp(H2_SERVER_PYTHON, H2_SERVER_PYTHON, H2_SERVER_SCRIPT, H2_TEST_CERT, H2_TEST_KEY, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    FILE *out = fdopen(fds[0], "r");
+    int ports[4];
+    if (!out || fscanf(out, "ready %d %d %d %d", &ports[0], &ports[1], &ports[2], &ports[3]) != 4) {
+        return false;
+    }
+    snprintf(s_h2, sizeof(s_h2), "https://h2.test:%d", ports[0]);
+    snprintf(s_h1, sizeof(s_h1), "https://h1.test:%d", ports[1]);
+    snprintf(s_abort, sizeof(s_abort), "https://abort.test:%d", ports[2]);
+    snprintf(s_noresume, sizeof(s_noresume), "https://noresume.test:%d", ports[3]);
+    return true;
+}
+
+static esp_err_t fetch(const char *origin, const char *path, esp_http_client_method_t method,
+                       const char *body, size_t max_response, http_transport_response_t *response) {
+    char url[160];
+    snprintf(url, sizeof(url), "%s%s", origin, path);
+    http_transport_request_t request = {
+        .url = url,
+        .method = method,
+        .headers = "Content-Type: application/json\r\nX-Payment: abc",
+        .body = body,
+        .body_len = body ? strlen(body) : 0,
+        .max_response = max_response,
+    };
+    return http_transport_perform(&request, response);
+}
+
+static void server_stats(int *conns, int *max_active, int *drops) {
+    http_transport_response_t r;
+    *conns = *max_active = *drops = -1;
+    if (fetch(s_h2, "/stats", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK) {
+        sscanf(r.body, "conns=%d max_active=%d drops=%d", conns, max_active, drops);
+    }
+    http_transport_response_free(&r);
+}
+
+static int abort_conns(void) {
+    http_transport_response_t r;
+    int aborts = -1;
+    if (fetch(s_h2, "/stats", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK && strstr(r.body, "aborts=")) {
+        aborts = atoi(strstr(r.body, "aborts=") + 7);
+    }
+    http_transport_response_free(&r);
+    return aborts;
+}
+
+static void test_streams(void) {
+    http_transport_response_t r;
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"jsonrpc\":\"2.0\"}", 0, &r) == ESP_OK);
+    CHECK(r.http2 && r.status_code == 200 && r.conn == HTTP_TRANSPORT_CONN_TLS_FULL);
+    CHECK(r.body && strstr(r.body, "POST /rpc len=17") && strstr(r.body, "x-payment=abc"));
+    CHECK(r.headers && strstr(r.headers, "x-payment-response: ok"));
+    http_transport_response_free(&r);
+
+    CHECK(fetch(s_h2, "", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.conn == HTTP_TRANSPORT_CONN_REUSED && r.body && strstr(r.body, "GET / "));
+    http_transport_response_free(&r);
+
+    CHECK(fetch(s_h2, "/missing", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK && r.status_code == 404);
+    http_transport_response_free(&r);
+}
+
+// Bodies past the 64 KB initial window need WINDOW_UPDATEs from the client
+static void test_flow_control(void) {
+    http_transport_response_t r;
+    CHECK(fetch(s_h2, "/big?n=200000", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.body_len == 200000 && r.body[199999] == 'x');
+    http_transport_response_free(&r);
+
+    char url[160];
+    snprintf(url, sizeof(url), "%s/big?n=300000", s_h2);
+    http_transport_request_t request = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .accept_encoding = true,
+    };
+    CHECK(http_transport_perform(&request, &r) == ESP_OK);
+    CHECK(r.http2 && r.body_len == 300000 && r.wire_len < 2000);
+    http_transport_response_free(&r);
+}
+
+// A body over max_response resets only its own stream
+static void test_rst_stream(void) {
+    http_transport_response_t r;
+    CHECK(fetch(s_h2, "/big?n=200000", HTTP_METHOD_GET, NULL, 16384, &r) == ESP_ERR_INVALID_SIZE);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/after-rst", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.conn == HTTP_TRANSPORT_CONN_REUSED);
+    http_transport_response_free(&r);
+}
+
+static void *slow_worker(void *arg) {
+    http_transport_response_t r;
+    esp_err_t *err = arg;
+    *err = fetch(s_h2, "/slow?ms=500", HTTP_METHOD_GET, NULL, 0, &r);
+    if (*err == ESP_OK && (!r.http2 || r.status_code != 200)) {
+        *err = ESP_FAIL;
+    }
+    http_transport_response_free(&r);
+    return NULL;
+}
+
+// Four 500 ms requests overlap on the one connection
+static void test_concurrency(void) {
+    int conns_before, conns_after, max_active, drops;
+    server_stats(&conns_before, &max_active, &drops);
+
+    pthread_t threads[4];
+    esp_err_t errs[4];
+    double start = now_s();
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, slow_worker, &errs[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(errs[i] == ESP_OK);
+    }
+    double elapsed = now_s() - start;
+    printf("4 concurrent 500 ms streams: %.3f s\n", elapsed);
+    CHECK(elapsed < 1.0);
+
+    server_stats(&conns_after, &max_active, &drops);
+    CHECK(conns_after == conns_before && max_active >= 4);
+}
+
+static void test_timeout(void) {
+    char url[160];
+    snprintf(url, sizeof(url), "%s/slow?ms=1500", s_h2);
+    http_transport_request_t request = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 300,
+    };
+    http_transport_response_t r;
+    CHECK(http_transport_perform(&request, &r) == ESP_ERR_TIMEOUT);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/after-timeout", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.conn == HTTP_TRANSPORT_CONN_REUSED);
+    http_transport_response_free(&r);
+}
+
+// TLS_RESUMED only when the server actually resumed the offered session
+static void test_resumption(void) {
+    http_transport_response_t r;
+    int resumptions = host_tls_resumptions;
+    http_transport_suspend();
+    CHECK(fetch(s_h2, "/again", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.conn == HTTP_TRANSPORT_CONN_TLS_RESUMED && host_tls_resumptions == resumptions + 1);
+    http_transport_response_free(&r);
+
+    CHECK(fetch(s_noresume, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.http2 && r.conn == HTTP_TRANSPORT_CONN_TLS_FULL);
+    http_transport_response_free(&r);
+    http_transport_suspend();
+    CHECK(fetch(s_noresume, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(r.http2 && r.conn == HTTP_TRANSPORT_CONN_TLS_FULL);
+    CHECK(host_tls_resumptions == resumptions + 1);
+    http_transport_response_free(&r);
+}
+
+// Origins without h2, or whose first handshake fails, use the HTTP/1.1 pool
+static void test_fallback(void) {
+    http_transport_response_t r;
+    int inits = host_http_inits;
+    CHECK(fetch(s_h1, "/x", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2 && host_http_inits == inits + 1 && r.conn == HTTP_TRANSPORT_CONN_TLS_FULL);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h1, "/y", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2 && r.conn == HTTP_TRANSPORT_CONN_REUSED);
+    http_transport_response_free(&r);
+
+    // The HTTP/1.1 client cannot see the handshake outcome
+    http_transport_suspend();
+    CHECK(fetch(s_h1, "/z", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2 && r.conn == HTTP_TRANSPORT_CONN_TLS_OFFERED);
+    http_transport_response_free(&r);
+
+    // A failed handshake falls back for that request only: HTTP/1.1 until
+    // the backoff (HTTP_TRANSPORT_H2_RETRY_MS, doubling) ends, then h2 again
+    int aborts = abort_conns();
+    CHECK(fetch(s_abort, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2);
+    http_transport_response_free(&r);
+    CHECK(abort_conns() == aborts + 1);
+    CHECK(fetch(s_abort, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2);
+    http_transport_response_free(&r);
+    CHECK(abort_conns() == aborts + 1);
+
+    usleep((HTTP_TRANSPORT_H2_RETRY_MS + 50) * 1000);
+    CHECK(fetch(s_abort, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(!r.http2);
+    http_transport_response_free(&r);
+    CHECK(abort_conns() == aborts + 2);
+    usleep((HTTP_TRANSPORT_H2_RETRY_MS + 50) * 1000);
+    CHECK(fetch(s_abort, "/", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    CHECK(abort_conns() == aborts + 2);
+}
+
+// A request that may have reached the server is resent only if idempotent
+static void test_retry(void) {
+    http_transport_response_t r;
+    int conns, max_active, drops_before, drops_after;
+
+    server_stats(&conns, &max_active, &drops_before);
+    CHECK(fetch(s_h2, "/drop", HTTP_METHOD_POST, "{}", 0, &r) != ESP_OK);
+    http_transport_response_free(&r);
+    server_stats(&conns, &max_active, &drops_after);
+    CHECK(drops_after == drops_before + 1);
+
+    CHECK(fetch(s_h2, "/drop", HTTP_METHOD_GET, NULL, 0, &r) != ESP_OK);
+    http_transport_response_free(&r);
+    server_stats(&conns, &max_active, &drops_before);
+    CHECK(drops_before == drops_after + 2);
+
+    // HTTP/1.1: the socket fails after the request was written
+    CHECK(fetch(s_h1, "/warm", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    int sends = host_http_sends;
+    host_http_fail_after_send = true;
+    CHECK(fetch(s_h1, "/pay", HTTP_METHOD_POST, "{}", 0, &r) != ESP_OK);
+    CHECK(host_http_sends == sends + 1);
+    http_transport_response_free(&r);
+
+    CHECK(fetch(s_h1, "/warm", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    sends = host_http_sends;
+    host_http_fail_after_send = true;
+    CHECK(fetch(s_h1, "/read", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    CHECK(host_http_sends == sends + 2);
+    http_transport_response_free(&r);
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} capture_buf_t;
+
+static void capture_sink(void *ctx, const uint8_t *data, size_t len) {
+    capture_buf_t *buf = ctx;
+    uint8_t *grown = realloc(buf->data, buf->len + len);
+    if (!grown) {
+        abort();
+    }
+    memcpy(grown + buf->len, data, len);
+    buf->data = grown;
+    buf->len += len;
+}
+
+// Time of one replayed /slow request at latency_pct
+static double replay_slow(const capture_buf_t *buf, uint32_t latency_pct) {
+    http_transport_response_t r;
+    CHECK(http_transport_replay_start(buf->data, buf->len, latency_pct) == ESP_OK);
+    double start = now_s();
+    CHECK(fetch(s_h2, "/slow?ms=300", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK && r.status_code == 200);
+    double elapsed = now_s() - start;
+    http_transport_response_free(&r);
+    http_transport_replay_stop(NULL);
+    return elapsed;
+}
+
+// Recorded traffic replays with exact, inexact and missing matches
+static void test_capture(void) {
+    capture_buf_t buf = { 0 };
+    http_transport_response_t r;
+    CHECK(http_transport_capture_start(capture_sink, &buf) == ESP_OK);
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"id\":1}", 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"id\":22}", 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    esp_err_t drop_err = fetch(s_h2, "/drop", HTTP_METHOD_POST, "{}", 0, &r);
+    CHECK(drop_err != ESP_OK);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/slow?ms=300", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+    http_transport_capture_stop();
+    CHECK(fetch(s_h2, "/not-recorded", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK);
+    http_transport_response_free(&r);
+
+    CHECK(buf.len > HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN + 4 * HTTP_TRANSPORT_CAPTURE_RECORD_HEADER_LEN);
+    CHECK(memcmp(buf.data, HTTP_TRANSPORT_CAPTURE_MAGIC, 4) == 0);
+
+    // The second body first: matched by its hash, not by order
+    CHECK(http_transport_replay_start(buf.data, buf.len, 0) == ESP_OK);
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"id\":22}", 0, &r) == ESP_OK);
+    CHECK(r.status_code == 200 && r.body && strstr(r.body, "POST /rpc len=9"));
+    CHECK(r.headers && strstr(r.headers, "x-payment-response: ok"));
+    http_transport_response_free(&r);
+    // Unrecorded body: the first unused record of the same method and URL
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"id\":333}", 0, &r) == ESP_OK);
+    CHECK(r.body && strstr(r.body, "POST /rpc len=8"));
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/rpc", HTTP_METHOD_POST, "{\"id\":1}", 0, &r) == ESP_ERR_NOT_FOUND);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/drop", HTTP_METHOD_POST, "{}", 0, &r) == drop_err);
+    http_transport_response_free(&r);
+    CHECK(fetch(s_h2, "/not-recorded", HTTP_METHOD_GET, NULL, 0, &r) == ESP_ERR_NOT_FOUND);
+    http_transport_response_free(&r);
+    http_transport_replay_stats_t stats;
+    http_transport_replay_stop(&stats);
+    CHECK(stats.served == 3 && stats.inexact == 1 && stats.missing == 2);
+
+    // Recorded latency, scaled
+    double full = replay_slow(&buf, 100);
+    double half = replay_slow(&buf, 50);
+    double none = replay_slow(&buf, 0);
+    printf("replayed 300 ms request: %.3f s at 100%%, %.3f s at 50%%, %.3f s at 0%%\n", full, half, none);
+    CHECK(full >= 0.29 && full < 0.6);
+    CHECK(half >= 0.14 && half < full);
+    CHECK(none < 0.05);
+
+    // Malformed captures are refused as a whole
+    CHECK(http_transport_replay_start(buf.data, buf.len - 1, 0) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(http_transport_replay_start(buf.data, HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN + 10, 0) ==
+          ESP_ERR_INVALID_RESPONSE);
+    CHECK(http_transport_replay_start(buf.data, 4, 0) == ESP_ERR_INVALID_RESPONSE);
+    uint8_t *corrupt = malloc(buf.len);
+    memcpy(corrupt, buf.data, buf.len);
+    corrupt[HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN + 16] = 0xff;      // url_len past the end
+    corrupt[HTTP_TRANSPORT_CAPTURE_FILE_HEADER_LEN + 17] = 0xff;
+    CHECK(http_transport_replay_start(corrupt, buf.len, 0) == ESP_ERR_INVALID_RESPONSE);
+    memcpy(corrupt, buf.data, buf.len);
+    corrupt[4] = HTTP_TRANSPORT_CAPTURE_VERSION + 1;
+    CHECK(http_transport_replay_start(corrupt, buf.len, 0) == ESP_ERR_INVALID_RESPONSE);
+    memcpy(corrupt, buf.data, buf.len);
+    corrupt[0] = 'X';
+    CHECK(http_transport_replay_start(corrupt, buf.len, 0) == ESP_ERR_INVALID_RESPONSE);
+    free(corrupt);
+
+    // None of those left a replay running: back on the network
+    CHECK(fetch(s_h2, "/not-recorded", HTTP_METHOD_GET, NULL, 0, &r) == ESP_OK && r.http2);
+    http_transport_response_free(&r);
+    free(buf.data);
+}
+
+int main(void) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+    signal(SIGPIPE, SIG_IGN);   // Writes to a reset socket fail instead (as with lwIP)
+    if (!server_start()) {
+        printf("FAIL: could not start %s\n", H2_SERVER_SCRIPT);
+        return 1;
+    }
+
+    test_streams();
+    test_flow_control();
+    test_rst_stream();
+    test_concurrency();
+    test_timeout();
+    test_resumption();
+    test_fallback();
+    test_retry();
+    test_capture();
+
+    http_transport_stats_t stats;
+    CHECK(http_transport_get_stats(s_h2, &stats) == ESP_OK);
+    printf("h2 origin: %u requests, %u errors, %u reused, %u full, %u resumed, %u streams\n",
+           (unsigned)stats.requests, (unsigned)stats.errors, (unsigned)stats.reused,
+           (unsigned)stats.tls_full, (unsigned)stats.tls_resumed, (unsigned)stats.http2_streams);
+
+    kill(s_server, SIGTERM);
+    waitpid(s_server, NULL, 0);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
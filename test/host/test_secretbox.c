@@ -0,0 +1,175 @@
+/**
+ * Poly1305 (crypto_onetimeauth), XSalsa20 (crypto_stream) and secretbox:
+ * known-answer tests.
+ *
+ * Poly1305: RFC 8439 section 2.5.2 (34 bytes) and the appendix A.3 vectors
+ * that need the final carry or the reduction past 2^130 - 5, plus the NaCl
+ * one over the 131-byte box ciphertext. Every prefix length 0..131 of that
+ * message is covered as well, folded into one SHA-512 of the tags (computed
+ * with an independent implementation).
+ *
+ * XSalsa20 / secretbox: the NaCl secretbox vector (131 bytes, key and nonce
+ * from the "Cryptography in NaCl" box example), whose key is
+ * crypto_box_beforenm of the RFC 7748 section 6.1 key pair.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tweetnacl.h"
+
+#define MSG_LEN 131
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+typedef struct {
+    const char *key;
+    const char *msg;
+    const char *tag;
+} poly1305_vector_t;
+
+static const poly1305_vector_t poly1305_vectors[] = {
+    // RFC 8439 section 2.5.2
+    {"85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b",
+     "43727970746f6772617068696320466f72756d2052657365617263682047726f7570",
+     "a8061dc1305136c6c22b8baf0c0127a9"},
+    // RFC 8439 appendix A.3, vectors 5 to 11
+    {"02000000000000000000000000000000" "00000000000000000000000000000000",
+     "ffffffffffffffffffffffffffffffff",
+     "03000000000000000000000000000000"},
+    {"02000000000000000000000000000000" "ffffffffffffffffffffffffffffffff",
+     "02000000000000000000000000000000",
+     "03000000000000000000000000000000"},
+    {"01000000000000000000000000000000" "00000000000000000000000000000000",
+     "ffffffffffffffffffffffffffffffff" "f0ffffffffffffffffffffffffffffff" "11000000000000000000000000000000",
+     "05000000000000000000000000000000"},
+    {"01000000000000000000000000000000" "00000000000000000000000000000000",
+     "ffffffffffffffffffffffffffffffff" "fbfefefefefefefefefefefefefefefe" "01010101010101010101010101010101",
+     "00000000000000000000000000000000"},
+    {"02000000000000000000000000000000" "00000000000000000000000000000000",
+     "fdffffffffffffffffffffffffffffff",
+     "faffffffffffffffffffffffffffffff"},
+    {"01000000000000000400000000000000" "00000000000000000000000000000000",
+     "e33594d7505e43b90000000000000000" "3394d7505e4379cd0100000000000000" "00000000000000000000000000000000"
+     "01000000000000000000000000000000",
+     "14000000000000005500000000000000"},
+    {"01000000000000000400000000000000" "00000000000000000000000000000000",
+     "e33594d7505e43b90000000000000000" "3394d7505e4379cd0100000000000000" "00000000000000000000000000000000",
+     "13000000000000000000000000000000"},
+};
+
+// NaCl box example (tests/box.c, secretbox.c, onetimeauth.c)
+static const char *nacl_alice_sk = "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a";
+static const char *nacl_bob_pk = "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f";
+static const char *nacl_key = "1b27556473e985d462cd51197a9a46c76009549eac6474f206c4ee0844f68389";
+static const char *nacl_nonce = "69696ee955b62b73cd62bda875fc73d68219e0036b7a0b37";
+static const char *nacl_auth_key = "eea6a7251c1e72916d11c2cb214d3c252539121d8e234e652d651fa4c8cff880";
+static const char *nacl_msg =
+    "be075fc53c81f2d5cf141316ebeb0c7b5228c52a4c62cbd44b66849b64244ffc"
+    "e5ecbaaf33bd751a1ac728d45e6c61296cdc3c01233561f41db66cce314adb31"
+    "0e3be8250c46f06dceea3a7fa1348057e2f6556ad6b1318a024a838f21af1fde"
+    "048977eb48f59ffd4924ca1c60902e52f0a089bc76897040e082f93776384864"
+    "5e0705";
+static const char *nacl_box =
+    "f3ffc7703f9400e52a7dfb4b3d3305d9"
+    "8e993b9f48681273c29650ba32fc76ce48332ea7164d96a4476fb8c531a1186a"
+    "c0dfc17c98dce87b4da7f011ec48c97271d2c20f9b928fe2270d6fb863d51738"
+    "b48eeee314a7cc8ab932164548e526ae90224368517acfeabd6bb3732bc0e9da"
+    "99832b61ca01b6de56244a9e88d5f9b37973f622a43d14a6599b1f654cb45a74"
+    "e355a5";
+
+// SHA-512 of the Poly1305 tags (nacl_auth_key) of nacl_msg[0..n), n = 0..131
+static const char *prefix_tags_sha512 =
+    "823f82a80efef96fa49fac5d746bde2c9b0eae2acc8603cbd67b83fc4d9a91ce"
+    "38820583d1da465d32c4199123a75088d5b679527b858c550c1214d6954e9218";
+
+static int failures;
+
+static size_t unhex(unsigned char *out, const char *hex) {
+    size_t n = strlen(hex) / 2;
+    for (size_t i = 0; i < n; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (unsigned char)byte;
+    }
+    return n;
+}
+
+static void test_poly1305(void) {
+    for (size_t v = 0; v < sizeof(poly1305_vectors) / sizeof(poly1305_vectors[0]); v++) {
+        unsigned char key[32], msg[64], tag[16], want[16];
+        unhex(key, poly1305_vectors[v].key);
+        size_t n = unhex(msg, poly1305_vectors[v].msg);
+        unhex(want, poly1305_vectors[v].tag);
+        CHECK(crypto_onetimeauth(tag, msg, n, key) == 0);
+        CHECK(memcmp(tag, want, 16) == 0);
+        CHECK(crypto_onetimeauth_verify(want, msg, n, key) == 0);
+        want[15] ^= 0x80;
+        CHECK(crypto_onetimeauth_verify(want, msg, n, key) == -1);
+    }
+}
+
+// Tail handling: every length of a message that is not a multiple of 16
+static void test_poly1305_prefixes(void) {
+    unsigned char key[32], msg[MSG_LEN], box[16 + MSG_LEN], tags[16 * (MSG_LEN + 1)];
+    unsigned char digest[64], want_digest[64];
+    unhex(key, nacl_auth_key);
+    unhex(msg, nacl_msg);
+    unhex(box, nacl_box);
+    unhex(want_digest, prefix_tags_sha512);
+
+    for (size_t n = 0; n <= MSG_LEN; n++) {
+        crypto_onetimeauth(tags + 16 * n, msg, n, key);
+    }
+    crypto_hash(digest, tags, sizeof(tags));
+    CHECK(memcmp(digest, want_digest, 64) == 0);
+
+    // NaCl onetimeauth.c: the tag of the box ciphertext is the box's tag
+    unsigned char tag[16];
+    crypto_onetimeauth(tag, box + 16, MSG_LEN, key);
+    CHECK(memcmp(tag, box, 16) == 0);
+}
+
+static void test_secretbox(void) {
+    unsigned char sk[32], pk[32], key[32], want_key[32], nonce[24], auth_key[32], stream[32];
+    unsigned char m[32 + MSG_LEN], c[32 + MSG_LEN], out[32 + MSG_LEN], box[16 + MSG_LEN];
+
+    // Key agreement and HSalsa20 (NaCl box7 / core1)
+    unhex(sk, nacl_alice_sk);
+    unhex(pk, nacl_bob_pk);
+    unhex(want_key, nacl_key);
+    CHECK(crypto_box_beforenm(key, pk, sk) == 0);
+    CHECK(memcmp(key, want_key, 32) == 0);
+
+    // The first 32 bytes of the XSalsa20 stream are the Poly1305 key
+    unhex(nonce, nacl_nonce);
+    unhex(auth_key, nacl_auth_key);
+    CHECK(crypto_stream(stream, sizeof(stream), nonce, key) == 0);
+    CHECK(memcmp(stream, auth_key, 32) == 0);
+
+    memset(m, 0, 32);
+    unhex(m + 32, nacl_msg);
+    unhex(box, nacl_box);
+    CHECK(crypto_secretbox(c, m, sizeof(m), nonce, key) == 0);
+    CHECK(memcmp(c + 16, box, sizeof(box)) == 0);
+    CHECK(crypto_secretbox_open(out, c, sizeof(c), nonce, key) == 0);
+    CHECK(memcmp(out + 32, m + 32, MSG_LEN) == 0);
+
+    // Every shorter message: same keystream, so its ciphertext is a prefix
+    // of the full one, and it opens; a flipped bit does not
+    for (size_t n = 0; n < MSG_LEN; n++) {
+        CHECK(crypto_secretbox(c, m, 32 + n, nonce, key) == 0);
+        CHECK(memcmp(c + 32, box + 16, n) == 0);
+        CHECK(crypto_secretbox_open(out, c, 32 + n, nonce, key) == 0);
+        CHECK(memcmp(out + 32, m + 32, n) == 0);
+        c[16 + n % (16 + n)] ^= 1;
+        CHECK(crypto_secretbox_open(out, c, 32 + n, nonce, key) == -1);
+    }
+}
+
+int main(void) {
+    test_poly1305();
+    test_poly1305_prefixes();
+    test_secretbox();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * SHA-512 (crypto_hash / crypto_hashblocks): NIST vectors, the incremental
+ * API against the one-shot one, and throughput.
+ *
+ * Vectors are the short, two-block and million-'a' messages from the NIST
+ * SHA-512 examples (FIPS 180-2 appendix C). Throughput is printed, not
+ * checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tweetnacl.h"
+
+#define BENCH_LEN 1000000
+#define BENCH_ROUNDS 20
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+typedef struct {
+    const char *msg;
+    const char *digest;
+} nist_vector_t;
+
+static const nist_vector_t vectors[] = {
+    {"",
+     "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+     "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"},
+    {"abc",
+     "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+     "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     "204a8fc6dda82f0a0ced7beb8e08a41657c16ef468b228a8279be331a703c335"
+     "96fd15c13b1b07f9aa1d3bea57789ca031ad85c7a71dd70354ec631238ca3445"},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+     "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+     "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+     "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"},
+};
+
+static const char *million_a_digest =
+    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+    "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b";
+
+static int failures;
+
+static void to_hex(char *out, const unsigned char *digest) {
+    for (int i = 0; i < 64; i++) {
+        sprintf(out + 2 * i, "%02x", digest[i]);
+    }
+}
+
+static void test_vectors(void) {
+    unsigned char digest[64];
+    char hex[129];
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        crypto_hash(digest, (const unsigned char *)vectors[v].msg, strlen(vectors[v].msg));
+        to_hex(hex, digest);
+        CHECK(strcmp(hex, vectors[v].digest) == 0);
+    }
+}
+
+static void test_million_a(unsigned char *buf) {
+    unsigned char digest[64];
+    char hex[129];
+    memset(buf, 'a', BENCH_LEN);
+    crypto_hash(digest, buf, BENCH_LEN);
+    to_hex(hex, digest);
+    CHECK(strcmp(hex, million_a_digest) == 0);
+
+    // Same message fed in uneven pieces
+    crypto_hash_state state;
+    crypto_hash_init(&state);
+    for (size_t off = 0, step = 1; off < BENCH_LEN; off += step, step = step * 3 % 1021 + 1) {
+        size_t n = off + step > BENCH_LEN ? BENCH_LEN - off : step;
+        crypto_hash_update(&state, buf + off, n);
+    }
+    crypto_hash_final(&state, digest);
+    to_hex(hex, digest);
+    CHECK(strcmp(hex, million_a_digest) == 0);
+}
+
+// Every length around the padding and block boundaries, split at random
+static void test_incremental(unsigned char *buf) {
+    unsigned char want[64], got[64], split;
+    for (unsigned long long n = 0; n <= 3 * 128 + 1; n++) {
+        randombytes(buf, n);
+        crypto_hash(want, buf, n);
+        randombytes(&split, 1);
+        unsigned long long first = n ? split % (n + 1) : 0;
+
+        crypto_hash_state state;
+        crypto_hash_init(&state);
+        crypto_hash_update(&state, buf, first);
+        crypto_hash_update(&state, buf + first, n - first);
+        crypto_hash_final(&state, got);
+        CHECK(memcmp(want, got, 64) == 0);
+    }
+}
+
+static void bench(unsigned char *buf) {
+    unsigned char digest[64];
+    randombytes(buf, BENCH_LEN);
+    clock_t start = clock();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        crypto_hash(digest, buf, BENCH_LEN);
+    }
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("crypto_hash: %.1f MB/s (%d x %d bytes)\n",
+           secs > 0 ? BENCH_ROUNDS * (BENCH_LEN / 1e6) / secs : 0.0, BENCH_ROUNDS, BENCH_LEN);
+}
+
+int main(void) {
+    unsigned char *buf = malloc(BENCH_LEN);
+    if (!buf) {
+        return 1;
+    }
+    test_vectors();
+    test_million_a(buf);
+    test_incremental(buf);
+    bench(buf);
+    free(buf);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
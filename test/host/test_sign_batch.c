@@ -0,0 +1,149 @@
+/**
+ * Batched key generation and point encoding against the one-at-a-time code.
+ *
+ * For n = 0 .. 2 * crypto_sign_BATCH + 1, crypto_sign_seed_keypair_batch must
+ * produce byte-for-byte what n calls of crypto_sign_seed_keypair produce, and
+ * crypto_sign_pack_batch must encode each point as pack() does. The points
+ * are public keys decoded with unpackneg and scaled to Z != 1, mixed with the
+ * identity point at the start, middle and end of the batch.
+ *
+ * crypto_sign_seed_keypair itself is checked against RFC 8032 section 7.1,
+ * test 1.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "tweetnacl.h"
+
+#define MAX_N (2 * crypto_sign_BATCH + 1)
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+// RFC 8032 section 7.1, TEST 1
+static const unsigned char rfc8032_seed[32] = {
+    0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+    0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60,
+};
+static const unsigned char rfc8032_pk[32] = {
+    0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+    0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a,
+};
+
+static unsigned char seeds[MAX_N][32];
+static unsigned char pk[MAX_N][32];
+static unsigned char sk[MAX_N][64];
+
+static bool untouched(const void *buf, size_t from, size_t size) {
+    const unsigned char *p = buf;
+    for (size_t i = from; i < size; i++) {
+        if (p[i] != 0xa5) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_seed_keypair_batch(void) {
+    unsigned char bpk[MAX_N][32], bsk[MAX_N][64];
+
+    for (int n = 0; n <= MAX_N; n++) {
+        memset(bpk, 0xa5, sizeof(bpk));
+        memset(bsk, 0xa5, sizeof(bsk));
+        CHECK(crypto_sign_seed_keypair_batch(bpk[0], bsk[0], seeds[0], n) == 0);
+        CHECK(memcmp(bpk, pk, 32 * n) == 0);
+        CHECK(memcmp(bsk, sk, 64 * n) == 0);
+        // Nothing written past the n-th key
+        CHECK(untouched(bpk, 32 * n, sizeof(bpk)));
+        CHECK(untouched(bsk, 64 * n, sizeof(bsk)));
+    }
+
+    // The random variant makes keys that sign and verify
+    unsigned char m[5] = "hello", sm[5 + 64], out[5 + 64];
+    unsigned long long smlen, mlen;
+    CHECK(crypto_sign_keypair_batch(bpk[0], bsk[0], MAX_N) == 0);
+    for (int i = 0; i < MAX_N; i++) {
+        crypto_sign(sm, &smlen, m, sizeof(m), bsk[i]);
+        CHECK(crypto_sign_open(out, &mlen, sm, smlen, bpk[i]) == 0);
+        CHECK(memcmp(bsk[i] + 32, bpk[i], 32) == 0);
+    }
+}
+
+// X, Y, Z, T all times lambda: the same projective point
+static void scale(gf p[4], long long lambda) {
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < 16; i++) {
+            p[c][i] *= lambda;
+        }
+    }
+}
+
+static void set_identity(gf p[4], long long lambda) {
+    memset(p, 0, sizeof(gf) * 4);
+    p[1][0] = lambda;
+    p[2][0] = lambda;
+}
+
+static void test_pack_batch(void) {
+    static const unsigned char identity[32] = {1};
+    gf p[MAX_N][4];
+    unsigned char expect[MAX_N][32], out[MAX_N][32];
+
+    for (int n = 1; n <= MAX_N; n++) {
+        for (int i = 0; i < n; i++) {
+            bool is_identity = i == 0 || i == n / 2 || i == n - 1;
+            // unpackneg yields -A, whose encoding is pk with the sign bit flipped
+            if (is_identity) {
+                set_identity(p[i], 2 + i % 7);
+                memcpy(expect[i], identity, 32);
+            } else {
+                CHECK(unpackneg(p[i], pk[i]) == 0);
+                scale(p[i], 2 + i % 7);
+                memcpy(expect[i], pk[i], 32);
+                expect[i][31] ^= 0x80;
+            }
+        }
+        memset(out, 0, sizeof(out));
+        CHECK(crypto_sign_pack_batch(out[0], p, n) == 0);
+        for (int i = 0; i < n; i++) {
+            CHECK(memcmp(out[i], expect[i], 32) == 0);
+        }
+    }
+
+    // A batch of identities only, and an empty batch
+    for (int i = 0; i < MAX_N; i++) {
+        set_identity(p[i], 1 + i);
+    }
+    memset(out, 0xa5, sizeof(out));
+    CHECK(crypto_sign_pack_batch(out[0], p, MAX_N) == 0);
+    for (int i = 0; i < MAX_N; i++) {
+        CHECK(memcmp(out[i], identity, 32) == 0);
+    }
+    memset(out, 0xa5, sizeof(out));
+    CHECK(crypto_sign_pack_batch(out[0], p, 0) == 0);
+    CHECK(out[0][0] == 0xa5);
+}
+
+int main(void) {
+    unsigned char vpk[32], vsk[64];
+    CHECK(crypto_sign_seed_keypair(vpk, vsk, rfc8032_seed) == 0);
+    CHECK(memcmp(vpk, rfc8032_pk, 32) == 0);
+
+    randombytes(seeds[0], sizeof(seeds));
+    memcpy(seeds[MAX_N / 2], rfc8032_seed, 32);
+    for (int i = 0; i < MAX_N; i++) {
+        CHECK(crypto_sign_seed_keypair(pk[i], sk[i], seeds[i]) == 0);
+        CHECK(memcmp(sk[i], seeds[i], 32) == 0);
+        CHECK(memcmp(sk[i] + 32, pk[i], 32) == 0);
+    }
+
+    test_seed_keypair_batch();
+    test_pack_batch();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
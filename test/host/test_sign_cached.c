@@ -0,0 +1,155 @@
+/**
+ * Cached Ed25519 verification (crypto_sign_open_cached /
+ * crypto_sign_verify_detached_cached) against the uncached functions.
+ *
+ * Valid signatures and forgeries (flipped R, flipped S, wrong key, a public
+ * key that does not decode) must get the same answer from both. The keys
+ * outnumber crypto_sign_KEYCACHE_ENTRIES, so entries are evicted and reused;
+ * the eviction order is checked to be least-recently-used.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "tweetnacl.h"
+
+#define KEYS (3 * crypto_sign_KEYCACHE_ENTRIES)
+#define MAX_MSG 300
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+static unsigned char pk[KEYS][crypto_sign_PUBLICKEYBYTES];
+static unsigned char sk[KEYS][crypto_sign_SECRETKEYBYTES];
+static crypto_sign_keycache cache;
+
+enum { VALID, FLIP_R, FLIP_S, WRONG_KEY, FORGERIES };
+
+static bool cached(const unsigned char *key) {
+    for (int i = 0; i < crypto_sign_KEYCACHE_ENTRIES; i++) {
+        if (cache.e[i].stamp && memcmp(cache.e[i].pk, key, 32) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sign with key k, apply the forgery, and compare both APIs cached and uncached
+static void compare(int k, int forgery, unsigned long long mlen) {
+    unsigned char m[MAX_MSG], sm[MAX_MSG + 64], out1[MAX_MSG + 64], out2[MAX_MSG + 64];
+    unsigned long long smlen, len1, len2;
+    const unsigned char *key = pk[k];
+
+    randombytes(m, mlen);
+    crypto_sign(sm, &smlen, m, mlen, sk[k]);
+
+    switch (forgery) {
+    case FLIP_R:
+        sm[mlen % 32] ^= 1 << (mlen % 8);
+        break;
+    case FLIP_S:
+        sm[32 + mlen % 32] ^= 1 << (mlen % 8);
+        break;
+    case WRONG_KEY:
+        key = pk[(k + 1) % KEYS];
+        break;
+    }
+    int expect = forgery == VALID ? 0 : -1;
+
+    int r1 = crypto_sign_open(out1, &len1, sm, smlen, key);
+    int r2 = crypto_sign_open_cached(out2, &len2, sm, smlen, key, &cache);
+    CHECK(r1 == expect);
+    CHECK(r2 == r1);
+    if (r1 == 0 && r2 == 0) {
+        CHECK(len1 == mlen && len2 == mlen);
+        CHECK(memcmp(out1, m, mlen) == 0 && memcmp(out2, m, mlen) == 0);
+    }
+
+    r1 = crypto_sign_verify_detached(sm, m, mlen, key);
+    r2 = crypto_sign_verify_detached_cached(sm, m, mlen, key, &cache);
+    CHECK(r1 == expect);
+    CHECK(r2 == r1);
+
+    // Whatever the outcome, a key that decodes stays cached for reuse
+    CHECK(cached(key));
+}
+
+// Touch keys 0..ENTRIES-1, refresh key 0, then add one more: key 1 goes
+static void test_lru_order(void) {
+    crypto_sign_keycache_init(&cache);
+    for (int k = 0; k < crypto_sign_KEYCACHE_ENTRIES; k++) {
+        compare(k, VALID, 10);
+    }
+    for (int k = 0; k < crypto_sign_KEYCACHE_ENTRIES; k++) {
+        CHECK(cached(pk[k]));
+    }
+
+    compare(0, FLIP_S, 20);
+    compare(crypto_sign_KEYCACHE_ENTRIES, VALID, 30);
+    CHECK(cached(pk[0]));
+    CHECK(!cached(pk[1]));
+    for (int k = 2; k <= crypto_sign_KEYCACHE_ENTRIES; k++) {
+        CHECK(cached(pk[k]));
+    }
+
+    // The evicted key comes back and verifies as before
+    compare(1, VALID, 40);
+    compare(1, FLIP_R, 40);
+}
+
+// Working sets below, at and above the cache size, every forgery kind
+static void test_patterns(void) {
+    static const int working_sets[] = {1, crypto_sign_KEYCACHE_ENTRIES, crypto_sign_KEYCACHE_ENTRIES + 1, KEYS};
+
+    for (size_t w = 0; w < sizeof(working_sets) / sizeof(working_sets[0]); w++) {
+        crypto_sign_keycache_init(&cache);
+        for (int i = 0; i < 6 * KEYS; i++) {
+            int k = i % working_sets[w];
+            compare(k, i % FORGERIES, (unsigned long long)(i * 37) % MAX_MSG);
+        }
+    }
+}
+
+// A public key that does not decode fails both ways and leaves no entry
+static void test_bad_key(void) {
+    unsigned char m[16] = {0}, sig[64 + sizeof(m)], bad[32];
+    unsigned long long siglen;
+    int found = 0;
+
+    crypto_sign_keycache_init(&cache);
+    crypto_sign(sig, &siglen, m, sizeof(m), sk[0]);
+    for (int tries = 0; tries < 1000 && !found; tries++) {
+        gf q[4];
+        randombytes(bad, sizeof(bad));
+        found = unpackneg(q, bad) != 0;
+    }
+    CHECK(found);
+
+    for (int k = 0; k < crypto_sign_KEYCACHE_ENTRIES; k++) {
+        compare(k, VALID, 8);
+    }
+    CHECK(crypto_sign_verify_detached(sig, m, sizeof(m), bad) == -1);
+    CHECK(crypto_sign_verify_detached_cached(sig, m, sizeof(m), bad, &cache) == -1);
+    CHECK(!cached(bad));
+
+    // The slot it took is free again and the other keys still verify
+    for (int k = 0; k < KEYS; k++) {
+        compare(k, VALID, 8);
+    }
+}
+
+int main(void) {
+    for (int k = 0; k < KEYS; k++) {
+        crypto_sign_keypair(pk[k], sk[k]);
+    }
+
+    test_lru_order();
+    test_patterns();
+    test_bad_key();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
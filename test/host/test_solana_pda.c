@@ -0,0 +1,196 @@
+/**
+ * solana_pda: known addresses, and find / find_batch against a sequential
+ * reference (solana_pda_create with bumps from 255 down, the definition of
+ * Pubkey::find_program_address).
+ *
+ * The helloWorld vector is the one in the Solana documentation on program
+ * derived addresses (System Program, bump 254). The ATA and low-bump vectors
+ * come from an independent Python derivation that reproduces it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "solana_pda.h"
+
+#define RANDOM_ROUNDS 200
+#define MAX_BATCH 9             // Past PDA_LOCAL_STATES, so the state is malloc'd
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+static void from_hex(uint8_t *out, const char *hex) {
+    for (size_t i = 0; hex[2 * i]; i++) {
+        unsigned byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (uint8_t)byte;
+    }
+}
+
+/**
+ * @brief find_program_address, one bump at a time in this thread
+ */
+static esp_err_t reference_find(const uint8_t **seeds, const size_t *seed_lens, size_t num_seeds,
+                                const uint8_t *program_id, uint8_t *address_out, uint8_t *bump_out) {
+    const uint8_t *all[SOLANA_PDA_MAX_SEEDS];
+    size_t lens[SOLANA_PDA_MAX_SEEDS];
+    memcpy(all, seeds, num_seeds * sizeof(seeds[0]));
+    memcpy(lens, seed_lens, num_seeds * sizeof(seed_lens[0]));
+    for (int bump = 255; bump >= 0; bump--) {
+        uint8_t b = (uint8_t)bump;
+        all[num_seeds] = &b;
+        lens[num_seeds] = 1;
+        if (solana_pda_create(all, lens, num_seeds + 1, program_id, address_out) == ESP_OK) {
+            *bump_out = b;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+typedef struct {
+    const char *seeds[3];       // Hex, NULL-terminated list; "" is an empty seed
+    const char *program_id;
+    const char *address;
+    uint8_t bump;
+} pda_vector_t;
+
+#define SYSTEM_PROGRAM "0000000000000000000000000000000000000000000000000000000000000000"
+#define TOKEN_PROGRAM "06ddf6e1d765a193d9cbe146ceeb79ac1cb485ed5f5b37913a8cf5857eff00a9"
+#define ATA_PROGRAM "8c97258f4e2489f1bb3d1029148e0d830b5a1399daff1084048e7bd8dbe9f859"
+#define USDC_MINT "c6fa7af3bedbad3a3d65f36aabc97431b1bbe4c2d2f6e0e47ca60203452f5d61"
+#define WALLET "7e8c088760bfde1dddcf32c17f209b8242ee52aaf131facd88d0ea2c6d0b06f2"
+
+static const pda_vector_t vectors[] = {
+    // "helloWorld" -> 46GZzzetjCURsdFPb7rcnspbEMnCBXe9kpjrsZAkKb6X
+    {{"68656c6c6f576f726c64"}, SYSTEM_PROGRAM,
+     "2dec9196d688fdadb0a440a549ba06731727664eef6d5bb27614f47a1c312928", 254},
+    // USDC ATA of 9WzDXwBbmkg8ZTbNMqUxvQRAyrZzDsGYdLVL9zYtAWWM ->
+    // FGETo8T8wMcN2wCjav8VK6eh3dLk63evNDPxzLSJra8B
+    {{WALLET, TOKEN_PROGRAM, USDC_MINT}, ATA_PROGRAM,
+     "d3ea8cf5acaca8cd05207512175c43cef54a5dd99ede20a16b55253738f397dc", 254},
+    // "seed34": bumps 255 to 250 are on the curve
+    {{"736565643334"}, SYSTEM_PROGRAM,
+     "1e46bfee91f036d6cc60ad68b815d54f8ee59db1a4480aa42d6ac2531b2f67a5", 249},
+    // An empty seed and a full-length one, first bump off the curve
+    {{"", "7878787878787878787878787878787878787878787878787878787878787878"}, TOKEN_PROGRAM,
+     "d5eb3fb07c0761926b3ee1773b1b61b41f3881e0ee61b53ff882cbca65fffe7f", 255},
+};
+
+#define NUM_VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+static void test_vectors(void) {
+    uint8_t seed_buf[NUM_VECTORS][3][32];
+    const uint8_t *seeds[NUM_VECTORS][3];
+    size_t lens[NUM_VECTORS][3];
+    uint8_t program_id[NUM_VECTORS][32];
+    uint8_t want[NUM_VECTORS][32];
+    solana_pda_request_t requests[NUM_VECTORS];
+
+    for (size_t v = 0; v < NUM_VECTORS; v++) {
+        size_t n = 0;
+        while (n < 3 && vectors[v].seeds[n]) {
+            lens[v][n] = strlen(vectors[v].seeds[n]) / 2;
+            from_hex(seed_buf[v][n], vectors[v].seeds[n]);
+            seeds[v][n] = seed_buf[v][n];
+            n++;
+        }
+        from_hex(program_id[v], vectors[v].program_id);
+        from_hex(want[v], vectors[v].address);
+
+        uint8_t address[32], bump = 0;
+        CHECK(solana_pda_find(seeds[v], lens[v], n, program_id[v], address, &bump) == ESP_OK);
+        CHECK(memcmp(address, want[v], 32) == 0);
+        CHECK(bump == vectors[v].bump);
+
+        memset(&requests[v], 0, sizeof(requests[v]));
+        requests[v].seeds = seeds[v];
+        requests[v].seed_lens = lens[v];
+        requests[v].num_seeds = n;
+        requests[v].program_id = program_id[v];
+    }
+
+    CHECK(solana_pda_find_batch(requests, NUM_VECTORS) == ESP_OK);
+    for (size_t v = 0; v < NUM_VECTORS; v++) {
+        CHECK(requests[v].err == ESP_OK);
+        CHECK(memcmp(requests[v].address, want[v], 32) == 0);
+        CHECK(requests[v].bump == vectors[v].bump);
+    }
+}
+
+// Random seeds in batches of 1..MAX_BATCH: batch, single and reference agree
+static void test_random(void) {
+    uint8_t seed_buf[MAX_BATCH][2][32];
+    const uint8_t *seeds[MAX_BATCH][2];
+    size_t lens[MAX_BATCH][2];
+    uint8_t program_id[32];
+    solana_pda_request_t requests[MAX_BATCH];
+
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        size_t count = 1 + round % MAX_BATCH;
+        randombytes(program_id, sizeof(program_id));
+        for (size_t i = 0; i < count; i++) {
+            uint8_t len;
+            randombytes(&len, 1);
+            randombytes(&seed_buf[i][0][0], sizeof(seed_buf[i]));
+            lens[i][0] = 32;
+            lens[i][1] = len % 33;
+            seeds[i][0] = seed_buf[i][0];
+            seeds[i][1] = seed_buf[i][1];
+            memset(&requests[i], 0, sizeof(requests[i]));
+            requests[i].seeds = seeds[i];
+            requests[i].seed_lens = lens[i];
+            requests[i].num_seeds = 2;
+            requests[i].program_id = program_id;
+        }
+
+        CHECK(solana_pda_find_batch(requests, count) == ESP_OK);
+        for (size_t i = 0; i < count; i++) {
+            uint8_t want[32], want_bump = 0, single[32], single_bump = 0;
+            CHECK(reference_find(seeds[i], lens[i], 2, program_id, want, &want_bump) == ESP_OK);
+            CHECK(solana_pda_find(seeds[i], lens[i], 2, program_id, single, &single_bump) == ESP_OK);
+            CHECK(requests[i].err == ESP_OK);
+            CHECK(memcmp(requests[i].address, want, 32) == 0 && requests[i].bump == want_bump);
+            CHECK(memcmp(single, want, 32) == 0 && single_bump == want_bump);
+        }
+    }
+}
+
+// Invalid entries fail on their own; the rest of the batch is still derived
+static void test_invalid(void) {
+    uint8_t seed[33] = {0}, program_id[32] = {0}, address[32];
+    const uint8_t *seeds[SOLANA_PDA_MAX_SEEDS];
+    size_t lens[SOLANA_PDA_MAX_SEEDS];
+    for (int i = 0; i < SOLANA_PDA_MAX_SEEDS; i++) {
+        seeds[i] = seed;
+        lens[i] = 1;
+    }
+
+    size_t too_long = 33;
+    CHECK(solana_pda_find(seeds, &too_long, 1, program_id, address, NULL) == ESP_ERR_INVALID_ARG);
+    // The bump takes the last seed slot
+    CHECK(solana_pda_find(seeds, lens, SOLANA_PDA_MAX_SEEDS, program_id, address, NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(solana_pda_find(seeds, lens, SOLANA_PDA_MAX_SEEDS - 1, program_id, address, NULL) == ESP_OK);
+    CHECK(solana_pda_find(seeds, lens, 1, NULL, address, NULL) == ESP_ERR_INVALID_ARG);
+
+    solana_pda_request_t requests[3] = {
+        {.seeds = seeds, .seed_lens = lens, .num_seeds = 1, .program_id = program_id},
+        {.seeds = seeds, .seed_lens = &too_long, .num_seeds = 1, .program_id = program_id},
+        {.seeds = seeds, .seed_lens = lens, .num_seeds = 2, .program_id = program_id},
+    };
+    CHECK(solana_pda_find_batch(requests, 3) == ESP_ERR_INVALID_ARG);
+    CHECK(requests[0].err == ESP_OK && requests[1].err == ESP_ERR_INVALID_ARG && requests[2].err == ESP_OK);
+    CHECK(solana_pda_find_batch(NULL, 0) == ESP_OK);
+    CHECK(solana_pda_find_batch(NULL, 1) == ESP_ERR_INVALID_ARG);
+}
+
+int main(void) {
+    test_vectors();
+    test_random();
+    test_invalid();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
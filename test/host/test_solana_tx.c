@@ -0,0 +1,317 @@
+/**
+ * solana_tx wire format: solana_tx_wire_parse on legacy and v0 messages,
+ * compact-u16 lengths, truncated and inconsistent input, and re-signing
+ * under a new blockhash (solana_tx_set_blockhash on the builder,
+ * x402_payment_refresh_blockhash on a serialized payment).
+ *
+ * The wallet, RPC and x402 encoding that x402_payment.c links against are
+ * stubbed below; signatures are real Ed25519 (TweetNaCl).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "solana_tx.h"
+#include "solana_wallet.h"
+#include "solana_rpc.h"
+#include "spl_token.h"
+#include "base58.h"
+#include "bulk_mem.h"
+#include "x402_payment.h"
+#include "x402_encoding.h"
+#include "tweetnacl.h"
+#include "mbedtls/base64.h"
+
+#define TX_BASE64_SIZE 4096     // As allocated by x402_create_solana_payment
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+// Stubs for the components x402_payment.c links against
+
+struct solana_wallet_t {
+    uint8_t public_key[32];
+    uint8_t secret_key[64];
+    crypto_sign_scratch scratch;
+};
+
+static uint8_t s_rpc_blockhash[32];
+static esp_err_t s_rpc_err;
+
+solana_rpc_handle_t solana_rpc_init(const char *rpc_url) {
+    static int dummy;
+    (void)rpc_url;
+    return (solana_rpc_handle_t)&dummy;
+}
+
+esp_err_t solana_rpc_get_blockhash(solana_rpc_handle_t client, uint8_t *blockhash_out,
+                                   uint64_t *last_valid_block_height) {
+    (void)client;
+    (void)last_valid_block_height;
+    if (s_rpc_err == ESP_OK) {
+        memcpy(blockhash_out, s_rpc_blockhash, 32);
+    }
+    return s_rpc_err;
+}
+
+esp_err_t solana_wallet_get_pubkey(solana_wallet_t *wallet, uint8_t *pubkey_out) {
+    memcpy(pubkey_out, wallet->public_key, 32);
+    return ESP_OK;
+}
+
+esp_err_t solana_wallet_sign(solana_wallet_t *wallet, const uint8_t *message,
+                             size_t message_len, uint8_t *signature_out) {
+    return crypto_sign_detached_scratch(signature_out, message, message_len, wallet->secret_key,
+                                        &wallet->scratch) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t spl_token_get_mint_program(const char *rpc_url, const uint8_t *mint_pubkey,
+                                     uint8_t *program_id_out) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spl_token_create_transfer_transaction(const uint8_t *fee_payer, const uint8_t *from_wallet,
+                                                const uint8_t *to_wallet, const uint8_t *mint,
+                                                const uint8_t *token_program_id, uint64_t amount,
+                                                const uint8_t *recent_blockhash, uint8_t *tx_out,
+                                                size_t *tx_len, size_t max_tx_len) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t x402_base64_encode(const uint8_t *data, size_t data_len, char *encoded_out,
+                             size_t max_len, size_t *out_len) {
+    return mbedtls_base64_encode((unsigned char *)encoded_out, max_len, out_len, data, data_len) == 0
+           ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+void *bulk_alloc(size_t size) {
+    return malloc(size);
+}
+
+static void wallet_init(solana_wallet_t *wallet) {
+    crypto_sign_keypair(wallet->public_key, wallet->secret_key);
+}
+
+static bool verify(const uint8_t *tx, size_t tx_len, const solana_tx_wire_layout_t *layout,
+                   size_t slot, const uint8_t *pubkey) {
+    return crypto_sign_verify_detached(tx + layout->signatures_offset + slot * 64,
+                                       tx + layout->message_offset, tx_len - layout->message_offset,
+                                       pubkey) == 0;
+}
+
+/**
+ * @brief Wire transaction with zeroed signatures
+ *
+ * @param version -1 for a legacy message, else the v0.. version byte
+ */
+static size_t build_wire(uint8_t *out, size_t signatures, int version, size_t required,
+                         const uint8_t (*accounts)[32], size_t account_count, const uint8_t *blockhash) {
+    uint8_t *p = out;
+    p += signatures <= 0x7f ? (*p = (uint8_t)signatures, 1)
+                            : (p[0] = (uint8_t)(signatures | 0x80), p[1] = (uint8_t)(signatures >> 7), 2);
+    memset(p, 0, signatures * 64);
+    p += signatures * 64;
+    if (version >= 0) {
+        *p++ = (uint8_t)(0x80 | version);
+    }
+    *p++ = (uint8_t)required;
+    *p++ = 0;                           // Read-only signed
+    *p++ = 1;                           // Read-only unsigned
+    p += account_count <= 0x7f ? (*p = (uint8_t)account_count, 1)
+                               : (p[0] = (uint8_t)(account_count | 0x80), p[1] = (uint8_t)(account_count >> 7), 2);
+    memcpy(p, accounts, account_count * 32);
+    p += account_count * 32;
+    memcpy(p, blockhash, 32);
+    p += 32;
+    *p++ = 1;                           // One instruction: program 2, accounts 0 and 1, data "x"
+    *p++ = 2;
+    *p++ = 2;
+    *p++ = 0;
+    *p++ = 1;
+    *p++ = 1;
+    *p++ = 'x';
+    if (version >= 0) {
+        *p++ = 0;                       // No address table lookups
+    }
+    return (size_t)(p - out);
+}
+
+// Builder: sign, serialize, parse; a new blockhash needs a new signature
+static void test_builder(void) {
+    solana_wallet_t wallet;
+    wallet_init(&wallet);
+    solana_pubkey_t payer, to;
+    memcpy(payer.data, wallet.public_key, 32);
+    randombytes(to.data, 32);
+    uint8_t blockhash[32], new_blockhash[32];
+    char blockhash58[64];
+    randombytes(blockhash, 32);
+    randombytes(new_blockhash, 32);
+    CHECK(base58_encode(blockhash, 32, blockhash58, sizeof(blockhash58)));
+
+    solana_tx_t *tx = solana_tx_new(blockhash58, &payer);
+    CHECK(tx && solana_tx_add_transfer(tx, &payer, &to, 5000) == ESP_OK);
+    uint8_t message[512], signature[64], wire[512];
+    size_t message_len, wire_len;
+    CHECK(solana_tx_get_message(tx, message, &message_len, sizeof(message)) == ESP_OK);
+    CHECK(solana_wallet_sign(&wallet, message, message_len, signature) == ESP_OK);
+    CHECK(solana_tx_add_signature(tx, signature) == ESP_OK);
+    CHECK(solana_tx_serialize(tx, wire, &wire_len, sizeof(wire)) == ESP_OK);
+
+    solana_tx_wire_layout_t layout;
+    CHECK(solana_tx_wire_parse(wire, wire_len, &layout) == ESP_OK);
+    CHECK(layout.signature_count == 1 && layout.signatures_offset == 1 && layout.message_offset == 65);
+    CHECK(layout.required_signatures == 1 && layout.account_count == 3);
+    CHECK(memcmp(wire + layout.accounts_offset, payer.data, 32) == 0);
+    CHECK(memcmp(wire + layout.blockhash_offset, blockhash, 32) == 0);
+    CHECK(wire_len - layout.message_offset == message_len);
+    CHECK(verify(wire, wire_len, &layout, 0, payer.data));
+
+    // Every prefix short of the blockhash is refused
+    for (size_t len = 0; len < layout.blockhash_offset + 32; len++) {
+        solana_tx_wire_layout_t partial;
+        CHECK(solana_tx_wire_parse(wire, len, &partial) == ESP_ERR_INVALID_SIZE);
+    }
+
+    CHECK(solana_tx_set_blockhash(tx, new_blockhash) == ESP_OK);
+    CHECK(solana_tx_serialize(tx, wire, &wire_len, sizeof(wire)) != ESP_OK);
+    CHECK(solana_tx_get_message(tx, message, &message_len, sizeof(message)) == ESP_OK);
+    CHECK(solana_wallet_sign(&wallet, message, message_len, signature) == ESP_OK);
+    CHECK(solana_tx_add_signature(tx, signature) == ESP_OK);
+    CHECK(solana_tx_serialize(tx, wire, &wire_len, sizeof(wire)) == ESP_OK);
+    CHECK(solana_tx_wire_parse(wire, wire_len, &layout) == ESP_OK);
+    CHECK(memcmp(wire + layout.blockhash_offset, new_blockhash, 32) == 0);
+    CHECK(verify(wire, wire_len, &layout, 0, payer.data));
+    solana_tx_destroy(tx);
+}
+
+// Legacy and v0 messages, compact-u16 lengths past 127, inconsistent counts
+static void test_wire_parse(void) {
+    static uint8_t accounts[300][32];
+    static uint8_t wire[2 + 130 * 64 + 4 + 2 + 300 * 32 + 32 + 16];
+    uint8_t blockhash[32];
+    randombytes(&accounts[0][0], sizeof(accounts));
+    randombytes(blockhash, 32);
+    solana_tx_wire_layout_t layout;
+
+    size_t len = build_wire(wire, 2, 0, 2, accounts, 3, blockhash);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_OK);
+    CHECK(layout.signature_count == 2 && layout.message_offset == 1 + 128);
+    CHECK(layout.required_signatures == 2 && layout.account_count == 3);
+    CHECK(layout.accounts_offset == 129 + 1 + 3 + 1);
+    CHECK(memcmp(wire + layout.blockhash_offset, blockhash, 32) == 0);
+
+    len = build_wire(wire, 2, -1, 2, accounts, 3, blockhash);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_OK);
+    CHECK(layout.accounts_offset == 129 + 3 + 1 && memcmp(wire + layout.blockhash_offset, blockhash, 32) == 0);
+
+    // 130 signatures and 300 accounts: two-byte compact-u16 on both
+    len = build_wire(wire, 130, 0, 130, accounts, 300, blockhash);
+    CHECK(wire[0] == 0x82 && wire[1] == 0x01);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_OK);
+    CHECK(layout.signature_count == 130 && layout.signatures_offset == 2);
+    CHECK(layout.message_offset == 2 + 130 * 64);
+    CHECK(layout.required_signatures == 130 && layout.account_count == 300);
+    CHECK(layout.accounts_offset == layout.message_offset + 1 + 3 + 2);
+    CHECK(memcmp(wire + layout.accounts_offset + 299 * 32, accounts[299], 32) == 0);
+    CHECK(memcmp(wire + layout.blockhash_offset, blockhash, 32) == 0);
+    CHECK(solana_tx_wire_parse(wire, layout.blockhash_offset + 31, &layout) == ESP_ERR_INVALID_SIZE);
+
+    // Signature count and header disagree, either way
+    len = build_wire(wire, 2, 0, 1, accounts, 3, blockhash);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_ERR_INVALID_SIZE);
+    len = build_wire(wire, 1, -1, 2, accounts, 3, blockhash);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_ERR_INVALID_SIZE);
+    // More signers than accounts
+    len = build_wire(wire, 4, 0, 4, accounts, 3, blockhash);
+    CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_ERR_INVALID_SIZE);
+
+    // Compact-u16 cut short, or longer than three bytes
+    const uint8_t short_count[] = { 0x82 };
+    CHECK(solana_tx_wire_parse(short_count, sizeof(short_count), &layout) == ESP_ERR_INVALID_SIZE);
+    const uint8_t long_count[] = { 0x80, 0x80, 0x80, 0x01 };
+    CHECK(solana_tx_wire_parse(long_count, sizeof(long_count), &layout) == ESP_ERR_INVALID_SIZE);
+    CHECK(solana_tx_wire_parse(NULL, 0, &layout) == ESP_ERR_INVALID_ARG);
+}
+
+static char *payload_encode(const uint8_t *wire, size_t len) {
+    char *b64 = malloc(TX_BASE64_SIZE);
+    size_t b64_len;
+    if (b64 && x402_base64_encode(wire, len, b64, TX_BASE64_SIZE, &b64_len) != ESP_OK) {
+        free(b64);
+        return NULL;
+    }
+    return b64;
+}
+
+static size_t payload_decode(const x402_payment_payload_t *payload, uint8_t *wire, size_t max_len) {
+    size_t len = 0;
+    const char *b64 = payload->payload.transaction;
+    if (mbedtls_base64_decode(wire, max_len, &len, (const unsigned char *)b64, strlen(b64)) != 0) {
+        return 0;
+    }
+    return len;
+}
+
+// A payment (fee payer slot empty, wallet second) re-signed in place
+static void test_refresh_blockhash(void) {
+    solana_wallet_t wallet, stranger;
+    wallet_init(&wallet);
+    wallet_init(&stranger);
+    uint8_t accounts[3][32], old_blockhash[32], wire[1024], before[1024], after[1024];
+    randombytes(accounts[0], 32);                   // Fee payer (facilitator)
+    memcpy(accounts[1], wallet.public_key, 32);
+    randombytes(accounts[2], 32);                   // Token program
+    randombytes(old_blockhash, 32);
+    randombytes(s_rpc_blockhash, 32);
+
+    for (int version = -1; version <= 0; version++) {
+        size_t len = build_wire(wire, 2, version, 2, accounts, 3, old_blockhash);
+        solana_tx_wire_layout_t layout;
+        CHECK(solana_tx_wire_parse(wire, len, &layout) == ESP_OK);
+        CHECK(solana_wallet_sign(&wallet, wire + layout.message_offset, len - layout.message_offset,
+                                 wire + layout.signatures_offset + 64) == ESP_OK);
+        memcpy(before, wire, len);
+
+        x402_payment_payload_t payload = { .x402_version = 1 };
+        payload.payload.transaction = payload_encode(wire, len);
+        CHECK(payload.payload.transaction != NULL);
+
+        // RPC down: the payment is left as it was
+        s_rpc_err = ESP_ERR_TIMEOUT;
+        CHECK(x402_payment_refresh_blockhash(&wallet, &payload) == ESP_ERR_TIMEOUT);
+        CHECK(payload_decode(&payload, after, sizeof(after)) == len && memcmp(after, before, len) == 0);
+        s_rpc_err = ESP_OK;
+
+        // Not a signer of this transaction
+        CHECK(x402_payment_refresh_blockhash(&stranger, &payload) == ESP_ERR_INVALID_ARG);
+
+        CHECK(x402_payment_refresh_blockhash(&wallet, &payload) == ESP_OK);
+        CHECK(payload_decode(&payload, after, sizeof(after)) == len);
+        CHECK(solana_tx_wire_parse(after, len, &layout) == ESP_OK);
+        CHECK(memcmp(after + layout.blockhash_offset, s_rpc_blockhash, 32) == 0);
+        static const uint8_t zero[64];
+        CHECK(memcmp(after + layout.signatures_offset, zero, 64) == 0);
+        CHECK(verify(after, len, &layout, 1, wallet.public_key));
+        // The old signature does not cover the new message
+        memcpy(after + layout.signatures_offset + 64, before + layout.signatures_offset + 64, 64);
+        CHECK(!verify(after, len, &layout, 1, wallet.public_key));
+        // Nothing else moved
+        CHECK(memcmp(after + layout.message_offset, before + layout.message_offset,
+                     layout.blockhash_offset - layout.message_offset) == 0);
+        CHECK(memcmp(after + layout.blockhash_offset + 32, before + layout.blockhash_offset + 32,
+                     len - layout.blockhash_offset - 32) == 0);
+        x402_payment_free(&payload);
+    }
+}
+
+int main(void) {
+    test_builder();
+    test_wire_parse();
+    test_refresh_blockhash();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * Ed25519 sign/verify: RFC 8032 vectors, agreement between the classic and
+ * *_scratch entry points, and peak stack depth of each.
+ *
+ * Each call runs on a painted 64 KB stack (ucontext); the peak is the number
+ * of bytes no longer holding the paint. The *_scratch variants must stay
+ * under STACK_LIMIT in every mode, the classic ones only with
+ * CONFIG_TWEETNACL_SMALL_STACK.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ucontext.h>
+#include "tweetnacl.h"
+
+#define STACK_LIMIT 1536            // ~1.3 KB measured, plus compiler headroom
+#define MSG_LEN 1024
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+typedef struct {
+    const char *seed;
+    const char *pk;
+    const char *msg;
+    const char *sig;
+} rfc8032_vector_t;
+
+// RFC 8032 section 7.1, tests 1 to 3
+static const rfc8032_vector_t vectors[] = {
+    {"9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+     "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+     "",
+     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+     "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+    {"4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+     "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+     "72",
+     "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+     "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+    {"c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+     "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+     "af82",
+     "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+     "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"},
+};
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+static unsigned char pk[32], sk[64], msg[MSG_LEN], sm[MSG_LEN + 64], out[MSG_LEN + 64], sig[64];
+static crypto_sign_scratch scratch;
+
+static ucontext_t call_ctx, main_ctx;
+static unsigned char call_stack[65536];
+static int call_which;
+
+static size_t unhex(unsigned char *out, const char *hex) {
+    size_t n = strlen(hex) / 2;
+    for (size_t i = 0; i < n; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (unsigned char)byte;
+    }
+    return n;
+}
+
+static void test_vectors(void) {
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        unsigned char seed[32], want_pk[32], want_sig[64], m[8];
+        unhex(seed, vectors[v].seed);
+        unhex(want_pk, vectors[v].pk);
+        unhex(want_sig, vectors[v].sig);
+        size_t n = unhex(m, vectors[v].msg);
+
+        crypto_sign_seed_keypair_batch(pk, sk, seed, 1);
+        CHECK(memcmp(pk, want_pk, 32) == 0);
+
+        unsigned long long smlen;
+        crypto_sign(sm, &smlen, m, n, sk);
+        CHECK(smlen == n + 64 && memcmp(sm, want_sig, 64) == 0);
+        CHECK(crypto_sign_detached_scratch(sig, m, n, sk, &scratch) == 0);
+        CHECK(memcmp(sig, want_sig, 64) == 0);
+        CHECK(crypto_sign_verify_detached(want_sig, m, n, pk) == 0);
+        CHECK(crypto_sign_verify_detached_scratch(want_sig, m, n, pk, &scratch) == 0);
+    }
+}
+
+// Random messages: both signers agree, all verifiers agree on good and tampered input
+static void test_agreement(void) {
+    crypto_sign_keypair(pk, sk);
+    for (int it = 0; it < 300; it++) {
+        unsigned long long n = (unsigned long long)(it * 7) % (MSG_LEN + 1);
+        unsigned long long smlen, outlen;
+        randombytes(msg, n);
+        crypto_sign(sm, &smlen, msg, n, sk);
+        CHECK(crypto_sign_detached_scratch(sig, msg, n, sk, &scratch) == 0);
+        CHECK(memcmp(sig, sm, 64) == 0);
+
+        int tampered = it % 3;
+        if (tampered == 1) {
+            sm[it % 64] ^= 1 << (it % 8);
+        } else if (tampered == 2 && n) {
+            sm[64 + it % n] ^= 1;
+        } else {
+            tampered = 0;
+        }
+        int want = tampered ? -1 : 0;
+        CHECK(crypto_sign_open(out, &outlen, sm, smlen, pk) == want);
+        CHECK(crypto_sign_verify_detached(sm, sm + 64, n, pk) == want);
+        CHECK(crypto_sign_verify_detached_scratch(sm, sm + 64, n, pk, &scratch) == want);
+    }
+}
+
+static void stack_call(void) {
+    unsigned long long len;
+    switch (call_which) {
+    case 0: crypto_sign_detached_scratch(sig, msg, MSG_LEN, sk, &scratch); break;
+    case 1: crypto_sign_verify_detached_scratch(sig, msg, MSG_LEN, pk, &scratch); break;
+    case 2: crypto_sign(sm, &len, msg, MSG_LEN, sk); break;
+    case 3: crypto_sign_verify_detached(sig, msg, MSG_LEN, pk); break;
+    case 4: crypto_sign_open(out, &len, sm, MSG_LEN + 64, pk); break;
+    }
+}
+
+static size_t stack_depth(int which) {
+    call_which = which;
+    memset(call_stack, 0xa5, sizeof(call_stack));
+    getcontext(&call_ctx);
+    call_ctx.uc_stack.ss_sp = call_stack;
+    call_ctx.uc_stack.ss_size = sizeof(call_stack);
+    call_ctx.uc_link = &main_ctx;
+    makecontext(&call_ctx, stack_call, 0);
+    swapcontext(&main_ctx, &call_ctx);
+
+    size_t untouched = 0;
+    while (untouched < sizeof(call_stack) && call_stack[untouched] == 0xa5) {
+        untouched++;
+    }
+    return sizeof(call_stack) - untouched;
+}
+
+static void test_stack_depth(void) {
+    static const char *names[] = {
+        "crypto_sign_detached_scratch", "crypto_sign_verify_detached_scratch",
+        "crypto_sign", "crypto_sign_verify_detached", "crypto_sign_open",
+    };
+    unsigned long long smlen;
+    crypto_sign_keypair(pk, sk);
+    randombytes(msg, MSG_LEN);
+    crypto_sign(sm, &smlen, msg, MSG_LEN, sk);
+    memcpy(sig, sm, 64);
+
+#ifdef CONFIG_TWEETNACL_SMALL_STACK
+    const int bounded = 5;
+#else
+    const int bounded = 2;
+#endif
+    for (int i = 0; i < 5; i++) {
+        size_t depth = stack_depth(i);
+        printf("%-36s peak stack %5zu bytes\n", names[i], depth);
+        if (i < bounded) {
+            CHECK(depth < STACK_LIMIT);
+        }
+    }
+    printf("sizeof(crypto_sign_scratch) = %zu\n", sizeof(crypto_sign_scratch));
+}
+
+int main(void) {
+    test_vectors();
+    test_agreement();
+    test_stack_depth();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
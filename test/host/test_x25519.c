@@ -0,0 +1,127 @@
+/**
+ * X25519 (crypto_scalarmult / crypto_scalarmult_base): RFC 7748 vectors.
+ *
+ * Section 5.2: both single-shot vectors (the second has the top bit of u
+ * set, which must be masked) and the iterated one after 1 and 1000 rounds.
+ * Section 6.1: the Diffie-Hellman key pairs and their shared secret. On top
+ * of those, a u with bit 255 set must give the same result as with it clear,
+ * and the non-canonical u = 2^255 - 1 the same as u = 18 (its value mod p).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tweetnacl.h"
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+typedef struct {
+    const char *scalar;
+    const char *u;
+    const char *out;
+} rfc7748_vector_t;
+
+// RFC 7748 section 5.2
+static const rfc7748_vector_t vectors[] = {
+    {"a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+     "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+     "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552"},
+    {"4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+     "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+     "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957"},
+};
+
+static const char *iterated_1 = "422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079";
+static const char *iterated_1000 = "684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51";
+
+// RFC 7748 section 6.1
+static const char *alice_sk = "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a";
+static const char *alice_pk = "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a";
+static const char *bob_sk = "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb";
+static const char *bob_pk = "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f";
+static const char *shared = "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742";
+
+extern void randombytes(unsigned char *buf, unsigned long long len);
+
+static int failures;
+
+static void unhex(unsigned char *out, const char *hex) {
+    for (size_t i = 0; i < 32; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (unsigned char)byte;
+    }
+}
+
+static int equals_hex(const unsigned char *got, const char *hex) {
+    unsigned char want[32];
+    unhex(want, hex);
+    return memcmp(got, want, 32) == 0;
+}
+
+static void test_vectors(void) {
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        unsigned char n[32], p[32], q[32];
+        unhex(n, vectors[v].scalar);
+        unhex(p, vectors[v].u);
+        CHECK(crypto_scalarmult(q, n, p) == 0);
+        CHECK(equals_hex(q, vectors[v].out));
+    }
+}
+
+// k = u = 9, then k, u = X25519(k, u), k
+static void test_iterated(void) {
+    unsigned char k[32] = {9}, u[32] = {9}, r[32];
+    for (int i = 1; i <= 1000; i++) {
+        crypto_scalarmult(r, k, u);
+        memcpy(u, k, 32);
+        memcpy(k, r, 32);
+        if (i == 1) {
+            CHECK(equals_hex(k, iterated_1));
+        }
+    }
+    CHECK(equals_hex(k, iterated_1000));
+}
+
+static void test_diffie_hellman(void) {
+    unsigned char a[32], b[32], pa[32], pb[32], sa[32], sb[32];
+    unhex(a, alice_sk);
+    unhex(b, bob_sk);
+    CHECK(crypto_scalarmult_base(pa, a) == 0);
+    CHECK(crypto_scalarmult_base(pb, b) == 0);
+    CHECK(equals_hex(pa, alice_pk));
+    CHECK(equals_hex(pb, bob_pk));
+    CHECK(crypto_scalarmult(sa, a, pb) == 0);
+    CHECK(crypto_scalarmult(sb, b, pa) == 0);
+    CHECK(equals_hex(sa, shared));
+    CHECK(equals_hex(sb, shared));
+}
+
+// Bit 255 of u is ignored, and u is reduced mod p
+static void test_masking(void) {
+    unsigned char n[32], p[32], q1[32], q2[32];
+    for (int it = 0; it < 100; it++) {
+        randombytes(n, 32);
+        randombytes(p, 32);
+        p[31] &= 0x7f;
+        crypto_scalarmult(q1, n, p);
+        p[31] |= 0x80;
+        crypto_scalarmult(q2, n, p);
+        CHECK(memcmp(q1, q2, 32) == 0);
+    }
+
+    unsigned char all_ones[32], eighteen[32] = {18};
+    memset(all_ones, 0xff, sizeof(all_ones));
+    randombytes(n, 32);
+    crypto_scalarmult(q1, n, all_ones);
+    crypto_scalarmult(q2, n, eighteen);
+    CHECK(memcmp(q1, q2, 32) == 0);
+}
+
+int main(void) {
+    test_vectors();
+    test_iterated();
+    test_diffie_hellman();
+    test_masking();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}